@@ -0,0 +1,315 @@
+#ifndef RITSUKO_ALIGNED_BUFFER_POOL_HPP
+#define RITSUKO_ALIGNED_BUFFER_POOL_HPP
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/**
+ * @file AlignedBufferPool.hpp
+ * @brief Pool of aligned buffers that can be recycled across streams.
+ */
+
+namespace ritsuko {
+
+/**
+ * @brief Options for `AlignedBufferPool`.
+ */
+struct AlignedBufferPoolOptions {
+    /**
+     * Maximum number of bytes to hold in the pool's free lists.
+     * Released buffers that would exceed this limit are returned to the system.
+     */
+    size_t max_cached_bytes = 67108864;
+
+    /**
+     * Whether to request transparent huge pages for large buffers, i.e., those of at least 2 MiB.
+     * This is only supported on Linux and is ignored elsewhere.
+     */
+    bool huge_pages = false;
+};
+
+/**
+ * @brief Pool of aligned buffers that can be recycled across streams.
+ *
+ * Each buffer is aligned to at least 64 bytes, i.e., a cache line, so that it can be used with aligned SIMD loads and stores.
+ * Buffer sizes are rounded up to the next power of two, and released buffers are kept in a free list for each size.
+ * This allows many short-lived streams to reuse the same memory instead of hitting the system allocator for each new stream.
+ * Large buffers (at least 2 MiB) are aligned to 2 MiB so that they can be backed by huge pages, see `AlignedBufferPoolOptions::huge_pages`.
+ *
+ * This class is not thread-safe; each thread should use its own instance, e.g., via `thread_local_buffer_pool()`.
+ */
+class AlignedBufferPool {
+public:
+    /**
+     * @param options Further options.
+     */
+    AlignedBufferPool(const AlignedBufferPoolOptions& options) : my_options(options) {}
+
+    /**
+     * Overloaded constructor using default options.
+     */
+    AlignedBufferPool() = default;
+
+    /**
+     * @cond
+     */
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+    ~AlignedBufferPool() {
+        clear();
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * Minimum alignment of all buffers, in bytes.
+     */
+    static constexpr size_t alignment = 64;
+
+    /**
+     * Alignment of large buffers, in bytes.
+     */
+    static constexpr size_t large_alignment = 2097152;
+
+    /**
+     * @param bytes Number of bytes to allocate.
+     * If this is greater than the largest power of two in a `size_t`, `std::bad_alloc` is thrown.
+     * @return Pointer to a buffer of at least `bytes` bytes, aligned to at least `alignment`.
+     * This should be released with `deallocate()` using the same `bytes`.
+     */
+    void* allocate(size_t bytes) {
+        size_t index = size_class(bytes);
+        if (index < my_free.size() && !my_free[index].empty()) {
+            void* ptr = my_free[index].back();
+            my_free[index].pop_back();
+            my_cached -= class_bytes(index);
+            return ptr;
+        }
+
+        return allocate_new(class_bytes(index), my_options.huge_pages);
+    }
+
+    /**
+     * @param ptr Pointer to a buffer returned by `allocate()` on any `AlignedBufferPool`.
+     * @param bytes Number of bytes that was requested in `allocate()`.
+     */
+    void deallocate(void* ptr, size_t bytes) {
+        size_t index = size_class(bytes);
+        size_t full = class_bytes(index);
+        if (my_cached + full > my_options.max_cached_bytes) {
+            ::operator delete(ptr, std::align_val_t(class_alignment(full)));
+            return;
+        }
+
+        if (index >= my_free.size()) {
+            my_free.resize(index + 1);
+        }
+        my_free[index].push_back(ptr);
+        my_cached += full;
+    }
+
+    /**
+     * Allocate a buffer directly from the system, bypassing the free lists of any pool.
+     *
+     * @param bytes Number of bytes to allocate.
+     * @param huge_pages Whether to request transparent huge pages, see `AlignedBufferPoolOptions::huge_pages`.
+     * @return Pointer to a buffer of at least `bytes` bytes, aligned to at least `alignment`.
+     * This may be released with `deallocate()` on any pool or with `deallocate_unpooled()`, using the same `bytes`.
+     */
+    static void* allocate_unpooled(size_t bytes, bool huge_pages = false) {
+        return allocate_new(class_bytes(size_class(bytes)), huge_pages);
+    }
+
+    /**
+     * Return a buffer directly to the system, bypassing the free lists of any pool.
+     *
+     * @param ptr Pointer to a buffer returned by `allocate()` on any `AlignedBufferPool`, or by `allocate_unpooled()`.
+     * @param bytes Number of bytes that was requested in the allocation.
+     */
+    static void deallocate_unpooled(void* ptr, size_t bytes) {
+        size_t full = class_bytes(size_class(bytes));
+        ::operator delete(ptr, std::align_val_t(class_alignment(full)));
+    }
+
+    /**
+     * @return Number of bytes held in the free lists.
+     */
+    size_t cached_bytes() const {
+        return my_cached;
+    }
+
+    /**
+     * Return all buffers in the free lists to the system.
+     */
+    void clear() {
+        for (size_t index = 0; index < my_free.size(); ++index) {
+            size_t full = class_bytes(index);
+            for (auto ptr : my_free[index]) {
+                ::operator delete(ptr, std::align_val_t(class_alignment(full)));
+            }
+            my_free[index].clear();
+        }
+        my_cached = 0;
+    }
+
+    /**
+     * @return Options for this pool.
+     * These can be modified to affect subsequent calls to `allocate()` and `deallocate()`.
+     */
+    AlignedBufferPoolOptions& options() {
+        return my_options;
+    }
+
+private:
+    AlignedBufferPoolOptions my_options;
+    std::vector<std::vector<void*> > my_free;
+    size_t my_cached = 0;
+
+    static size_t size_class(size_t bytes) {
+        // Largest size class is the highest power of two that fits in a size_t.
+        if (bytes > (std::numeric_limits<size_t>::max() >> 1) + 1) {
+            throw std::bad_alloc();
+        }
+        size_t index = 0;
+        size_t full = alignment;
+        while (full < bytes) {
+            full <<= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    static size_t class_bytes(size_t index) {
+        return alignment << index;
+    }
+
+    static size_t class_alignment(size_t full) {
+        return (full >= large_alignment ? large_alignment : alignment);
+    }
+
+    static void* allocate_new(size_t full, [[maybe_unused]] bool huge_pages) {
+        void* ptr = ::operator new(full, std::align_val_t(class_alignment(full)));
+#ifdef __linux__
+#ifdef MADV_HUGEPAGE
+        if (huge_pages && full >= large_alignment) {
+            madvise(ptr, full, MADV_HUGEPAGE);
+        }
+#endif
+#endif
+        return ptr;
+    }
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Trivially destructible, so it remains accessible while other thread-local
+// objects are being destroyed after the thread-local pool.
+inline bool& thread_local_buffer_pool_destroyed() {
+    thread_local bool destroyed = false;
+    return destroyed;
+}
+
+class ThreadLocalBufferPool : public AlignedBufferPool {
+public:
+    ~ThreadLocalBufferPool() {
+        thread_local_buffer_pool_destroyed() = true;
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @return Reference to a pool that is specific to the calling thread.
+ */
+inline AlignedBufferPool& thread_local_buffer_pool() {
+    thread_local internal::ThreadLocalBufferPool pool;
+    return pool;
+}
+
+/**
+ * @brief Allocator that draws from the thread-local buffer pool.
+ *
+ * @tparam Type_ Type of the allocated values.
+ *
+ * This allocator obtains its memory from `thread_local_buffer_pool()`, so all allocations are aligned to 64 bytes and recycled after release.
+ * It can be used as the `Allocator_` for the streams, e.g., `hdf5::Stream1dNumericDataset<double, PooledAllocator<double> >`.
+ *
+ * Each allocator remembers the thread on which it (or the allocator that it was copied from) was constructed.
+ * Memory that is released on a different thread is returned directly to the system, so that one thread's pool is not filled by another thread's allocations.
+ * Memory that is released after the calling thread's pool has been destroyed, e.g., by other thread-local objects during thread exit, is also returned directly to the system.
+ */
+template<typename Type_>
+class PooledAllocator {
+public:
+    /**
+     * @cond
+     */
+    typedef Type_ value_type;
+    typedef std::true_type is_always_equal;
+
+    PooledAllocator() : my_owner(std::this_thread::get_id()) {}
+
+    template<typename Other_>
+    PooledAllocator(const PooledAllocator<Other_>& other) : my_owner(other.owner()) {}
+
+    Type_* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(Type_)) {
+            throw std::bad_array_new_length();
+        }
+        size_t bytes = n * sizeof(Type_);
+        if (internal::thread_local_buffer_pool_destroyed()) {
+            return static_cast<Type_*>(AlignedBufferPool::allocate_unpooled(bytes));
+        }
+        return static_cast<Type_*>(thread_local_buffer_pool().allocate(bytes));
+    }
+
+    void deallocate(Type_* ptr, size_t n) {
+        size_t bytes = n * sizeof(Type_);
+        if (internal::thread_local_buffer_pool_destroyed() || my_owner != std::this_thread::get_id()) {
+            AlignedBufferPool::deallocate_unpooled(ptr, bytes);
+        } else {
+            thread_local_buffer_pool().deallocate(ptr, bytes);
+        }
+    }
+
+    std::thread::id owner() const {
+        return my_owner;
+    }
+
+    template<typename Other_>
+    bool operator==(const PooledAllocator<Other_>&) const {
+        return true;
+    }
+
+    template<typename Other_>
+    bool operator!=(const PooledAllocator<Other_>&) const {
+        return false;
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    std::thread::id my_owner;
+};
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef RITSUKO_DEFAULT_INIT_ALLOCATOR_HPP
+#define RITSUKO_DEFAULT_INIT_ALLOCATOR_HPP
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+/**
+ * @file DefaultInitAllocator.hpp
+ * @brief Allocator that skips value-initialization.
+ */
+
+namespace ritsuko {
+
+/**
+ * @brief Allocator that skips value-initialization.
+ *
+ * @tparam Type_ Type of the allocated values.
+ * @tparam Base_ Base allocator.
+ *
+ * This allocator default-initializes new elements instead of value-initializing them.
+ * For arithmetic types, this means that `std::vector<Type_, DefaultInitAllocator<Type_> >::resize()` does not zero the new elements,
+ * which is useful when the vector is immediately overwritten, e.g., by `hdf5::read_1d_numeric_dataset_into()`.
+ * Construction with arguments is forwarded to `Base_` as usual.
+ */
+template<typename Type_, class Base_ = std::allocator<Type_> >
+class DefaultInitAllocator : public Base_ {
+    typedef std::allocator_traits<Base_> BaseTraits;
+
+public:
+    /**
+     * @cond
+     */
+    template<typename Other_>
+    struct rebind {
+        typedef DefaultInitAllocator<Other_, typename BaseTraits::template rebind_alloc<Other_> > other;
+    };
+
+    using Base_::Base_;
+
+    DefaultInitAllocator() = default;
+
+    template<typename Other_, class OtherBase_>
+    DefaultInitAllocator(const DefaultInitAllocator<Other_, OtherBase_>& other) : Base_(static_cast<const OtherBase_&>(other)) {}
+    /**
+     * @endcond
+     */
+
+    /**
+     * Default-initialize an element.
+     * @tparam Other_ Type of the element.
+     * @param ptr Pointer to the memory for the element.
+     */
+    template<typename Other_>
+    void construct(Other_* ptr) noexcept(std::is_nothrow_default_constructible<Other_>::value) {
+        ::new(static_cast<void*>(ptr)) Other_;
+    }
+
+    /**
+     * Construct an element with arguments, forwarding to the base allocator.
+     * @tparam Other_ Type of the element.
+     * @tparam Args_ Types of the arguments.
+     * @param ptr Pointer to the memory for the element.
+     * @param args Arguments to pass to the constructor.
+     */
+    template<typename Other_, typename ... Args_>
+    void construct(Other_* ptr, Args_&& ... args) {
+        BaseTraits::construct(static_cast<Base_&>(*this), ptr, std::forward<Args_>(args)...);
+    }
+};
+
+}
+
+#endif
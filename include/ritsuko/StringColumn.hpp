@@ -0,0 +1,120 @@
+#ifndef RITSUKO_STRING_COLUMN_HPP
+#define RITSUKO_STRING_COLUMN_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <limits>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file StringColumn.hpp
+ * @brief Contiguous storage for a column of strings.
+ */
+
+namespace ritsuko {
+
+/**
+ * @brief Contiguous storage for a column of strings.
+ *
+ * @tparam Offset_ Integer type for the offsets, typically `int32_t` or `int64_t`.
+ * This determines the maximum total length of all strings in the column.
+ *
+ * All strings are concatenated into a single byte buffer, and the start of each string is recorded in an array of offsets.
+ * The `i`-th string spans the bytes from `offsets()[i]` to `offsets()[i + 1]`, so the offsets array always contains `size() + 1` values, starting from zero.
+ * This avoids the per-element header and heap allocation of a `std::vector<std::string>`, making it more efficient for subsequent scans.
+ * It is also the same layout as Arrow's string arrays.
+ */
+template<typename Offset_ = int64_t>
+class StringColumn {
+    static_assert(std::is_integral<Offset_>::value, "offsets should be integers");
+
+public:
+    /**
+     * Create an empty column.
+     */
+    StringColumn() : my_offsets(1, 0) {}
+
+public:
+    /**
+     * @return Number of strings in the column.
+     */
+    size_t size() const {
+        return my_offsets.size() - 1;
+    }
+
+    /**
+     * @param i Index of the string.
+     * @return View of the `i`-th string.
+     * This is only valid until the next modification of the column.
+     */
+    std::string_view operator[](size_t i) const {
+        return std::string_view(my_bytes.data() + my_offsets[i], my_offsets[i + 1] - my_offsets[i]);
+    }
+
+    /**
+     * @return Concatenated bytes of all strings.
+     */
+    const std::vector<char>& bytes() const {
+        return my_bytes;
+    }
+
+    /**
+     * @return Offsets of the start of each string in `bytes()`, followed by the total number of bytes.
+     */
+    const std::vector<Offset_>& offsets() const {
+        return my_offsets;
+    }
+
+public:
+    /**
+     * Append a string to the end of the column.
+     * An error is raised if the total number of bytes exceeds the largest value of `Offset_`.
+     *
+     * @param ptr Pointer to the start of the string.
+     * @param len Length of the string.
+     */
+    void push_back(const char* ptr, size_t len) {
+        size_t current = my_bytes.size();
+        if (len > static_cast<size_t>(std::numeric_limits<Offset_>::max()) - current) {
+            throw std::runtime_error("total length of all strings exceeds the limit of the offset type");
+        }
+        my_bytes.insert(my_bytes.end(), ptr, ptr + len);
+        my_offsets.push_back(current + len);
+    }
+
+    /**
+     * @param x String to append to the end of the column.
+     */
+    void push_back(std::string_view x) {
+        push_back(x.data(), x.size());
+    }
+
+    /**
+     * @param number Expected number of strings.
+     * @param bytes Expected total number of bytes across all strings.
+     */
+    void reserve(size_t number, size_t bytes) {
+        my_offsets.reserve(number + 1);
+        my_bytes.reserve(bytes);
+    }
+
+    /**
+     * Remove all strings from the column.
+     */
+    void clear() {
+        my_bytes.clear();
+        my_offsets.resize(1);
+    }
+
+private:
+    std::vector<char> my_bytes;
+    std::vector<Offset_> my_offsets;
+};
+
+}
+
+#endif
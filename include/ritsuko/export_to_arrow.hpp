@@ -0,0 +1,250 @@
+#ifndef RITSUKO_EXPORT_TO_ARROW_HPP
+#define RITSUKO_EXPORT_TO_ARROW_HPP
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "StringColumn.hpp"
+
+/**
+ * @file export_to_arrow.hpp
+ * @brief Export columns through the Arrow C data interface.
+ */
+
+/**
+ * @cond
+ */
+// Definitions from the Arrow C data interface, see https://arrow.apache.org/docs/format/CDataInterface.html.
+// These are guarded by the same macro as Arrow's own headers so that both can be included in the same translation unit.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+/**
+ * @endcond
+ */
+
+namespace ritsuko {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+template<typename Type_>
+const char* arrow_numeric_format() {
+    static_assert(std::is_arithmetic<Type_>::value && !std::is_same<Type_, bool>::value, "expected a numeric type");
+    if constexpr(std::is_floating_point<Type_>::value) {
+        static_assert(sizeof(Type_) == 4 || sizeof(Type_) == 8, "only 32- and 64-bit floats are supported");
+        return (sizeof(Type_) == 4 ? "f" : "g");
+    } else if constexpr(std::is_signed<Type_>::value) {
+        switch (sizeof(Type_)) {
+            case 1: return "c";
+            case 2: return "s";
+            case 4: return "i";
+            default: return "l";
+        }
+    } else {
+        switch (sizeof(Type_)) {
+            case 1: return "C";
+            case 2: return "S";
+            case 4: return "I";
+            default: return "L";
+        }
+    }
+}
+
+template<class Data_>
+struct ArrowHolder {
+    ArrowHolder(Data_ data) : data(std::move(data)) {}
+    Data_ data;
+    std::vector<uint8_t> validity;
+    const void* buffers[3] = { NULL, NULL, NULL };
+};
+
+template<class Data_>
+void release_arrow_array(ArrowArray* array) {
+    delete static_cast<ArrowHolder<Data_>*>(array->private_data);
+    array->release = NULL;
+}
+
+inline void release_arrow_schema(ArrowSchema* schema) {
+    schema->release = NULL;
+}
+
+template<class Function_>
+int64_t fill_validity(size_t n, std::vector<uint8_t>& validity, Function_ is_missing) {
+    int64_t null_count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (is_missing(i)) {
+            if (null_count == 0) {
+                // Only allocating the bitmap once we find a missing value.
+                validity.resize((n + 7) / 8, 0xFF);
+            }
+            validity[i / 8] &= static_cast<uint8_t>(~(1u << (i % 8)));
+            ++null_count;
+        }
+    }
+    return null_count;
+}
+
+template<class Data_>
+void finish_arrow_export(ArrowHolder<Data_>* holder, int64_t length, int64_t null_count, int64_t n_buffers, const char* format, bool nullable, ArrowArray* array, ArrowSchema* schema) {
+    if (null_count) {
+        holder->buffers[0] = holder->validity.data();
+    }
+
+    array->length = length;
+    array->null_count = null_count;
+    array->offset = 0;
+    array->n_buffers = n_buffers;
+    array->n_children = 0;
+    array->buffers = holder->buffers;
+    array->children = NULL;
+    array->dictionary = NULL;
+    array->release = release_arrow_array<Data_>;
+    array->private_data = holder;
+
+    schema->format = format;
+    schema->name = NULL;
+    schema->metadata = NULL;
+    schema->flags = (nullable ? ARROW_FLAG_NULLABLE : 0);
+    schema->n_children = 0;
+    schema->children = NULL;
+    schema->dictionary = NULL;
+    schema->release = release_arrow_schema;
+    schema->private_data = NULL;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Export a numeric column through the Arrow C data interface.
+ * Ownership of `values` is transferred to `array`, so that the exported data buffer points directly into the vector's storage without any copy.
+ * The vector is destroyed when the consumer calls `array->release`.
+ *
+ * If a missing placeholder is supplied, a validity bitmap is created where each element equal to the placeholder is marked as null.
+ * For floating-point types, a NaN placeholder marks all NaN values as null.
+ * The bitmap is only allocated if at least one element is missing.
+ *
+ * @tparam Type_ Numeric type, which should be a fixed-width integer, `float` or `double`.
+ * @tparam Allocator_ Allocator for the vector.
+ * @param values Vector of values, typically from `hdf5::load_1d_numeric_dataset()`.
+ * This should be moved into the function call to avoid a copy.
+ * @param placeholder Missing placeholder, typically from `hdf5::open_and_load_optional_numeric_missing_placeholder()`.
+ * @param[out] array Pointer to an uninitialized `ArrowArray`.
+ * @param[out] schema Pointer to an uninitialized `ArrowSchema`.
+ */
+template<typename Type_, class Allocator_>
+void export_numeric_to_arrow(std::vector<Type_, Allocator_> values, const std::optional<Type_>& placeholder, ArrowArray* array, ArrowSchema* schema) {
+    typedef std::vector<Type_, Allocator_> Data;
+    auto holder = new internal::ArrowHolder<Data>(std::move(values));
+    const auto& data = holder->data;
+    size_t n = data.size();
+
+    int64_t null_count = 0;
+    try {
+        if (placeholder.has_value()) {
+            auto missing = *placeholder;
+            if constexpr(std::is_floating_point<Type_>::value) {
+                if (std::isnan(missing)) {
+                    null_count = internal::fill_validity(n, holder->validity, [&](size_t i) -> bool { return std::isnan(data[i]); });
+                } else {
+                    null_count = internal::fill_validity(n, holder->validity, [&](size_t i) -> bool { return data[i] == missing; });
+                }
+            } else {
+                null_count = internal::fill_validity(n, holder->validity, [&](size_t i) -> bool { return data[i] == missing; });
+            }
+        }
+    } catch (...) {
+        delete holder;
+        throw;
+    }
+
+    holder->buffers[1] = data.data();
+    internal::finish_arrow_export(holder, n, null_count, 2, internal::arrow_numeric_format<Type_>(), placeholder.has_value(), array, schema);
+}
+
+/**
+ * Export a string column through the Arrow C data interface.
+ * Ownership of `column` is transferred to `array`, so that the exported offsets and data buffers point directly into the column's storage without any copy.
+ * The column is destroyed when the consumer calls `array->release`.
+ *
+ * If a missing placeholder is supplied, a validity bitmap is created where each string equal to the placeholder is marked as null.
+ * The bitmap is only allocated if at least one element is missing.
+ *
+ * @tparam Offset_ Integer type for the offsets.
+ * This should be `int32_t`, which is exported as Arrow's `utf8` type; or `int64_t`, which is exported as `large_utf8`.
+ * @param column Column of strings, typically from `hdf5::load_1d_string_dataset_as_column()`.
+ * This should be moved into the function call to avoid a copy.
+ * @param placeholder Missing placeholder, typically from `hdf5::open_and_load_optional_string_missing_placeholder()`.
+ * @param[out] array Pointer to an uninitialized `ArrowArray`.
+ * @param[out] schema Pointer to an uninitialized `ArrowSchema`.
+ */
+template<typename Offset_>
+void export_strings_to_arrow(StringColumn<Offset_> column, const std::optional<std::string>& placeholder, ArrowArray* array, ArrowSchema* schema) {
+    static_assert(std::is_same<Offset_, int32_t>::value || std::is_same<Offset_, int64_t>::value, "offsets should be 32- or 64-bit signed integers");
+
+    typedef StringColumn<Offset_> Data;
+    auto holder = new internal::ArrowHolder<Data>(std::move(column));
+    const auto& data = holder->data;
+    size_t n = data.size();
+
+    int64_t null_count = 0;
+    try {
+        if (placeholder.has_value()) {
+            std::string_view missing(*placeholder);
+            null_count = internal::fill_validity(n, holder->validity, [&](size_t i) -> bool { return data[i] == missing; });
+        }
+    } catch (...) {
+        delete holder;
+        throw;
+    }
+
+    // The data buffer should not be NULL, even if there are no bytes.
+    static const char empty = 0;
+    holder->buffers[1] = data.offsets().data();
+    holder->buffers[2] = (data.bytes().empty() ? &empty : data.bytes().data());
+    internal::finish_arrow_export(holder, n, null_count, 3, (std::is_same<Offset_, int32_t>::value ? "u" : "U"), placeholder.has_value(), array, schema);
+}
+
+}
+
+#endif
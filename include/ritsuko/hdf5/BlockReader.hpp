@@ -0,0 +1,391 @@
+#ifndef RITSUKO_HDF5_BLOCK_READER_HPP
+#define RITSUKO_HDF5_BLOCK_READER_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <future>
+#include <optional>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstddef>
+
+#include "../AlignedBufferPool.hpp"
+#include "../permute_dimensions.hpp"
+#include "get_dimensions.hpp"
+#include "pick_nd_block_dimensions.hpp"
+#include "IterateNdDataset.hpp"
+#include "NumericBlockReader.hpp"
+#include "StreamStats.hpp"
+#include "serialize.hpp"
+
+/**
+ * @file BlockReader.hpp
+ * @brief Read an N-dimensional numeric dataset by block.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for `BlockReader`.
+ */
+struct BlockReaderOptions {
+    /**
+     * Whether to read the next block in a background thread while the caller is processing the current block.
+     * If `true`, all HDF5 calls in the `BlockReader` constructor, destructor and `BlockReader::next()` are made inside `serialize()`,
+     * so any concurrent HDF5 calls in the caller should also be wrapped in `serialize()`.
+     * Note that the `BlockReader` itself should not be constructed or destroyed inside `serialize()`, as this will deadlock.
+     */
+    bool prefetch = false;
+
+    /**
+     * Options for the iteration through the dataset, e.g., the order in which blocks are visited.
+     */
+    IterateNdDatasetOptions iteration;
+
+    /**
+     * Memory layout of each block, as the order of the dataset dimensions from slowest- to fastest-changing.
+     * For example, for a 2-dimensional dataset, `{ 1, 0 }` will yield column-major blocks.
+     * This should be a permutation of the dimension indices, see `is_dimension_permutation()`.
+     * If empty, blocks are returned in row-major order, i.e., the same layout as HDF5.
+     */
+    std::vector<size_t> layout;
+};
+
+/**
+ * @brief View of a block of an N-dimensional dataset.
+ * @tparam Type_ Type of the data in memory.
+ */
+template<typename Type_>
+struct NdBlockView {
+    /**
+     * Pointer to the contents of the block.
+     */
+    const Type_* data = NULL;
+
+    /**
+     * Starting coordinates of the block in the dataset.
+     */
+    std::vector<hsize_t> starts;
+
+    /**
+     * Dimensions of the block.
+     */
+    std::vector<hsize_t> counts;
+
+    /**
+     * Stride of each dimension of the block, i.e., the distance in `data` between consecutive positions along that dimension.
+     * For row-major blocks, the last stride is 1 and each preceding stride is the product of the subsequent `counts`.
+     * For other layouts (see `BlockReaderOptions::layout`), the stride is 1 for the fastest-changing dimension, and so on.
+     * The element at position `x` in the block is located at `data[x[0] * strides[0] + x[1] * strides[1] + ...]`.
+     */
+    std::vector<size_t> strides;
+
+    /**
+     * Number of elements in the block.
+     */
+    size_t size = 0;
+};
+
+/**
+ * @brief Read an N-dimensional numeric dataset by block.
+ *
+ * @tparam Type_ Type of the data in memory.
+ * @tparam Allocator_ Allocator for the block buffers.
+ * By default, this uses `PooledAllocator` so that the buffers are aligned to 64 bytes and recycled across readers.
+ *
+ * This wraps an `IterateNdDataset` and reads each block into a reusable buffer, so callers do not need to manage the buffers and dataspaces themselves.
+ * Buffers are allocated once for the largest block and type conversions are performed by `NumericBlockReader`.
+ * If `BlockReaderOptions::prefetch = true`, a second buffer is allocated and the next block is read in the background while the caller is processing the current block.
+ *
+ * If a non-row-major `BlockReaderOptions::layout` is requested, each block is read into a staging buffer and its dimensions are permuted by `permute_dimensions()`.
+ * With prefetching, the permutation is performed in the background thread outside of `serialize()`.
+ */
+template<typename Type_, class Allocator_ = PooledAllocator<Type_> >
+class BlockReader {
+public:
+    /**
+     * @param ptr Pointer to a HDF5 dataset.
+     * This should remain valid for the lifetime of the reader.
+     * @param dimensions Dimensions of the dataset.
+     * @param blocks Block dimensions, typically obtained from `pick_nd_block_dimensions()`.
+     * @param options Further options.
+     * @param allocator Allocator for the block buffers.
+     */
+    BlockReader(const H5::DataSet* ptr, std::vector<hsize_t> dimensions, std::vector<hsize_t> blocks, const BlockReaderOptions& options, const Allocator_& allocator = Allocator_()) :
+        my_prefetch(options.prefetch)
+    {
+        locked([&]() -> void {
+            initialize(ptr, std::move(dimensions), std::move(blocks), options, allocator);
+        });
+        start();
+    }
+
+    /**
+     * Overload that determines the dimensions from the dataset and picks the block dimensions with `pick_nd_block_dimensions()`.
+     *
+     * @param ptr Pointer to a HDF5 dataset.
+     * This should remain valid for the lifetime of the reader.
+     * @param buffer_size Size of the buffer in terms of the number of elements.
+     * @param options Further options.
+     * @param allocator Allocator for the block buffers.
+     */
+    BlockReader(const H5::DataSet* ptr, hsize_t buffer_size, const BlockReaderOptions& options, const Allocator_& allocator = Allocator_()) :
+        my_prefetch(options.prefetch)
+    {
+        locked([&]() -> void {
+            auto dimensions = get_dimensions(*ptr, false);
+            auto blocks = pick_nd_block_dimensions(ptr->getCreatePlist(), dimensions, buffer_size);
+            initialize(ptr, std::move(dimensions), std::move(blocks), options, allocator);
+        });
+        start();
+    }
+
+    /**
+     * @cond
+     */
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    ~BlockReader() {
+        // Waiting for any in-flight read, ignoring its errors.
+        if (my_future.valid()) {
+            my_future.wait();
+        }
+        release();
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Whether all blocks have been visited.
+     * `block()` should only be called if this is `false`.
+     */
+    bool finished() const {
+        return my_finished;
+    }
+
+    /**
+     * @return View of the current block.
+     * The data pointer is only valid until the next call to `next()`.
+     */
+    const NdBlockView<Type_>& block() const {
+        return my_views[my_current];
+    }
+
+    /**
+     * Move to the next block.
+     * If prefetching is enabled, this waits for the background read to finish and rethrows any error from that read.
+     */
+    void next() {
+        if (!my_prefetch) {
+            if (my_iter->finished()) {
+                my_finished = true;
+                return;
+            }
+            load(my_current);
+            advance();
+            return;
+        }
+
+        if (!my_future.valid()) {
+            my_finished = true;
+            return;
+        }
+        my_future.get();
+        my_current = 1 - my_current;
+        advance();
+        launch();
+    }
+
+    /**
+     * @return Statistics for the blocks that have been read so far, including any prefetched block.
+     * If prefetching is enabled, this waits for the background read to finish.
+     * All counters are zero unless `RITSUKO_HDF5_STREAM_STATS` is defined.
+     */
+    StreamStats stats() const {
+        if (my_future.valid()) {
+            my_future.wait();
+        }
+        return my_recorder.get();
+    }
+
+private:
+    // These hold HDF5 objects, so they are created and destroyed inside
+    // locked() to avoid racing with any in-flight background read.
+    std::optional<IterateNdDataset> my_iter;
+    std::optional<NumericBlockReader<Type_> > my_reader;
+    bool my_prefetch;
+    bool my_finished = false;
+
+    std::vector<std::vector<Type_, Allocator_> > my_buffers;
+    std::vector<size_t> my_layout;
+    bool my_permuted = false;
+    std::vector<Type_, Allocator_> my_staging;
+    NdBlockView<Type_> my_views[2];
+    size_t my_current = 0;
+    std::future<void> my_future;
+    StreamStatsRecorder my_recorder;
+
+    template<class Function_>
+    void locked(Function_ fun) {
+        if (my_prefetch) {
+            serialize(fun);
+        } else {
+            fun();
+        }
+    }
+
+    void initialize(const H5::DataSet* ptr, std::vector<hsize_t> dimensions, std::vector<hsize_t> blocks, const BlockReaderOptions& options, const Allocator_& allocator) {
+        try {
+            my_iter.emplace(std::move(dimensions), std::move(blocks), options.iteration);
+            my_reader.emplace(ptr);
+
+            size_t full = 1;
+            for (auto b : my_iter->block_dimensions()) {
+                full *= b;
+            }
+
+            size_t ndims = my_iter->dimensions().size();
+            if (options.layout.empty()) {
+                my_layout.resize(ndims);
+                std::iota(my_layout.begin(), my_layout.end(), 0);
+            } else {
+                if (!is_dimension_permutation(options.layout, ndims)) {
+                    throw std::runtime_error("layout should be a permutation of the dataset dimensions");
+                }
+                my_layout = options.layout;
+                for (size_t i = 0; i < ndims; ++i) {
+                    if (my_layout[i] != i) {
+                        my_permuted = true;
+                        break;
+                    }
+                }
+            }
+
+            if (my_permuted) {
+                my_staging = std::vector<Type_, Allocator_>(full, allocator);
+                my_recorder.record_allocation(full * sizeof(Type_));
+            }
+
+            size_t nslots = (my_prefetch ? 2 : 1);
+            for (size_t s = 0; s < nslots; ++s) {
+                my_buffers.emplace_back(allocator);
+                my_buffers.back().resize(full);
+                my_recorder.record_allocation(full * sizeof(Type_));
+            }
+        } catch (...) {
+            // Still holding the lock here, so the HDF5 objects can be safely released.
+            my_iter.reset();
+            my_reader.reset();
+            throw;
+        }
+    }
+
+    void release() {
+        locked([&]() -> void {
+            my_iter.reset();
+            my_reader.reset();
+        });
+    }
+
+    // Any HDF5 objects must be released under the lock if construction fails,
+    // as the destructor will not be called.
+    void start() {
+        try {
+            if (!my_iter.has_value()) {
+                return;
+            }
+            if (my_iter->finished()) {
+                my_finished = true;
+                return;
+            }
+            load(my_current);
+            advance();
+            if (my_prefetch) {
+                launch();
+            }
+        } catch (...) {
+            if (my_future.valid()) {
+                my_future.wait();
+            }
+            release();
+            throw;
+        }
+    }
+
+    void fill_view(size_t slot) {
+        auto& view = my_views[slot];
+        view.data = my_buffers[slot].data();
+        view.starts = my_iter->starts();
+        view.counts = my_iter->counts();
+        view.size = my_iter->current_block_size();
+
+        size_t ndims = view.counts.size();
+        view.strides.resize(ndims);
+        size_t stride = 1;
+        for (size_t i = ndims; i > 0; --i) {
+            auto d = my_layout[i - 1];
+            view.strides[d] = stride;
+            stride *= view.counts[d];
+        }
+    }
+
+    // Only this function makes HDF5 calls, so it should be wrapped in
+    // serialize() when prefetching. The permutation is done separately by
+    // permute() so that it can run outside of the lock.
+    void read(size_t slot) {
+        auto target = (my_permuted ? my_staging.data() : my_buffers[slot].data());
+        my_reader->read(target, my_iter->current_block_size(), my_iter->memory_space(), my_iter->file_space(), my_recorder);
+        my_recorder.record_block();
+    }
+
+    void permute(size_t slot) {
+        if (my_permuted) {
+            my_recorder.record_conversion([&]() -> void {
+                permute_dimensions(my_staging.data(), my_views[slot].counts, my_layout, my_buffers[slot].data());
+            });
+        }
+    }
+
+    void advance() {
+        locked([&]() -> void {
+            my_iter->next();
+        });
+    }
+
+    void load(size_t slot) {
+        fill_view(slot);
+        locked([&]() -> void {
+            read(slot);
+        });
+        permute(slot);
+    }
+
+    // Reading the block at the current position of 'my_iter' into the other
+    // slot. 'my_iter' must not be modified until the read is complete.
+    void launch() {
+        if (my_iter->finished()) {
+            return;
+        }
+        size_t slot = 1 - my_current;
+        fill_view(slot);
+        my_future = std::async(std::launch::async, [this,slot]() -> void {
+            serialize([&]() -> void {
+                read(slot);
+            });
+            permute(slot);
+        });
+    }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,745 @@
+#ifndef RITSUKO_HDF5_DIRECT_CHUNK_READER_HPP
+#define RITSUKO_HDF5_DIRECT_CHUNK_READER_HPP
+
+#include "H5Cpp.h"
+#include "zlib.h"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+
+#include "../parallelize.hpp"
+#include "serialize.hpp"
+#include "pick_1d_block_size.hpp"
+#include "get_1d_length.hpp"
+#include "get_name.hpp"
+#include "as_numeric_datatype.hpp"
+#include "IterateNdDataset.hpp"
+#include "VariableStringArena.hpp"
+#include "utils_string.hpp"
+
+/**
+ * @file DirectChunkReader.hpp
+ * @brief Read chunked datasets with parallel decompression.
+ *
+ * Unlike the other HDF5 utilities, this header requires linking to **zlib**.
+ * As such, it is not included in the `hdf5.hpp` umbrella header and should be explicitly included when needed.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for `DirectChunkReader`.
+ */
+struct DirectChunkReaderOptions {
+    /**
+     * Number of threads to use for decompression.
+     */
+    int num_threads = 1;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Returns false if the filter pipeline contains anything other than deflate and shuffle.
+inline bool get_direct_filters(const H5::DSetCreatPropList& cplist, std::vector<H5Z_filter_t>& filters) {
+    int nfilters = cplist.getNfilters();
+    for (int f = 0; f < nfilters; ++f) {
+        unsigned int flags;
+        size_t nelmts = 0;
+        unsigned int filter_config;
+        auto id = cplist.getFilter(f, flags, nelmts, NULL, 0, NULL, filter_config);
+        if (id != H5Z_FILTER_DEFLATE && id != H5Z_FILTER_SHUFFLE) {
+            return false;
+        }
+        filters.push_back(id);
+    }
+    return true;
+}
+
+inline void unshuffle_bytes(const unsigned char* input, size_t nbytes, size_t width, unsigned char* output) {
+    size_t nelements = nbytes / width;
+    if (width <= 1 || nelements <= 1) {
+        std::copy_n(input, nbytes, output);
+        return;
+    }
+
+    for (size_t b = 0; b < width; ++b) {
+        const unsigned char* src = input + b * nelements;
+        unsigned char* dest = output + b;
+        for (size_t i = 0; i < nelements; ++i, dest += width) {
+            *dest = src[i];
+        }
+    }
+
+    // Leftover bytes are not shuffled by HDF5.
+    size_t used = nelements * width;
+    std::copy(input + used, input + nbytes, output + used);
+}
+
+// No HDF5 calls are allowed here as this runs outside of serialize().
+// On return, 'raw' contains the decoded chunk of 'expected' bytes.
+inline void decode_chunk(const std::vector<H5Z_filter_t>& filters, uint32_t filter_mask, size_t width, size_t expected, std::vector<unsigned char>& raw, std::vector<unsigned char>& staging) {
+    // Filters are applied in order during writing, so we undo them in reverse.
+    for (size_t f = filters.size(); f > 0; --f) {
+        if (filter_mask & (static_cast<uint32_t>(1) << (f - 1))) {
+            continue;
+        }
+
+        if (filters[f - 1] == H5Z_FILTER_DEFLATE) {
+            staging.resize(expected);
+            uLongf destlen = expected;
+            auto status = uncompress(staging.data(), &destlen, raw.data(), raw.size());
+            if (status != Z_OK || destlen != expected) {
+                throw std::runtime_error("failed to decompress a chunk");
+            }
+        } else {
+            staging.resize(raw.size());
+            unshuffle_bytes(raw.data(), raw.size(), width, staging.data());
+        }
+        raw.swap(staging);
+    }
+
+    if (raw.size() != expected) {
+        throw std::runtime_error("decoded chunk has an unexpected size");
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Read chunked numeric datasets with parallel decompression.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * For chunked datasets, HDF5 decompresses each chunk on the calling thread during a `H5::DataSet::read()`.
+ * This class bypasses the HDF5 filter pipeline by fetching the raw chunks with `H5Dread_chunk()`,
+ * and then decompressing and unshuffling them on multiple worker threads via `parallelize()`.
+ * All HDF5 calls (i.e., fetching the raw chunks and type conversion of the decoded chunks) are performed inside `serialize()`, while the filters are run outside of the lock.
+ *
+ * The direct path is only used for numeric datasets whose filter pipeline consists only of the deflate and shuffle filters.
+ * For all other datasets (e.g., contiguous layouts, unsupported filters), or for unallocated chunks, this class falls back to a regular `H5::DataSet::read()`.
+ * Callers can check which path is used via `is_direct()`.
+ */
+template<typename Type_>
+class DirectChunkReader {
+public:
+    /**
+     * @param ptr Pointer to a HDF5 dataset.
+     * @param options Further options.
+     */
+    DirectChunkReader(const H5::DataSet* ptr, const DirectChunkReaderOptions& options) :
+        my_ptr(ptr),
+        my_num_threads(std::max(options.num_threads, 1)),
+        my_mtype(as_numeric_datatype<Type_>())
+    {
+        serialize([&]() -> void {
+            auto space = my_ptr->getSpace();
+            my_ndims = space.getSimpleExtentNdims();
+            my_dimensions.resize(my_ndims);
+            space.getSimpleExtentDims(my_dimensions.data());
+            my_fspace = H5::DataSpace(my_ndims, my_dimensions.data());
+
+            auto cplist = my_ptr->getCreatePlist();
+            if (my_ndims == 0 || cplist.getLayout() != H5D_CHUNKED) {
+                return;
+            }
+            my_chunk_dimensions.resize(my_ndims);
+            cplist.getChunk(my_ndims, my_chunk_dimensions.data());
+
+            auto tclass = my_ptr->getTypeClass();
+            if (tclass != H5T_INTEGER && tclass != H5T_FLOAT) {
+                return;
+            }
+            my_ftype = my_ptr->getDataType();
+            my_ftype_size = my_ftype.getSize();
+            my_needs_conversion = !(my_ftype == my_mtype);
+
+            if (!internal::get_direct_filters(cplist, my_filters)) {
+                my_filters.clear();
+                return;
+            }
+
+            my_chunk_elements = 1;
+            for (auto c : my_chunk_dimensions) {
+                my_chunk_elements *= c;
+            }
+            my_direct = true;
+        });
+    }
+
+    /**
+     * Overloaded constructor that uses default options.
+     * @param ptr Pointer to a HDF5 dataset.
+     */
+    DirectChunkReader(const H5::DataSet* ptr) : DirectChunkReader(ptr, DirectChunkReaderOptions()) {}
+
+public:
+    /**
+     * @return Whether chunks are being read and decompressed directly.
+     * If `false`, all reads are performed via the usual HDF5 read pipeline.
+     */
+    bool is_direct() const {
+        return my_direct;
+    }
+
+    /**
+     * @return Dimensions of the dataset.
+     */
+    const std::vector<hsize_t>& dimensions() const {
+        return my_dimensions;
+    }
+
+    /**
+     * Read a hyperslab of the dataset into memory.
+     * This is most efficient when the hyperslab is aligned to the chunk boundaries, e.g., from `pick_1d_block_size()` or `pick_nd_block_dimensions()`,
+     * as partially overlapping chunks need to be decompressed in full.
+     *
+     * @param starts Pointer to an array of length equal to the dimensionality of the dataset, containing the start of the hyperslab in each dimension.
+     * @param counts Pointer to an array of length equal to the dimensionality of the dataset, containing the extent of the hyperslab in each dimension.
+     * @param[out] output Pointer to an array with space for the product of `counts`.
+     * On return, this is filled with the contents of the hyperslab in row-major order.
+     */
+    void read(const hsize_t* starts, const hsize_t* counts, Type_* output) {
+        if (!my_direct) {
+            serialize([&]() -> void {
+                my_fspace.selectHyperslab(H5S_SELECT_SET, counts, starts);
+                H5::DataSpace mspace(my_ndims, counts);
+                my_ptr->read(output, my_mtype, mspace, my_fspace);
+            });
+            return;
+        }
+
+        for (size_t d = 0; d < my_ndims; ++d) {
+            if (counts[d] == 0) {
+                return;
+            }
+        }
+        enumerate_chunks(starts, counts);
+        size_t nchunks = my_chunk_offsets.size() / my_ndims;
+        if (my_chunks.size() < nchunks) {
+            my_chunks.resize(nchunks);
+        }
+
+        serialize([&]() -> void {
+            auto did = my_ptr->getId();
+            for (size_t c = 0; c < nchunks; ++c) {
+                auto& current = my_chunks[c];
+                const hsize_t* offset = my_chunk_offsets.data() + c * my_ndims;
+                // Some HDF5 versions report an error for unallocated chunks
+                // instead of returning a zero size. Either way, we defer to
+                // the usual read for such chunks so that HDF5 can fill them in;
+                // any genuine errors will be surfaced by that read.
+                hsize_t nbytes = 0;
+                herr_t status;
+                H5E_BEGIN_TRY {
+                    status = H5Dget_chunk_storage_size(did, offset, &nbytes);
+                } H5E_END_TRY;
+                current.allocated = (status >= 0 && nbytes > 0);
+                if (!current.allocated) {
+                    continue;
+                }
+
+                current.raw.resize(nbytes);
+                if (H5Dread_chunk(did, H5P_DEFAULT, offset, &(current.filter_mask), current.raw.data()) < 0) {
+                    throw std::runtime_error("failed to read a raw chunk from '" + get_name(*my_ptr) + "'");
+                }
+            }
+        });
+
+        parallelize(my_num_threads, nchunks, [&](size_t, size_t start, size_t length) -> void {
+            for (size_t c = start, end = start + length; c < end; ++c) {
+                if (my_chunks[c].allocated) {
+                    decode(my_chunks[c]);
+                }
+            }
+        });
+
+        serialize([&]() -> void {
+            for (size_t c = 0; c < nchunks; ++c) {
+                auto& current = my_chunks[c];
+                const hsize_t* offset = my_chunk_offsets.data() + c * my_ndims;
+                if (current.allocated) {
+                    if (my_needs_conversion) {
+                        if (H5Tconvert(my_ftype.getId(), my_mtype.getId(), my_chunk_elements, current.decoded.data(), NULL, H5P_DEFAULT) < 0) {
+                            throw std::runtime_error("failed to convert the datatype of a chunk from '" + get_name(*my_ptr) + "'");
+                        }
+                    }
+                    copy_chunk(offset, reinterpret_cast<const Type_*>(current.decoded.data()), starts, counts, output);
+                } else {
+                    read_unallocated(offset, starts, counts, output);
+                }
+            }
+        });
+    }
+
+    /**
+     * Read the current block of an `IterateNdDataset` into memory.
+     * This is equivalent to calling `H5::DataSet::read()` with the memory and file dataspaces of `iter`.
+     *
+     * @param iter Iterator over the dataset.
+     * @param[out] output Pointer to an array with space for `iter.current_block_size()` elements.
+     */
+    void read(const IterateNdDataset& iter, Type_* output) {
+        read(iter.starts().data(), iter.counts().data(), output);
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    size_t my_num_threads;
+
+    size_t my_ndims = 0;
+    std::vector<hsize_t> my_dimensions;
+    H5::DataSpace my_fspace;
+
+    const H5::PredType& my_mtype;
+    H5::DataType my_ftype;
+    size_t my_ftype_size = 0;
+    bool my_needs_conversion = false;
+
+    bool my_direct = false;
+    std::vector<hsize_t> my_chunk_dimensions;
+    size_t my_chunk_elements = 0;
+    std::vector<H5Z_filter_t> my_filters;
+
+    struct Chunk {
+        bool allocated = false;
+        uint32_t filter_mask = 0;
+        std::vector<unsigned char> raw, decoded;
+
+        // Retained across reads so that decoding does not allocate for each chunk.
+        std::vector<unsigned char> staging;
+    };
+    std::vector<Chunk> my_chunks;
+    std::vector<hsize_t> my_chunk_offsets;
+
+    void enumerate_chunks(const hsize_t* starts, const hsize_t* counts) {
+        std::vector<hsize_t> first(my_ndims), last(my_ndims);
+        for (size_t d = 0; d < my_ndims; ++d) {
+            first[d] = starts[d] / my_chunk_dimensions[d];
+            last[d] = (starts[d] + counts[d] - 1) / my_chunk_dimensions[d];
+        }
+
+        my_chunk_offsets.clear();
+        auto current = first;
+        while (true) {
+            for (size_t d = 0; d < my_ndims; ++d) {
+                my_chunk_offsets.push_back(current[d] * my_chunk_dimensions[d]);
+            }
+
+            size_t d = my_ndims;
+            for (; d > 0; --d) {
+                auto& x = current[d - 1];
+                if (x < last[d - 1]) {
+                    ++x;
+                    break;
+                }
+                x = first[d - 1];
+            }
+            if (d == 0) {
+                break;
+            }
+        }
+    }
+
+    // No HDF5 calls are allowed here as this runs outside of serialize().
+    void decode(Chunk& chunk) const {
+        size_t expected = my_chunk_elements * my_ftype_size;
+        internal::decode_chunk(my_filters, chunk.filter_mask, my_ftype_size, expected, chunk.raw, chunk.staging);
+
+        // Adding space for in-place conversion to a larger type.
+        chunk.decoded.resize(my_chunk_elements * std::max(my_ftype_size, sizeof(Type_)));
+        std::copy(chunk.raw.begin(), chunk.raw.end(), chunk.decoded.begin());
+    }
+
+    void copy_chunk(const hsize_t* offset, const Type_* chunk, const hsize_t* starts, const hsize_t* counts, Type_* output) const {
+        // Computing the overlap between the chunk and the requested hyperslab.
+        std::vector<hsize_t> lower(my_ndims), upper(my_ndims);
+        for (size_t d = 0; d < my_ndims; ++d) {
+            lower[d] = std::max(offset[d], starts[d]);
+            upper[d] = std::min(offset[d] + my_chunk_dimensions[d], starts[d] + counts[d]);
+        }
+
+        auto row_length = upper[my_ndims - 1] - lower[my_ndims - 1];
+        auto position = lower;
+        while (true) {
+            size_t chunk_index = 0, output_index = 0;
+            for (size_t d = 0; d < my_ndims; ++d) {
+                chunk_index = chunk_index * my_chunk_dimensions[d] + (position[d] - offset[d]);
+                output_index = output_index * counts[d] + (position[d] - starts[d]);
+            }
+            std::copy_n(chunk + chunk_index, row_length, output + output_index);
+
+            size_t d = my_ndims - 1;
+            for (; d > 0; --d) {
+                auto& x = position[d - 1];
+                ++x;
+                if (x < upper[d - 1]) {
+                    break;
+                }
+                x = lower[d - 1];
+            }
+            if (d == 0) {
+                break;
+            }
+        }
+    }
+
+    void read_unallocated(const hsize_t* offset, const hsize_t* starts, const hsize_t* counts, Type_* output) {
+        std::vector<hsize_t> lower(my_ndims), extent(my_ndims), mstart(my_ndims);
+        for (size_t d = 0; d < my_ndims; ++d) {
+            lower[d] = std::max(offset[d], starts[d]);
+            extent[d] = std::min(offset[d] + my_chunk_dimensions[d], starts[d] + counts[d]) - lower[d];
+            mstart[d] = lower[d] - starts[d];
+        }
+        my_fspace.selectHyperslab(H5S_SELECT_SET, extent.data(), lower.data());
+        H5::DataSpace mspace(my_ndims, counts);
+        mspace.selectHyperslab(H5S_SELECT_SET, extent.data(), mstart.data());
+        my_ptr->read(output, my_mtype, mspace, my_fspace);
+    }
+};
+
+/**
+ * @brief Stream a numeric 1-dimensional HDF5 dataset into memory with parallel decompression.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * This has the same interface as `Stream1dNumericDataset`, but each block is read via a `DirectChunkReader`.
+ * Blocks are chosen with `pick_1d_block_size()` so each block consists of multiple whole chunks that can be decompressed in parallel.
+ */
+template<typename Type_>
+class ParallelStream1dNumericDataset {
+public:
+    /**
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param length Length of the dataset as a 1-dimensional vector.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     * This should be large enough to span several chunks to benefit from parallelization.
+     * @param options Options for the `DirectChunkReader`.
+     */
+    ParallelStream1dNumericDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size, const DirectChunkReaderOptions& options) :
+        my_ptr(ptr),
+        my_full_length(length),
+        my_block_size(pick_1d_block_size(ptr->getCreatePlist(), my_full_length, buffer_size)),
+        my_reader(ptr, options),
+        my_buffer(my_block_size)
+    {}
+
+    /**
+     * Overloaded constructor where the length is automatically determined.
+     *
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     * @param options Options for the `DirectChunkReader`.
+     */
+    ParallelStream1dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size, const DirectChunkReaderOptions& options) :
+        ParallelStream1dNumericDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size, options)
+    {}
+
+public:
+    /**
+     * @return Value at the current position of the stream.
+     */
+    Type_ get() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return my_buffer[my_consumed];
+    }
+
+    /**
+     * @return Pair containing a pointer to and the length of an array.
+     * The array holds all loaded values of the stream at its current position, up to the specified length.
+     * Note that the pointer is only valid until the next invocation of `next()`.
+     */
+    std::pair<const Type_*, size_t> get_many() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return std::make_pair(my_buffer.data() + my_consumed, my_available - my_consumed);
+    }
+
+    /**
+     * Advance the position of the stream by `jump`.
+     *
+     * @param jump Number of positions by which to advance the stream.
+     */
+    void next(size_t jump = 1) {
+        my_consumed += jump;
+    }
+
+    /**
+     * @return Length of the dataset.
+     */
+    hsize_t length() const {
+        return my_full_length;
+    }
+
+    /**
+     * @return Current position on the stream.
+     */
+    hsize_t position() const {
+        return my_consumed + my_last_loaded - my_available;
+    }
+
+    /**
+     * @return Whether chunks are being read and decompressed directly, see `DirectChunkReader::is_direct()`.
+     */
+    bool is_direct() const {
+        return my_reader.is_direct();
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    hsize_t my_full_length, my_block_size;
+    DirectChunkReader<Type_> my_reader;
+    std::vector<Type_> my_buffer;
+
+    hsize_t my_last_loaded = 0;
+    hsize_t my_consumed = 0;
+    hsize_t my_available = 0;
+
+    void load() {
+        if (my_last_loaded >= my_full_length) {
+            throw std::runtime_error("requesting data beyond the end of the dataset at '" + get_name(*my_ptr) + "'");
+        }
+        my_available = std::min(my_full_length - my_last_loaded, my_block_size);
+        my_reader.read(&my_last_loaded, &my_available, my_buffer.data());
+        my_last_loaded += my_available;
+    }
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+struct ParallelStringWorkspace {
+    H5::DataSpace mspace, dspace;
+    VariableStringArena arena;
+    std::vector<char*> var_buffer;
+    std::vector<char> fix_buffer;
+    std::vector<size_t> fix_lengths;
+
+    std::vector<std::vector<unsigned char> > raw;
+    std::vector<uint32_t> masks;
+    std::vector<unsigned char> allocated;
+    std::vector<unsigned char> staging;
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Load a 1-dimensional string dataset into a vector of strings, using multiple threads.
+ * The dataset is partitioned into chunk-aligned blocks with `pick_1d_block_size()`, and contiguous ranges of blocks are assigned to worker threads via `parallelize()`.
+ * Each worker constructs its strings directly in their final positions in the output vector, so no extra copy is required to assemble the result.
+ *
+ * For fixed-length strings in datasets that only use the deflate and shuffle filters, raw chunks are fetched with `H5Dread_chunk()` inside `serialize()`,
+ * and then decompressed and decoded by each worker outside of the lock.
+ * Variable-length strings are stored as references into the global heap, so HDF5 must perform the decompression and heap lookups in `H5::DataSet::read()`;
+ * in this case, only the construction of the strings is parallelized.
+ * Unallocated chunks and other filter pipelines are also handled by the usual HDF5 read.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded strings in each worker.
+ * @param options Further options.
+ * @return Vector of strings, identical to the output of `load_1d_string_dataset()`.
+ */
+inline std::vector<std::string> parallel_load_1d_string_dataset(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, const DirectChunkReaderOptions& options) {
+    std::vector<std::string> output(full_length);
+    if (full_length == 0) {
+        return output;
+    }
+
+    size_t num_workers = std::max(options.num_threads, 1);
+    auto dtype = handle.getDataType();
+    bool is_variable = dtype.isVariableStr();
+    size_t width = (is_variable ? 0 : dtype.getSize());
+    auto cplist = handle.getCreatePlist();
+
+    // Making sure that there are enough blocks to keep all workers busy.
+    hsize_t per_worker = (full_length + num_workers - 1) / num_workers;
+    hsize_t block_size = pick_1d_block_size(cplist, full_length, std::max(static_cast<hsize_t>(1), std::min(buffer_size, per_worker)));
+    size_t num_blocks = (full_length + block_size - 1) / block_size;
+
+    // Direct chunk reads are only possible for fixed-length strings, see above.
+    bool direct = false;
+    hsize_t chunk_length = 0;
+    std::vector<H5Z_filter_t> filters;
+    if (!is_variable && cplist.getLayout() == H5D_CHUNKED) {
+        cplist.getChunk(1, &chunk_length);
+        direct = internal::get_direct_filters(cplist, filters);
+    }
+
+    // The HDF5 objects in each workspace are created and destroyed inside
+    // serialize(), as other threads may be making HDF5 calls at the same time.
+    std::vector<std::unique_ptr<internal::ParallelStringWorkspace> > workspaces;
+    workspaces.reserve(num_workers);
+    serialize([&]() -> void {
+        try {
+            for (size_t w = 0; w < num_workers; ++w) {
+                workspaces.emplace_back(new internal::ParallelStringWorkspace);
+                auto& work = *(workspaces.back());
+                work.mspace = H5::DataSpace(1, &block_size);
+                work.dspace = H5::DataSpace(1, &full_length);
+            }
+        } catch (...) {
+            workspaces.clear();
+            throw;
+        }
+    });
+
+    auto release = [&]() -> void {
+        serialize([&]() -> void {
+            workspaces.clear();
+        });
+    };
+
+    try {
+        parallelize(num_workers, num_blocks, [&](size_t w, size_t first_block, size_t nblocks) -> void {
+            auto& work = *(workspaces[w]);
+
+            for (size_t b = first_block, end = first_block + nblocks; b < end; ++b) {
+                hsize_t start = b * block_size;
+                hsize_t available = std::min(full_length - start, block_size);
+                auto optr = output.data() + start;
+
+                if (is_variable) {
+                    work.var_buffer.resize(available);
+                    bool has_null = false;
+                    serialize([&]() -> void {
+                        constexpr hsize_t zero = 0;
+                        work.mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+                        work.dspace.selectHyperslab(H5S_SELECT_SET, &available, &start);
+                        work.arena.reset();
+                        handle.read(work.var_buffer.data(), dtype, work.mspace, work.dspace, work.arena.transfer_plist());
+                    });
+
+                    for (hsize_t i = 0; i < available; ++i) {
+                        if (work.var_buffer[i] == NULL) {
+                            has_null = true;
+                            break;
+                        }
+                        optr[i].assign(work.var_buffer[i]);
+                    }
+
+                    if (has_null) {
+                        std::string name;
+                        serialize([&]() -> void {
+                            name = get_name(handle);
+                        });
+                        throw std::runtime_error("detected a NULL pointer for a variable length string in '" + name + "'");
+                    }
+                    continue;
+                }
+
+                work.fix_buffer.resize(available * width);
+                work.fix_lengths.resize(available);
+
+                if (!direct) {
+                    serialize([&]() -> void {
+                        constexpr hsize_t zero = 0;
+                        work.mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+                        work.dspace.selectHyperslab(H5S_SELECT_SET, &available, &start);
+                        handle.read(work.fix_buffer.data(), dtype, work.mspace, work.dspace);
+                    });
+
+                } else {
+                    hsize_t first_chunk = start / chunk_length;
+                    size_t nchunks = (start + available - 1) / chunk_length - first_chunk + 1;
+                    if (work.raw.size() < nchunks) {
+                        work.raw.resize(nchunks);
+                    }
+                    work.masks.resize(nchunks);
+                    work.allocated.resize(nchunks);
+
+                    serialize([&]() -> void {
+                        auto did = handle.getId();
+                        for (size_t c = 0; c < nchunks; ++c) {
+                            hsize_t offset = (first_chunk + c) * chunk_length;
+                            hsize_t nbytes = 0;
+                            herr_t status;
+                            H5E_BEGIN_TRY {
+                                status = H5Dget_chunk_storage_size(did, &offset, &nbytes);
+                            } H5E_END_TRY;
+                            work.allocated[c] = (status >= 0 && nbytes > 0);
+
+                            if (work.allocated[c]) {
+                                work.raw[c].resize(nbytes);
+                                if (H5Dread_chunk(did, H5P_DEFAULT, &offset, work.masks.data() + c, work.raw[c].data()) < 0) {
+                                    throw std::runtime_error("failed to read a raw chunk from '" + get_name(handle) + "'");
+                                }
+
+                            } else {
+                                // Deferring to HDF5 to fill in unallocated chunks.
+                                hsize_t lower = std::max(offset, start);
+                                hsize_t extent = std::min(offset + chunk_length, start + available) - lower;
+                                hsize_t mstart = lower - start;
+                                work.mspace.selectHyperslab(H5S_SELECT_SET, &extent, &mstart);
+                                work.dspace.selectHyperslab(H5S_SELECT_SET, &extent, &lower);
+                                handle.read(work.fix_buffer.data(), dtype, work.mspace, work.dspace);
+                            }
+                        }
+                    });
+
+                    for (size_t c = 0; c < nchunks; ++c) {
+                        if (!work.allocated[c]) {
+                            continue;
+                        }
+                        auto& raw = work.raw[c];
+                        internal::decode_chunk(filters, work.masks[c], width, chunk_length * width, raw, work.staging);
+                        hsize_t offset = (first_chunk + c) * chunk_length;
+                        hsize_t lower = std::max(offset, start);
+                        hsize_t upper = std::min(offset + chunk_length, start + available);
+                        std::copy(raw.begin() + (lower - offset) * width, raw.begin() + (upper - offset) * width, work.fix_buffer.begin() + (lower - start) * width);
+                    }
+                }
+
+                auto fptr = work.fix_buffer.data();
+                find_string_lengths(fptr, width, available, work.fix_lengths.data());
+                for (hsize_t i = 0; i < available; ++i, fptr += width) {
+                    optr[i].assign(fptr, work.fix_lengths[i]);
+                }
+            }
+        });
+    } catch (...) {
+        release();
+        throw;
+    }
+
+    release();
+    return output;
+}
+
+/**
+ * Overload of `parallel_load_1d_string_dataset()` that determines the length via `get_1d_length()`.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings in each worker.
+ * @param options Further options.
+ * @return Vector of strings.
+ */
+inline std::vector<std::string> parallel_load_1d_string_dataset(const H5::DataSet& handle, hsize_t buffer_size, const DirectChunkReaderOptions& options) {
+    return parallel_load_1d_string_dataset(handle, get_1d_length(handle, false), buffer_size, options);
+}
+
+}
+
+}
+
+#endif
@@ -5,8 +5,13 @@
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
 #include <cmath>
 
+#include "StreamStats.hpp"
+
 /**
  * @file IterateNdDataset.hpp
  * @brief Iterate through an N-dimensional dataset by block.
@@ -16,11 +21,84 @@ namespace ritsuko {
 
 namespace hdf5 {
 
+/**
+ * Order in which blocks are visited by `IterateNdDataset`.
+ */
+enum class IterationOrder : char {
+    /**
+     * Row-major order of blocks, where the last dimension changes fastest.
+     */
+    ROW_MAJOR,
+
+    /**
+     * Column-major order of blocks, where the first dimension changes fastest.
+     */
+    COLUMN_MAJOR,
+
+    /**
+     * Chunks are visited in row-major order, and all blocks starting within each chunk are visited before moving to the next chunk.
+     * This is useful when blocks are smaller than chunks, as each chunk only needs to be decompressed once if the cache can hold the chunks overlapping a single block.
+     */
+    CHUNK_GRID,
+
+    /**
+     * Chunks are visited along a Z-order (Morton) curve, and all blocks starting within each chunk are visited before moving to the next chunk.
+     * This keeps successive blocks close together in all dimensions, which reduces repeated decompression of chunks that are shared between misaligned blocks.
+     */
+    Z_ORDER
+};
+
+/**
+ * @brief Rectangular region of an N-dimensional dataset.
+ */
+struct NdRegion {
+    /**
+     * Starting coordinates of the region.
+     */
+    std::vector<hsize_t> starts;
+
+    /**
+     * Extent of the region along each dimension.
+     */
+    std::vector<hsize_t> counts;
+};
+
+/**
+ * @brief Options for `IterateNdDataset`.
+ */
+struct IterateNdDatasetOptions {
+    /**
+     * Order in which blocks are visited.
+     */
+    IterationOrder order = IterationOrder::ROW_MAJOR;
+
+    /**
+     * Dimensions of the chunks of the dataset, used by `IterationOrder::CHUNK_GRID` and `IterationOrder::Z_ORDER`.
+     * If empty, the block dimensions are used instead, i.e., each block is treated as its own chunk.
+     */
+    std::vector<hsize_t> chunk_dimensions;
+
+    /**
+     * Regions of interest to iterate over.
+     * Each region is iterated in turn, and blocks within each region are visited in the specified `order`.
+     * Overlapping regions are iterated independently, so elements in the overlap are visited multiple times.
+     * If empty, the entire dataset is used as a single region.
+     */
+    std::vector<NdRegion> regions;
+};
+
 /**
  * @brief Iterate through an N-dimensional dataset by block.
  *
  * This iterates through an N-dimensional dataset in a blockwise fashion, constructing `H5::DataSpace` objects to enable callers to easily read the dataset contents at each block.
  * Block sizes are typically determined from dataset chunking via `pick_nd_block_dimensions()`, which ensures efficient access of entire chunks at each step.
+ *
+ * By default, blocks are visited in row-major order.
+ * Other orders can be requested via `IterateNdDatasetOptions`, see `pick_nd_iteration_options()` to choose an order based on the chunk layout and chunk cache of the dataset.
+ *
+ * Iteration can also be restricted to one or more regions of interest via `IterateNdDatasetOptions::regions`.
+ * In such cases, block boundaries are still placed at multiples of the block dimensions and each block is clipped to the region.
+ * As the block dimensions are multiples of the chunk dimensions when obtained from `pick_nd_block_dimensions()`, each block only touches chunks that overlap the region.
  */
 struct IterateNdDataset {
     /**
@@ -44,6 +122,52 @@ struct IterateNdDataset {
         if (total_size) {
             dspace.selectHyperslab(H5S_SELECT_SET, counts_internal.data(), starts_internal.data());
             mspace.setExtentSimple(ndims, counts_internal.data());
+            recorder.record_block();
+        } else {
+            finished_internal = true;
+        }
+    }
+
+    /**
+     * @param d Dataset dimension extents.
+     * This should contain at least one value.
+     * @param b Block dimensions, typically obtained from `pick_nd_block_dimensions()`.
+     * This should be of the same length as `d`, where each value of `b` is no greater than its counterpart in `d`.
+     * @param options Further options, typically obtained from `pick_nd_iteration_options()`.
+     */
+    IterateNdDataset(std::vector<hsize_t> d, std::vector<hsize_t> b, const IterateNdDatasetOptions& options) : IterateNdDataset(std::move(d), std::move(b)) {
+        if (finished_internal || (options.order == IterationOrder::ROW_MAJOR && options.regions.empty())) {
+            return;
+        }
+
+        order_type_internal = options.order;
+        chunk_internal = (options.chunk_dimensions.empty() ? block_extent : options.chunk_dimensions);
+        if (chunk_internal.size() != ndims) {
+            throw std::runtime_error("chunk dimensions should have the same length as the dataset dimensions");
+        }
+
+        if (options.regions.empty()) {
+            regions_internal.push_back(NdRegion{ std::vector<hsize_t>(ndims), data_extent });
+        } else {
+            for (const auto& reg : options.regions) {
+                if (reg.starts.size() != ndims || reg.counts.size() != ndims) {
+                    throw std::runtime_error("region coordinates should have the same length as the dataset dimensions");
+                }
+                for (size_t i = 0; i < ndims; ++i) {
+                    if (reg.starts[i] > data_extent[i] || reg.counts[i] > data_extent[i] - reg.starts[i]) {
+                        throw std::runtime_error("region should lie within the dataset dimensions");
+                    }
+                }
+            }
+            regions_internal = options.regions;
+        }
+
+        // Restarting the statistics as the block from the delegated
+        // constructor may not be the first block.
+        ordered_internal = true;
+        recorder = StreamStatsRecorder();
+        if (start_region()) {
+            recorder.record_block();
         } else {
             finished_internal = true;
         }
@@ -54,6 +178,21 @@ struct IterateNdDataset {
      * This will modify the state of all references returned by the getters.
      */
     void next() {
+        if (ordered_internal) {
+            ++position_internal;
+            if (position_internal == num_region_blocks) {
+                ++region_index_internal;
+                if (!start_region()) {
+                    finished_internal = true;
+                    return;
+                }
+            } else {
+                set_block(order_internal.empty() ? position_internal : order_internal[position_internal]);
+            }
+            recorder.record_block();
+            return;
+        }
+
         // Attempting a shift from the last dimension as this is the fastest-changing.
         for (size_t i = ndims; i > 0; --i) {
             auto d = i - 1;
@@ -83,6 +222,127 @@ struct IterateNdDataset {
 
         dspace.selectHyperslab(H5S_SELECT_SET, counts_internal.data(), starts_internal.data());
         mspace.setExtentSimple(ndims, counts_internal.data());
+        recorder.record_block();
+    }
+
+private:
+    // Sets up the grid of blocks overlapping the current region (and all
+    // subsequent regions, if the current one is empty).
+    bool start_region() {
+        for (; region_index_internal < regions_internal.size(); ++region_index_internal) {
+            const auto& reg = regions_internal[region_index_internal];
+            grid_offset_internal.resize(ndims);
+            grid_internal.resize(ndims);
+            num_region_blocks = 1;
+            for (size_t i = 0; i < ndims; ++i) {
+                grid_offset_internal[i] = reg.starts[i] / block_extent[i];
+                if (reg.counts[i] == 0) {
+                    grid_internal[i] = 0; // regardless of whether the start is aligned.
+                } else {
+                    grid_internal[i] = (reg.starts[i] + reg.counts[i] + block_extent[i] - 1) / block_extent[i] - grid_offset_internal[i];
+                }
+                num_region_blocks *= grid_internal[i];
+            }
+            if (num_region_blocks) {
+                break;
+            }
+        }
+        if (region_index_internal == regions_internal.size()) {
+            return false;
+        }
+
+        position_internal = 0;
+        fill_order();
+        set_block(order_internal.empty() ? 0 : order_internal[0]);
+        return true;
+    }
+
+    // Storing the visiting order as row-major indices into the block grid
+    // of the current region. This is left empty for row-major order.
+    void fill_order() {
+        order_internal.clear();
+        if (order_type_internal == IterationOrder::ROW_MAJOR) {
+            return;
+        }
+
+        order_internal.resize(num_region_blocks);
+        std::iota(order_internal.begin(), order_internal.end(), 0);
+
+        if (order_type_internal == IterationOrder::COLUMN_MAJOR) {
+            std::vector<hsize_t> coords(ndims);
+            for (auto& o : order_internal) {
+                hsize_t index = 0;
+                for (size_t i = 0; i < ndims; ++i) {
+                    index = index * grid_internal[i] + coords[i];
+                }
+                o = index;
+
+                for (size_t i = 0; i < ndims; ++i) {
+                    ++coords[i];
+                    if (coords[i] < grid_internal[i]) {
+                        break;
+                    }
+                    coords[i] = 0;
+                }
+            }
+            return;
+        }
+
+        // Identifying the chunk containing the start of each block; blocks
+        // are then sorted by their chunk, with ties broken by the
+        // row-major order of the blocks themselves.
+        const auto& reg = regions_internal[region_index_internal];
+        std::vector<hsize_t> chunk_coords(num_region_blocks * ndims);
+        for (size_t b = 0; b < num_region_blocks; ++b) {
+            hsize_t remaining = b;
+            auto current = chunk_coords.data() + b * ndims;
+            for (size_t i = ndims; i > 0; --i) {
+                auto d = i - 1;
+                hsize_t start = std::max(reg.starts[d], (grid_offset_internal[d] + remaining % grid_internal[d]) * block_extent[d]);
+                current[d] = start / std::max(chunk_internal[d], static_cast<hsize_t>(1));
+                remaining /= grid_internal[d];
+            }
+        }
+
+        if (order_type_internal == IterationOrder::CHUNK_GRID) {
+            std::stable_sort(order_internal.begin(), order_internal.end(), [&](hsize_t left, hsize_t right) -> bool {
+                auto lptr = chunk_coords.data() + left * ndims, rptr = chunk_coords.data() + right * ndims;
+                return std::lexicographical_compare(lptr, lptr + ndims, rptr, rptr + ndims);
+            });
+        } else {
+            // Comparing Morton codes without computing them, by finding
+            // the dimension with the most significant differing bit.
+            std::stable_sort(order_internal.begin(), order_internal.end(), [&](hsize_t left, hsize_t right) -> bool {
+                auto lptr = chunk_coords.data() + left * ndims, rptr = chunk_coords.data() + right * ndims;
+                size_t best = 0;
+                hsize_t best_xor = 0;
+                for (size_t i = 0; i < ndims; ++i) {
+                    hsize_t x = lptr[i] ^ rptr[i];
+                    if (best_xor < x && best_xor < (x ^ best_xor)) {
+                        best = i;
+                        best_xor = x;
+                    }
+                }
+                return lptr[best] < rptr[best];
+            });
+        }
+    }
+
+    // Block boundaries are always multiples of the block dimensions, and are
+    // then clipped to the boundaries of the current region.
+    void set_block(hsize_t index) {
+        const auto& reg = regions_internal[region_index_internal];
+        total_size = 1;
+        for (size_t i = ndims; i > 0; --i) {
+            auto d = i - 1;
+            hsize_t block_start = (grid_offset_internal[d] + index % grid_internal[d]) * block_extent[d];
+            index /= grid_internal[d];
+            starts_internal[d] = std::max(reg.starts[d], block_start);
+            counts_internal[d] = std::min(reg.starts[d] + reg.counts[d], block_start + block_extent[d]) - starts_internal[d];
+            total_size *= counts_internal[d];
+        }
+        dspace.selectHyperslab(H5S_SELECT_SET, counts_internal.data(), starts_internal.data());
+        mspace.setExtentSimple(ndims, counts_internal.data());
     }
 
 public:
@@ -134,6 +394,14 @@ public:
         return mspace;
     }
 
+    /**
+     * @return Index of the region containing the current block, see `IterateNdDatasetOptions::regions`.
+     * This is always zero if no regions were supplied.
+     */
+    size_t current_region() const {
+        return region_index_internal;
+    }
+
     /**
      * @return Dimensions of the dataset, as provided in the constructor.
      */
@@ -148,6 +416,15 @@ public:
         return block_extent;
     }
 
+    /**
+     * @return Statistics for this iteration, where `StreamStats::blocks_loaded` is the number of blocks visited so far.
+     * Callers performing the reads can accumulate their own statistics into a separate `StreamStatsRecorder`.
+     * All counters are zero unless `RITSUKO_HDF5_STREAM_STATS` is defined.
+     */
+    StreamStats stats() const {
+        return recorder.get();
+    }
+
 private:
     std::vector<hsize_t> data_extent, block_extent;
     size_t ndims;
@@ -156,8 +433,181 @@ private:
     H5::DataSpace mspace, dspace;
     bool finished_internal = false;
     size_t total_size = 1;
+    StreamStatsRecorder recorder;
+
+    bool ordered_internal = false;
+    IterationOrder order_type_internal = IterationOrder::ROW_MAJOR;
+    std::vector<hsize_t> chunk_internal;
+    std::vector<NdRegion> regions_internal;
+    size_t region_index_internal = 0;
+    std::vector<hsize_t> grid_offset_internal, grid_internal, order_internal;
+    size_t num_region_blocks = 0, position_internal = 0;
 };
 
+/**
+ * Choose an iteration order for `IterateNdDataset`, based on the chunk layout and the chunk cache of a dataset.
+ *
+ * - If the dataset is not chunked, or if the block boundaries are aligned to the chunk grid, each chunk is only accessed by a single block.
+ *   In such cases, `IterationOrder::ROW_MAJOR` is used.
+ * - If row-major iteration would only revisit chunks that still fit in the dataset's chunk cache, `IterationOrder::ROW_MAJOR` is also used.
+ *   For this calculation, the relevant chunks are those spanning the faster-changing dimensions of the dataset, within the slowest-changing dimension where blocks and chunks are misaligned.
+ * - Otherwise, if blocks are smaller than chunks in each misaligned dimension, `IterationOrder::CHUNK_GRID` is used so that all blocks in a chunk are visited together.
+ * - Otherwise, `IterationOrder::Z_ORDER` is used to maximize the locality of successive blocks.
+ *
+ * @param handle Handle to the dataset.
+ * @param dimensions Dimensions of the dataset.
+ * @param blocks Block dimensions, typically obtained from `pick_nd_block_dimensions()`.
+ *
+ * @return Options for `IterateNdDataset`, with the chosen order and the chunk dimensions of the dataset.
+ */
+inline IterateNdDatasetOptions pick_nd_iteration_options(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, const std::vector<hsize_t>& blocks) {
+    IterateNdDatasetOptions output;
+    auto cplist = handle.getCreatePlist();
+    if (cplist.getLayout() != H5D_CHUNKED) {
+        return output;
+    }
+
+    size_t ndims = dimensions.size();
+    output.chunk_dimensions.resize(ndims);
+    cplist.getChunk(ndims, output.chunk_dimensions.data());
+    const auto& chunks = output.chunk_dimensions;
+
+    // Misalignment in the last dimension is harmless as the shared chunks are
+    // immediately reused by the next block, so we only look at the others.
+    size_t slowest = ndims;
+    bool small_blocks = true;
+    for (size_t d = 0; d + 1 < ndims; ++d) {
+        if (blocks[d] % chunks[d] != 0 && blocks[d] < dimensions[d]) {
+            if (slowest == ndims) {
+                slowest = d;
+            }
+            if (blocks[d] > chunks[d]) {
+                small_blocks = false;
+            }
+        }
+    }
+    if (slowest == ndims) {
+        return output;
+    }
+
+    // Number of chunks that need to be cached in row-major order before the
+    // misaligned chunks in the slowest dimension are revisited.
+    double required = handle.getDataType().getSize();
+    for (size_t d = 0; d < ndims; ++d) {
+        if (d < slowest) {
+            required *= (std::min(blocks[d], dimensions[d]) + chunks[d] - 1) / chunks[d];
+        } else if (d > slowest) {
+            required *= (dimensions[d] + chunks[d] - 1) / chunks[d];
+        }
+        required *= chunks[d];
+    }
+
+    size_t nslots, nbytes;
+    double w0;
+    handle.getAccessPlist().getChunkCache(nslots, nbytes, w0);
+    if (required > static_cast<double>(nbytes)) {
+        output.order = (small_blocks ? IterationOrder::CHUNK_GRID : IterationOrder::Z_ORDER);
+    }
+
+    return output;
+}
+
+/**
+ * Convert sets of indices along each dimension into regions for `IterateNdDatasetOptions::regions`.
+ * Each set of indices is compressed into runs, and a region is created for each combination of runs across dimensions.
+ * For example, this can be used to read a subset of rows and columns of a 2-dimensional dataset.
+ *
+ * The number of regions is equal to the product of the number of runs in each dimension.
+ * This can be large for scattered indices, e.g., 1000 isolated rows and 1000 isolated columns yield a million 1-by-1 regions, each of which is read separately.
+ * To mitigate this, a run is extended across a gap between indices if both indices lie in the same chunk along that dimension.
+ * The number of runs along each dimension is then no greater than the number of chunks that it spans.
+ * The gaps are read and should be discarded by the caller, which is cheap as each chunk needs to be decompressed in its entirety anyway.
+ *
+ * @param indices Vector of length equal to the number of dimensions, containing the indices to extract along each dimension.
+ * Indices need not be sorted or unique.
+ * @param chunk_dimensions Dimensions of the chunks of the dataset, e.g., from `pick_nd_iteration_options()`.
+ * If empty, e.g., for contiguous datasets, only consecutive indices are combined into runs.
+ * Otherwise, this should have the same length as `indices`.
+ *
+ * @return Vector of regions covering the Cartesian product of the indices.
+ * Regions are ordered by their starting coordinates in row-major order.
+ */
+inline std::vector<NdRegion> indices_to_nd_regions(std::vector<std::vector<hsize_t> > indices, const std::vector<hsize_t>& chunk_dimensions) {
+    size_t ndims = indices.size();
+    if (!chunk_dimensions.empty() && chunk_dimensions.size() != ndims) {
+        throw std::runtime_error("chunk dimensions should have the same length as the indices");
+    }
+
+    std::vector<std::vector<std::pair<hsize_t, hsize_t> > > runs(ndims);
+    size_t num_regions = 1;
+    for (size_t d = 0; d < ndims; ++d) {
+        auto& current = indices[d];
+        std::sort(current.begin(), current.end());
+        current.erase(std::unique(current.begin(), current.end()), current.end());
+
+        hsize_t chunk = (chunk_dimensions.empty() ? 1 : chunk_dimensions[d]);
+        auto& dim_runs = runs[d];
+        for (auto i : current) {
+            if (!dim_runs.empty()) {
+                auto& last = dim_runs.back();
+                hsize_t end = last.first + last.second;
+                if (end == i || (chunk > 1 && (end - 1) / chunk == i / chunk)) {
+                    last.second = i - last.first + 1;
+                    continue;
+                }
+            }
+            dim_runs.emplace_back(i, 1);
+        }
+        num_regions *= dim_runs.size();
+    }
+
+    std::vector<NdRegion> output;
+    if (ndims == 0 || num_regions == 0) {
+        return output;
+    }
+
+    output.reserve(num_regions);
+    std::vector<size_t> position(ndims);
+    while (true) {
+        NdRegion reg;
+        reg.starts.resize(ndims);
+        reg.counts.resize(ndims);
+        for (size_t d = 0; d < ndims; ++d) {
+            const auto& run = runs[d][position[d]];
+            reg.starts[d] = run.first;
+            reg.counts[d] = run.second;
+        }
+        output.push_back(std::move(reg));
+
+        size_t d = ndims;
+        for (; d > 0; --d) {
+            auto& p = position[d - 1];
+            ++p;
+            if (p < runs[d - 1].size()) {
+                break;
+            }
+            p = 0;
+        }
+        if (d == 0) {
+            break;
+        }
+    }
+
+    return output;
+}
+
+/**
+ * Overload of `indices_to_nd_regions()` that only combines consecutive indices into runs.
+ *
+ * @param indices Vector of length equal to the number of dimensions, containing the indices to extract along each dimension.
+ * Indices need not be sorted or unique.
+ *
+ * @return Vector of regions covering the Cartesian product of the indices.
+ */
+inline std::vector<NdRegion> indices_to_nd_regions(std::vector<std::vector<hsize_t> > indices) {
+    return indices_to_nd_regions(std::move(indices), std::vector<hsize_t>());
+}
+
 }
 
 }
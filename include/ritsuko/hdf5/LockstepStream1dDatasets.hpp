@@ -0,0 +1,362 @@
+#ifndef RITSUKO_HDF5_LOCKSTEP_STREAM_1D_DATASETS_HPP
+#define RITSUKO_HDF5_LOCKSTEP_STREAM_1D_DATASETS_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+#include "../parallelize.hpp"
+#include "serialize.hpp"
+#include "pick_1d_block_size.hpp"
+#include "get_1d_length.hpp"
+#include "get_name.hpp"
+#include "NumericBlockReader.hpp"
+#include "utils_string.hpp"
+
+/**
+ * @file LockstepStream1dDatasets.hpp
+ * @brief Stream multiple 1-dimensional HDF5 datasets in lockstep.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for `LockstepStream1dDatasets`.
+ */
+struct LockstepStream1dDatasetsOptions {
+    /**
+     * Number of threads to use for loading blocks from different datasets.
+     * All HDF5 calls are made inside `serialize()`, so multiple threads only improve performance if the HDF5 library is thread-safe (see `RITSUKO_HDF5_NO_PARALLEL_LOCK`)
+     * or if substantial post-processing is required, e.g., for fixed-length strings.
+     * Non-positive values are treated as 1.
+     */
+    int num_threads = 1;
+};
+
+/**
+ * @brief Stream multiple 1-dimensional HDF5 datasets in lockstep.
+ * @tparam Type_ Type to represent numeric data in memory.
+ *
+ * This streams in a set of 1-dimensional datasets of the same length, e.g., the columns of a data frame.
+ * Each dataset may contain either numbers or strings.
+ * All datasets are loaded in contiguous blocks of the same size, as chosen by `pick_shared_1d_block_size()` to align with the chunk boundaries of all datasets where possible.
+ * Callers can then process the datasets row-wise, using views that are aligned across datasets.
+ */
+template<typename Type_>
+class LockstepStream1dDatasets {
+public:
+    /**
+     * @param ptrs Pointers to 1-dimensional HDF5 datasets, each containing numbers or strings.
+     * @param length Length of each dataset as a 1-dimensional vector.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values from each dataset.
+     * @param options Further options.
+     */
+    LockstepStream1dDatasets(std::vector<const H5::DataSet*> ptrs, hsize_t length, hsize_t buffer_size, const LockstepStream1dDatasetsOptions& options) :
+        my_full_length(length),
+        my_num_threads(std::max(options.num_threads, 1))
+    {
+        std::vector<H5::DSetCreatPropList> cplists;
+        cplists.reserve(ptrs.size());
+        for (auto ptr : ptrs) {
+            cplists.push_back(ptr->getCreatePlist());
+        }
+        my_block_size = pick_shared_1d_block_size(cplists, my_full_length, buffer_size);
+
+        my_columns.reserve(ptrs.size());
+        for (auto ptr : ptrs) {
+            my_columns.emplace_back(new Column(ptr, my_full_length, my_block_size));
+        }
+    }
+
+    /**
+     * Overloaded constructor where the length is automatically determined.
+     * An error is raised if the datasets do not have the same length.
+     *
+     * @param ptrs Pointers to 1-dimensional HDF5 datasets, each containing numbers or strings.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values from each dataset.
+     * @param options Further options.
+     */
+    LockstepStream1dDatasets(std::vector<const H5::DataSet*> ptrs, hsize_t buffer_size, const LockstepStream1dDatasetsOptions& options) :
+        LockstepStream1dDatasets(ptrs, check_lengths(ptrs), buffer_size, options)
+    {}
+
+    /**
+     * Overloaded constructor with default options.
+     *
+     * @param ptrs Pointers to 1-dimensional HDF5 datasets, each containing numbers or strings.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values from each dataset.
+     */
+    LockstepStream1dDatasets(std::vector<const H5::DataSet*> ptrs, hsize_t buffer_size) :
+        LockstepStream1dDatasets(std::move(ptrs), buffer_size, LockstepStream1dDatasetsOptions())
+    {}
+
+public:
+    /**
+     * @return Number of datasets.
+     */
+    size_t num_datasets() const {
+        return my_columns.size();
+    }
+
+    /**
+     * @param i Index of the dataset.
+     * @return Whether the `i`-th dataset contains strings.
+     */
+    bool is_string(size_t i) const {
+        return my_columns[i]->is_string;
+    }
+
+    /**
+     * @param i Index of a numeric dataset.
+     * @return Value of the `i`-th dataset at the current position of the stream.
+     */
+    Type_ get_number(size_t i) {
+        ensure_loaded();
+        return my_columns[i]->numbers[my_consumed];
+    }
+
+    /**
+     * @param i Index of a string dataset.
+     * @return String of the `i`-th dataset at the current position of the stream.
+     */
+    std::string get_string(size_t i) {
+        return std::string(get_string_view(i));
+    }
+
+    /**
+     * @param i Index of a string dataset.
+     * @return View of the string of the `i`-th dataset at the current position of the stream.
+     * This does not allocate any memory but is only valid until the next invocation of `next()`.
+     */
+    std::string_view get_string_view(size_t i) {
+        ensure_loaded();
+        return my_columns[i]->strings[my_consumed];
+    }
+
+    /**
+     * Load the block containing the current position of the stream, if it has not already been loaded.
+     *
+     * @return Number of rows that are available in the loaded blocks from the current position of the stream.
+     * These rows can be accessed via `numbers()` and `strings()`.
+     */
+    size_t get_many() {
+        ensure_loaded();
+        return my_available - my_consumed;
+    }
+
+    /**
+     * This should only be called after `get_many()`.
+     *
+     * @param i Index of a numeric dataset.
+     * @return Pointer to the values of the `i`-th dataset, starting from the current position of the stream.
+     * This contains the number of rows reported by `get_many()`, and is only valid until the next invocation of `next()`.
+     */
+    const Type_* numbers(size_t i) const {
+        return my_columns[i]->numbers.data() + my_consumed;
+    }
+
+    /**
+     * This should only be called after `get_many()`.
+     *
+     * @param i Index of a string dataset.
+     * @return Pointer to views of the strings of the `i`-th dataset, starting from the current position of the stream.
+     * This contains the number of rows reported by `get_many()`, and is only valid until the next invocation of `next()`.
+     * Each view refers to the block buffer for that dataset, so no memory is allocated for individual strings.
+     */
+    const std::string_view* strings(size_t i) const {
+        return my_columns[i]->strings.data() + my_consumed;
+    }
+
+    /**
+     * Advance the position of the stream by `jump`.
+     *
+     * @param jump Number of positions by which to advance the stream.
+     */
+    void next(size_t jump = 1) {
+        my_consumed += jump;
+    }
+
+    /**
+     * @return Length of each dataset.
+     */
+    hsize_t length() const {
+        return my_full_length;
+    }
+
+    /**
+     * @return Current position on the stream.
+     */
+    hsize_t position() const {
+        return my_consumed + my_last_loaded - my_available;
+    }
+
+    /**
+     * @return Size of the blocks that are loaded from each dataset.
+     */
+    hsize_t block_size() const {
+        return my_block_size;
+    }
+
+private:
+    struct Column {
+        Column(const H5::DataSet* ptr, hsize_t full_length, hsize_t block_size) :
+            ptr(ptr),
+            mspace(1, &block_size),
+            dspace(1, &full_length)
+        {
+            auto tclass = ptr->getTypeClass();
+            if (tclass == H5T_STRING) {
+                is_string = true;
+                dtype = ptr->getDataType();
+                is_variable = dtype.isVariableStr();
+                if (is_variable) {
+                    var_buffer.resize(block_size);
+                    var_lengths.resize(block_size);
+                } else {
+                    fixed_length = dtype.getSize();
+                    fix_buffer.resize(fixed_length * block_size);
+                    fix_lengths.resize(block_size);
+                }
+                strings.resize(block_size);
+
+            } else if (tclass == H5T_INTEGER || tclass == H5T_FLOAT) {
+                reader.reset(new NumericBlockReader<Type_>(ptr));
+                numbers.resize(block_size);
+
+            } else {
+                throw std::runtime_error("expected a numeric or string dataset at '" + get_name(*ptr) + "'");
+            }
+        }
+
+        const H5::DataSet* ptr;
+        H5::DataSpace mspace;
+        H5::DataSpace dspace;
+
+        bool is_string = false;
+        std::unique_ptr<NumericBlockReader<Type_> > reader;
+        std::vector<Type_> numbers;
+
+        H5::DataType dtype;
+        bool is_variable = false;
+        std::vector<char*> var_buffer;
+        std::vector<size_t> var_lengths;
+        std::vector<char> var_arena;
+        size_t fixed_length = 0;
+        std::vector<char> fix_buffer;
+        std::vector<size_t> fix_lengths;
+        std::vector<std::string_view> strings;
+    };
+
+    hsize_t my_full_length, my_block_size;
+    size_t my_num_threads;
+    std::vector<std::unique_ptr<Column> > my_columns;
+
+    hsize_t my_last_loaded = 0;
+    hsize_t my_consumed = 0;
+    hsize_t my_available = 0;
+
+    static hsize_t check_lengths(const std::vector<const H5::DataSet*>& ptrs) {
+        if (ptrs.empty()) {
+            return 0;
+        }
+        hsize_t length = get_1d_length(ptrs.front()->getSpace(), false);
+        for (size_t i = 1; i < ptrs.size(); ++i) {
+            if (get_1d_length(ptrs[i]->getSpace(), false) != length) {
+                throw std::runtime_error("expected '" + get_name(*(ptrs[i])) + "' to have the same length as '" + get_name(*(ptrs.front())) + "'");
+            }
+        }
+        return length;
+    }
+
+    void ensure_loaded() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+    }
+
+    void load() {
+        if (my_last_loaded >= my_full_length) {
+            throw std::runtime_error("requesting data beyond the end of the datasets");
+        }
+        my_available = std::min(my_full_length - my_last_loaded, my_block_size);
+
+        parallelize(my_num_threads, my_columns.size(), [&](size_t, size_t start, size_t length) -> void {
+            for (size_t c = start, end = start + length; c < end; ++c) {
+                load_column(*(my_columns[c]));
+            }
+        });
+
+        my_last_loaded += my_available;
+    }
+
+    // All HDF5 calls must be made inside serialize() as this may run on a worker thread.
+    void load_column(Column& col) const {
+        bool has_null = false;
+        serialize([&]() -> void {
+            constexpr hsize_t zero = 0;
+            col.mspace.selectHyperslab(H5S_SELECT_SET, &my_available, &zero);
+            col.dspace.selectHyperslab(H5S_SELECT_SET, &my_available, &my_last_loaded);
+
+            if (!col.is_string) {
+                col.reader->read(col.numbers.data(), my_available, col.mspace, col.dspace);
+            } else if (col.is_variable) {
+                col.ptr->read(col.var_buffer.data(), col.dtype, col.mspace, col.dspace);
+                [[maybe_unused]] VariableStringCleaner deletor(col.dtype.getId(), col.mspace.getId(), col.var_buffer.data());
+
+                // Packing all strings into a single arena so that they
+                // outlive the reclamation of HDF5's buffers.
+                size_t total = 0;
+                for (hsize_t i = 0; i < my_available; ++i) {
+                    if (col.var_buffer[i] == NULL) {
+                        has_null = true;
+                        return;
+                    }
+                    col.var_lengths[i] = std::strlen(col.var_buffer[i]);
+                    total += col.var_lengths[i];
+                }
+
+                col.var_arena.resize(total);
+                auto aptr = col.var_arena.data();
+                for (hsize_t i = 0; i < my_available; ++i) {
+                    auto len = col.var_lengths[i];
+                    std::copy_n(col.var_buffer[i], len, aptr);
+                    col.strings[i] = std::string_view(aptr, len);
+                    aptr += len;
+                }
+            } else {
+                col.ptr->read(col.fix_buffer.data(), col.dtype, col.mspace, col.dspace);
+            }
+        });
+
+        if (has_null) {
+            std::string name;
+            serialize([&]() -> void {
+                name = get_name(*(col.ptr));
+            });
+            throw std::runtime_error("detected a NULL pointer for a variable length string in '" + name + "'");
+        }
+
+        if (col.is_string && !col.is_variable) {
+            auto bptr = col.fix_buffer.data();
+            find_string_lengths(bptr, col.fixed_length, my_available, col.fix_lengths.data());
+            for (hsize_t i = 0; i < my_available; ++i, bptr += col.fixed_length) {
+                col.strings[i] = std::string_view(bptr, col.fix_lengths[i]);
+            }
+        }
+    }
+};
+
+}
+
+}
+
+#endif
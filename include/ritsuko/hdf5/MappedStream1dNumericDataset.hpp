@@ -0,0 +1,314 @@
+#ifndef RITSUKO_HDF5_MAPPED_STREAM_1D_NUMERIC_DATASET_HPP
+#define RITSUKO_HDF5_MAPPED_STREAM_1D_NUMERIC_DATASET_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RITSUKO_HDF5_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "pick_1d_block_size.hpp"
+#include "get_1d_length.hpp"
+#include "get_name.hpp"
+#include "NumericBlockReader.hpp"
+
+/**
+ * @file MappedStream1dNumericDataset.hpp
+ * @brief Stream a numeric 1-dimensional HDF5 dataset via memory mapping.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Stream a numeric 1-dimensional HDF5 dataset via memory mapping.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * For contiguous datasets without any filters or external storage, the raw values are stored at a single location in the file, as reported by `H5Dget_offset()`.
+ * In such cases, this class memory-maps the relevant region of the file, bypassing the HDF5 read pipeline altogether.
+ * If the file datatype is identical to the in-memory representation of `Type_`, `get_many()` returns a zero-copy view of the entire remaining dataset.
+ * If the file datatype only differs in its byte order, values are byte-swapped in blocks into an internal buffer.
+ *
+ * In all other cases (e.g., chunked or filtered datasets, type conversions, non-POSIX systems, files that do not use the default `sec2` driver, files opened for writing),
+ * this class falls back to the same block-wise reads via `NumericBlockReader` as `Stream1dNumericDataset`.
+ * The file is mapped through the descriptor held by HDF5's `sec2` driver, and only if the file is large enough to contain the entire dataset.
+ * Callers can check which path is used via `is_mapped()`.
+ *
+ * The file should not be modified while the stream is active, as the memory-mapped region will not be synchronized with HDF5's view of the dataset.
+ */
+template<typename Type_>
+class MappedStream1dNumericDataset {
+public:
+    /**
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param length Length of the dataset as a 1-dimensional vector.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     * This is only used when byte-swapping is required or in the fallback mode.
+     */
+    MappedStream1dNumericDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size) :
+        my_ptr(ptr),
+        my_full_length(length),
+        my_block_size(pick_1d_block_size(ptr->getCreatePlist(), my_full_length, buffer_size)),
+        my_mspace(1, &my_block_size),
+        my_dspace(1, &my_full_length),
+        my_reader(ptr)
+    {
+        map();
+        if (!my_mapped || my_swap) {
+            my_buffer.resize(my_block_size);
+        }
+    }
+
+    /**
+     * Overloaded constructor where the length is automatically determined.
+     *
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     */
+    MappedStream1dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size) :
+        MappedStream1dNumericDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size)
+    {}
+
+    /**
+     * @cond
+     */
+    MappedStream1dNumericDataset(const MappedStream1dNumericDataset&) = delete;
+    MappedStream1dNumericDataset& operator=(const MappedStream1dNumericDataset&) = delete;
+
+    ~MappedStream1dNumericDataset() {
+#ifdef RITSUKO_HDF5_HAS_MMAP
+        if (my_map_start) {
+            munmap(my_map_start, my_map_length);
+        }
+#endif
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Value at the current position of the stream.
+     */
+    Type_ get() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return my_current[my_consumed];
+    }
+
+    /**
+     * @return Pair containing a pointer to and the length of an array.
+     * The array holds all loaded values of the stream at its current position, up to the specified length.
+     * In the zero-copy mode, this contains all remaining values in the dataset.
+     * Note that the pointer is only valid until the next invocation of `next()`.
+     */
+    std::pair<const Type_*, size_t> get_many() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return std::make_pair(my_current + my_consumed, my_available - my_consumed);
+    }
+
+    /**
+     * Advance the position of the stream by `jump`.
+     *
+     * @param jump Number of positions by which to advance the stream.
+     */
+    void next(size_t jump = 1) {
+        my_consumed += jump;
+    }
+
+    /**
+     * @return Length of the dataset.
+     */
+    hsize_t length() const {
+        return my_full_length;
+    }
+
+    /**
+     * @return Current position on the stream.
+     */
+    hsize_t position() const {
+        return my_consumed + my_last_loaded - my_available;
+    }
+
+    /**
+     * @return Whether the dataset is being read from a memory-mapped region of the file.
+     */
+    bool is_mapped() const {
+        return my_mapped;
+    }
+
+    /**
+     * @return Whether the values are being byte-swapped from the memory-mapped region.
+     * Only relevant if `is_mapped()` is true, otherwise it is always false.
+     */
+    bool is_swapped() const {
+        return my_swap;
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    hsize_t my_full_length, my_block_size;
+    H5::DataSpace my_mspace;
+    H5::DataSpace my_dspace;
+    NumericBlockReader<Type_> my_reader;
+    std::vector<Type_> my_buffer;
+    const Type_* my_current = NULL;
+
+    bool my_mapped = false;
+    bool my_swap = false;
+    void* my_map_start = NULL;
+    size_t my_map_length = 0;
+    const unsigned char* my_data = NULL;
+
+    hsize_t my_last_loaded = 0;
+    hsize_t my_consumed = 0;
+    hsize_t my_available = 0;
+
+    void map() {
+#ifdef RITSUKO_HDF5_HAS_MMAP
+        if (my_full_length == 0) {
+            return;
+        }
+
+        auto cplist = my_ptr->getCreatePlist();
+        if (cplist.getLayout() != H5D_CONTIGUOUS || cplist.getNfilters() != 0 || cplist.getExternalCount() != 0) {
+            return;
+        }
+
+        auto tclass = my_ptr->getTypeClass();
+        if (tclass != H5T_INTEGER && tclass != H5T_FLOAT) {
+            return;
+        }
+        auto ftype = my_ptr->getDataType();
+        int status = internal::compare_to_native<Type_>(ftype.getId());
+        if (status == 0) {
+            return;
+        }
+        my_swap = (status < 0);
+
+        haddr_t address;
+        H5E_BEGIN_TRY {
+            address = H5Dget_offset(my_ptr->getId());
+        } H5E_END_TRY;
+        if (address == HADDR_UNDEF) { // i.e., storage has not been allocated yet.
+            my_swap = false;
+            return;
+        }
+
+        // Only the default driver guarantees that the file on disk has the same
+        // layout as HDF5's address space. We also skip files opened for writing,
+        // as pending writes might not yet be visible in the file.
+        hid_t fid = H5Iget_file_id(my_ptr->getId());
+        hid_t fapl = H5Fget_access_plist(fid);
+        bool is_sec2 = (H5Pget_driver(fapl) == H5FD_SEC2);
+        H5Pclose(fapl);
+
+        unsigned intent = 0;
+        H5Fget_intent(fid, &intent);
+
+        // Using the driver's own descriptor, so that we are guaranteed to map
+        // the same file that HDF5 has open, regardless of the path.
+        int fd = -1;
+        if (is_sec2 && !(intent & H5F_ACC_RDWR)) {
+            void* handle = NULL;
+            herr_t err;
+            H5E_BEGIN_TRY {
+                err = H5Fget_vfd_handle(fid, H5P_DEFAULT, &handle);
+            } H5E_END_TRY;
+            if (err >= 0 && handle) {
+                fd = *static_cast<int*>(handle);
+            }
+        }
+        H5Fclose(fid);
+        if (fd < 0) {
+            my_swap = false;
+            return;
+        }
+
+        // H5Dget_offset() already includes the user block, if any.
+        size_t start = address;
+        size_t nbytes = my_full_length * sizeof(Type_);
+
+        // Avoiding a SIGBUS from mapping beyond the end of a truncated file.
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < start + nbytes) {
+            my_swap = false;
+            return;
+        }
+
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t aligned_start = (start / page) * page;
+        my_map_length = nbytes + (start - aligned_start);
+        void* mapped = mmap(NULL, my_map_length, PROT_READ, MAP_PRIVATE, fd, aligned_start);
+        if (mapped == MAP_FAILED) {
+            my_swap = false;
+            return;
+        }
+
+        my_map_start = mapped;
+        my_data = static_cast<const unsigned char*>(mapped) + (start - aligned_start);
+        my_mapped = true;
+
+        // Zero-copy views require an appropriately aligned address; otherwise
+        // we copy out the values in blocks, same as if we were swapping.
+        if (!my_swap && reinterpret_cast<uintptr_t>(my_data) % alignof(Type_) != 0) {
+            my_buffer.resize(my_block_size);
+        }
+#endif
+    }
+
+    void load() {
+        if (my_last_loaded >= my_full_length) {
+            throw std::runtime_error("requesting data beyond the end of the dataset at '" + get_name(*my_ptr) + "'");
+        }
+
+        if (my_mapped) {
+            const unsigned char* src = my_data + my_last_loaded * sizeof(Type_);
+            if (my_buffer.empty()) {
+                my_available = my_full_length - my_last_loaded;
+                my_current = reinterpret_cast<const Type_*>(src);
+            } else {
+                my_available = std::min(my_full_length - my_last_loaded, my_block_size);
+                unsigned char* dest = reinterpret_cast<unsigned char*>(my_buffer.data());
+                std::memcpy(dest, src, my_available * sizeof(Type_));
+                if (my_swap) {
+                    swap_bytes(dest, my_available, sizeof(Type_));
+                }
+                my_current = my_buffer.data();
+            }
+
+        } else {
+            my_available = std::min(my_full_length - my_last_loaded, my_block_size);
+            constexpr hsize_t zero = 0;
+            my_mspace.selectHyperslab(H5S_SELECT_SET, &my_available, &zero);
+            my_dspace.selectHyperslab(H5S_SELECT_SET, &my_available, &my_last_loaded);
+            my_reader.read(my_buffer.data(), my_available, my_mspace, my_dspace);
+            my_current = my_buffer.data();
+        }
+
+        my_last_loaded += my_available;
+    }
+};
+
+}
+
+}
+
+#endif
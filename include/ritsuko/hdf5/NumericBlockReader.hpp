@@ -0,0 +1,310 @@
+#ifndef RITSUKO_HDF5_NUMERIC_BLOCK_READER_HPP
+#define RITSUKO_HDF5_NUMERIC_BLOCK_READER_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "as_numeric_datatype.hpp"
+#include "StreamStats.hpp"
+
+/**
+ * @file NumericBlockReader.hpp
+ * @brief Read blocks of numeric data with in-library type conversion.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * Fixed-width numeric types that can be converted by **ritsuko** without going through HDF5's conversion machinery.
+ */
+enum class NativeNumericType : char { NONE, INT8, UINT8, INT16, UINT16, INT32, UINT32, INT64, UINT64, FLOAT, DOUBLE };
+
+/**
+ * @brief Identity of a file datatype in terms of a native numeric type.
+ */
+struct FileNumericType {
+    /**
+     * Native numeric type with the same representation as the file datatype, possibly after byte-swapping.
+     * This is set to `NativeNumericType::NONE` if the file datatype has no native counterpart.
+     */
+    NativeNumericType type = NativeNumericType::NONE;
+
+    /**
+     * Whether the file datatype has the opposite byte order to its native counterpart.
+     */
+    bool swapped = false;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+template<typename Type_>
+int compare_to_native(hid_t ftype) {
+    const auto& mtype = as_numeric_datatype<Type_>();
+    if (H5Tequal(ftype, mtype.getId()) > 0) {
+        return 1;
+    }
+    if (sizeof(Type_) == 1) {
+        return 0;
+    }
+    hid_t swapped = H5Tcopy(mtype.getId());
+    H5Tset_order(swapped, H5Tget_order(swapped) == H5T_ORDER_LE ? H5T_ORDER_BE : H5T_ORDER_LE);
+    bool same = H5Tequal(ftype, swapped) > 0;
+    H5Tclose(swapped);
+    return (same ? -1 : 0);
+}
+
+template<typename Type_>
+bool identify_native(hid_t ftype, NativeNumericType code, FileNumericType& output) {
+    int status = compare_to_native<Type_>(ftype);
+    if (status == 0) {
+        return false;
+    }
+    output.type = code;
+    output.swapped = (status < 0);
+    return true;
+}
+
+template<class Function_>
+void dispatch_native_type(NativeNumericType type, Function_ fun) {
+    switch (type) {
+        case NativeNumericType::INT8: fun(static_cast<int8_t*>(NULL)); break;
+        case NativeNumericType::UINT8: fun(static_cast<uint8_t*>(NULL)); break;
+        case NativeNumericType::INT16: fun(static_cast<int16_t*>(NULL)); break;
+        case NativeNumericType::UINT16: fun(static_cast<uint16_t*>(NULL)); break;
+        case NativeNumericType::INT32: fun(static_cast<int32_t*>(NULL)); break;
+        case NativeNumericType::UINT32: fun(static_cast<uint32_t*>(NULL)); break;
+        case NativeNumericType::INT64: fun(static_cast<int64_t*>(NULL)); break;
+        case NativeNumericType::UINT64: fun(static_cast<uint64_t*>(NULL)); break;
+        case NativeNumericType::FLOAT: fun(static_cast<float*>(NULL)); break;
+        case NativeNumericType::DOUBLE: fun(static_cast<double*>(NULL)); break;
+        default: break;
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Identify the native numeric type with the same representation as a HDF5 datatype.
+ *
+ * @param ftype HDF5 datatype, typically the datatype of a dataset in the file.
+ * @return Identity of the native counterpart of `ftype`.
+ */
+inline FileNumericType identify_native_numeric_type(const H5::DataType& ftype) {
+    FileNumericType output;
+    auto tclass = ftype.getClass();
+    hid_t fid = ftype.getId();
+
+    if (tclass == H5T_INTEGER) {
+        internal::identify_native<int8_t>(fid, NativeNumericType::INT8, output) ||
+            internal::identify_native<uint8_t>(fid, NativeNumericType::UINT8, output) ||
+            internal::identify_native<int16_t>(fid, NativeNumericType::INT16, output) ||
+            internal::identify_native<uint16_t>(fid, NativeNumericType::UINT16, output) ||
+            internal::identify_native<int32_t>(fid, NativeNumericType::INT32, output) ||
+            internal::identify_native<uint32_t>(fid, NativeNumericType::UINT32, output) ||
+            internal::identify_native<int64_t>(fid, NativeNumericType::INT64, output) ||
+            internal::identify_native<uint64_t>(fid, NativeNumericType::UINT64, output);
+    } else if (tclass == H5T_FLOAT) {
+        internal::identify_native<float>(fid, NativeNumericType::FLOAT, output) ||
+            internal::identify_native<double>(fid, NativeNumericType::DOUBLE, output);
+    }
+
+    return output;
+}
+
+/**
+ * Check whether a conversion between two arithmetic types preserves all values of the source type.
+ * Such conversions cannot overflow, so they yield the same results as HDF5's conversion routines regardless of the exception handling settings.
+ *
+ * @tparam From_ Source type.
+ * @tparam To_ Destination type.
+ * @return Whether all values of `From_` can be exactly represented by `To_`.
+ */
+template<typename From_, typename To_>
+constexpr bool is_value_preserving_conversion() {
+    typedef std::numeric_limits<From_> FromLimits;
+    typedef std::numeric_limits<To_> ToLimits;
+
+    if constexpr(std::is_integral<From_>::value && std::is_integral<To_>::value) {
+        if constexpr(FromLimits::is_signed && !ToLimits::is_signed) {
+            return false;
+        } else {
+            return FromLimits::digits <= ToLimits::digits;
+        }
+    } else if constexpr(std::is_integral<From_>::value && std::is_floating_point<To_>::value) {
+        return FromLimits::digits <= ToLimits::digits;
+    } else if constexpr(std::is_floating_point<From_>::value && std::is_floating_point<To_>::value) {
+        return FromLimits::digits <= ToLimits::digits && FromLimits::max_exponent <= ToLimits::max_exponent;
+    } else {
+        return false;
+    }
+}
+
+/**
+ * Reverse the byte order of each element in an array.
+ *
+ * @param[in,out] data Pointer to an array of `number * width` bytes.
+ * @param number Number of elements.
+ * @param width Width of each element in bytes.
+ */
+inline void swap_bytes(unsigned char* data, size_t number, size_t width) {
+    // Dispatching to fixed widths so that the compiler can vectorize each loop.
+    auto swapper = [&](auto width_constant) -> void {
+        constexpr size_t w = decltype(width_constant)::value;
+        for (size_t i = 0; i < number; ++i, data += w) {
+            for (size_t b = 0; b < w / 2; ++b) {
+                std::swap(data[b], data[w - b - 1]);
+            }
+        }
+    };
+
+    switch (width) {
+        case 1: break;
+        case 2: swapper(std::integral_constant<size_t, 2>()); break;
+        case 4: swapper(std::integral_constant<size_t, 4>()); break;
+        case 8: swapper(std::integral_constant<size_t, 8>()); break;
+        default:
+            for (size_t i = 0; i < number; ++i, data += width) {
+                std::reverse(data, data + width);
+            }
+    }
+}
+
+/**
+ * Convert an array of numbers from one type to another.
+ * This is written as a simple loop over non-aliasing pointers so that the compiler can auto-vectorize it,
+ * e.g., with SIMD widening instructions for integers or integer-to-float conversions.
+ *
+ * @tparam From_ Source type.
+ * @tparam To_ Destination type.
+ * @param[in] input Pointer to an array of `number` values.
+ * @param number Number of values.
+ * @param[out] output Pointer to an array of length `number`, which should not overlap with `input`.
+ */
+template<typename From_, typename To_>
+void convert_numeric_values(const From_* __restrict input, size_t number, To_* __restrict output) {
+    for (size_t i = 0; i < number; ++i) {
+        output[i] = static_cast<To_>(input[i]);
+    }
+}
+
+/**
+ * @brief Read blocks of numeric data with in-library type conversion.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * HDF5's type conversion routines operate on generic datatypes and are relatively slow for simple conversions, e.g., from 16-bit integers to `double`s.
+ * Instead, this class reads the data in its native file representation into a staging buffer, and then performs the byte-swapping and conversion in **ritsuko**.
+ * This is only done for value-preserving conversions (see `is_value_preserving_conversion()`) so that the results are the same as those of HDF5.
+ * Otherwise, HDF5 is asked to convert the data directly into `as_numeric_datatype<Type_>()`, as before.
+ */
+template<typename Type_>
+class NumericBlockReader {
+public:
+    /**
+     * @param ptr Pointer to a HDF5 dataset.
+     */
+    NumericBlockReader(const H5::DataSet* ptr) : my_ptr(ptr) {
+        auto tclass = my_ptr->getTypeClass();
+        if (tclass != H5T_INTEGER && tclass != H5T_FLOAT) {
+            return;
+        }
+
+        my_ftype = my_ptr->getDataType();
+        auto identity = identify_native_numeric_type(my_ftype);
+        internal::dispatch_native_type(identity.type, [&](auto tag) -> void {
+            typedef typename std::remove_pointer<decltype(tag)>::type From;
+            if constexpr(is_value_preserving_conversion<From, Type_>()) {
+                my_in_library = !(std::is_same<From, Type_>::value && !identity.swapped);
+                my_file_type = identity;
+                my_file_size = sizeof(From);
+            }
+        });
+    }
+
+public:
+    /**
+     * @return Whether type conversions are performed by **ritsuko**.
+     * If `false`, no conversion is required or HDF5 is performing the conversion.
+     */
+    bool is_in_library() const {
+        return my_in_library;
+    }
+
+    /**
+     * Read a block of data into memory.
+     *
+     * @param[out] output Pointer to an array of length no less than `number`.
+     * @param number Number of selected elements in `mspace` and `dspace`.
+     * @param mspace Dataspace for the output array.
+     * This should select the first `number` elements of a 1-dimensional dataspace.
+     * If `is_in_library()` is `false`, this may instead be any selection of `number` elements in the output array.
+     * @param dspace Dataspace for the file, containing the selection to be extracted.
+     * @param recorder Recorder for the I/O statistics of the calling stream.
+     */
+    void read(Type_* output, hsize_t number, const H5::DataSpace& mspace, const H5::DataSpace& dspace, StreamStatsRecorder& recorder) {
+        if (!my_in_library) {
+            recorder.record_read(number, number * sizeof(Type_), [&]() -> void {
+                my_ptr->read(output, as_numeric_datatype<Type_>(), mspace, dspace);
+            });
+            return;
+        }
+
+        my_staging.resize(number * my_file_size);
+        auto sptr = my_staging.data();
+        recorder.record_read(number, my_staging.size(), [&]() -> void {
+            my_ptr->read(sptr, my_ftype, mspace, dspace);
+        });
+
+        recorder.record_conversion([&]() -> void {
+            if (my_file_type.swapped) {
+                swap_bytes(sptr, number, my_file_size);
+            }
+            internal::dispatch_native_type(my_file_type.type, [&](auto tag) -> void {
+                typedef typename std::remove_pointer<decltype(tag)>::type From;
+                if constexpr(is_value_preserving_conversion<From, Type_>()) {
+                    convert_numeric_values(reinterpret_cast<const From*>(sptr), number, output);
+                }
+            });
+        });
+    }
+
+    /**
+     * Overload of `read()` that does not record any statistics.
+     *
+     * @param[out] output Pointer to an array of length no less than `number`.
+     * @param number Number of selected elements in `mspace` and `dspace`.
+     * @param mspace Dataspace for the output array.
+     * @param dspace Dataspace for the file, containing the selection to be extracted.
+     */
+    void read(Type_* output, hsize_t number, const H5::DataSpace& mspace, const H5::DataSpace& dspace) {
+        StreamStatsRecorder recorder;
+        read(output, number, mspace, dspace, recorder);
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    H5::DataType my_ftype;
+    FileNumericType my_file_type;
+    size_t my_file_size = 0;
+    bool my_in_library = false;
+    std::vector<unsigned char> my_staging;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef RITSUKO_HDF5_RANDOM_ACCESS_1D_NUMERIC_DATASET_HPP
+#define RITSUKO_HDF5_RANDOM_ACCESS_1D_NUMERIC_DATASET_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "pick_1d_block_size.hpp"
+#include "get_1d_length.hpp"
+#include "get_name.hpp"
+#include "as_numeric_datatype.hpp"
+#include "NumericBlockReader.hpp"
+
+/**
+ * @file RandomAccess1dNumericDataset.hpp
+ * @brief Random access to a numeric 1-dimensional HDF5 dataset.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Random access to a numeric 1-dimensional HDF5 dataset.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * This provides random access to the elements of a 1-dimensional HDF5 numeric dataset without loading the entire dataset into memory.
+ * The dataset is partitioned into contiguous blocks with sizes defined by `pick_1d_block_size()`, so each block is aligned to the dataset's chunks.
+ * Blocks are loaded on demand and held in a least-recently-used cache, such that repeated accesses to nearby elements do not require another read from file.
+ */
+template<typename Type_>
+class RandomAccess1dNumericDataset {
+public:
+    /**
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param length Length of the dataset as a 1-dimensional vector.
+     * @param buffer_size Size of each cached block, in terms of the number of elements.
+     * Larger blocks reduce the number of reads at the cost of some memory efficiency.
+     * @param cache_size Maximum number of blocks to hold in the cache.
+     * This should be positive.
+     */
+    RandomAccess1dNumericDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size, size_t cache_size) :
+        my_ptr(ptr),
+        my_full_length(length),
+        my_block_size(pick_1d_block_size(ptr->getCreatePlist(), my_full_length, buffer_size)),
+        my_cache_size(std::max(cache_size, static_cast<size_t>(1))),
+        my_mspace(1, &my_block_size),
+        my_dspace(1, &my_full_length),
+        my_reader(ptr)
+    {}
+
+    /**
+     * Overloaded constructor where the length is automatically determined.
+     *
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param buffer_size Size of each cached block, in terms of the number of elements.
+     * @param cache_size Maximum number of blocks to hold in the cache.
+     */
+    RandomAccess1dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size, size_t cache_size = 10) :
+        RandomAccess1dNumericDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size, cache_size)
+    {}
+
+public:
+    /**
+     * @param i Index of the element of interest.
+     * This should be less than `length()`.
+     * @return Value of the `i`-th element of the dataset.
+     */
+    Type_ operator[](hsize_t i) {
+        check_index(i);
+        const auto& block = fetch(i / my_block_size);
+        return block[i % my_block_size];
+    }
+
+    /**
+     * Extract a contiguous range of elements into a user-supplied array.
+     *
+     * @param start Index of the first element of the range.
+     * @param end Index of one-past-the-last element of the range.
+     * This should be no less than `start` and no greater than `length()`.
+     * @param[out] output Pointer to an array of length no less than `end - start`.
+     * On return, this is filled with the values of the range.
+     */
+    void range(hsize_t start, hsize_t end, Type_* output) {
+        if (start > end || end > my_full_length) {
+            throw std::runtime_error("requested range is out of bounds for the dataset at '" + get_name(*my_ptr) + "'");
+        }
+
+        while (start < end) {
+            auto block_index = start / my_block_size;
+            auto block_start = block_index * my_block_size;
+            auto block_end = std::min(block_start + my_block_size, end);
+            const auto& block = fetch(block_index);
+            output = std::copy(block.begin() + (start - block_start), block.begin() + (block_end - block_start), output);
+            start = block_end;
+        }
+    }
+
+    /**
+     * Overload of `range()` that returns a vector.
+     *
+     * @param start Index of the first element of the range.
+     * @param end Index of one-past-the-last element of the range.
+     * @return Vector containing the values of the range.
+     */
+    std::vector<Type_> range(hsize_t start, hsize_t end) {
+        std::vector<Type_> output(end >= start ? end - start : 0);
+        range(start, end, output.data());
+        return output;
+    }
+
+    /**
+     * Extract an arbitrary set of elements into a user-supplied array.
+     * Indices are processed in order of their blocks, so each block only needs to be looked up once per call,
+     * regardless of the ordering of `indices` or the size of the cache.
+     *
+     * @param number Number of indices.
+     * @param indices Pointer to an array of length `number`, containing the indices of the elements of interest.
+     * Each index should be less than `length()`.
+     * Indices may be unsorted and/or duplicated.
+     * @param[out] output Pointer to an array of length `number`.
+     * On return, `output[i]` is filled with the value of the element at `indices[i]`.
+     */
+    void gather(size_t number, const hsize_t* indices, Type_* output) {
+        for (size_t i = 0; i < number; ++i) {
+            check_index(indices[i]);
+        }
+
+        // Only creating a permutation if the indices are not already sorted.
+        bool sorted = std::is_sorted(indices, indices + number);
+        if (!sorted) {
+            my_order.resize(number);
+            std::iota(my_order.begin(), my_order.end(), static_cast<size_t>(0));
+            std::sort(my_order.begin(), my_order.end(), [&](size_t l, size_t r) -> bool { return indices[l] < indices[r]; });
+        }
+
+        size_t i = 0;
+        while (i < number) {
+            size_t first = (sorted ? i : my_order[i]);
+            auto block_index = indices[first] / my_block_size;
+            auto block_start = block_index * my_block_size;
+            auto block_end = block_start + my_block_size;
+            const auto& block = fetch(block_index);
+
+            do {
+                size_t current = (sorted ? i : my_order[i]);
+                auto idx = indices[current];
+                if (idx >= block_end) {
+                    break;
+                }
+                output[current] = block[idx - block_start];
+                ++i;
+            } while (i < number);
+        }
+    }
+
+    /**
+     * Overload of `gather()` that accepts and returns vectors.
+     *
+     * @param indices Vector of indices of the elements of interest, see the other `gather()` overload for details.
+     * @return Vector of length equal to `indices`, containing the value of each element at `indices`.
+     */
+    std::vector<Type_> gather(const std::vector<hsize_t>& indices) {
+        std::vector<Type_> output(indices.size());
+        gather(indices.size(), indices.data(), output.data());
+        return output;
+    }
+
+public:
+    /**
+     * @return Length of the dataset.
+     */
+    hsize_t length() const {
+        return my_full_length;
+    }
+
+    /**
+     * @return Size of each block, in terms of the number of elements.
+     */
+    hsize_t block_size() const {
+        return my_block_size;
+    }
+
+    /**
+     * @return Number of block lookups that were satisfied by the cache.
+     */
+    size_t hits() const {
+        return my_hits;
+    }
+
+    /**
+     * @return Number of block lookups that required a read from file.
+     */
+    size_t misses() const {
+        return my_misses;
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    hsize_t my_full_length, my_block_size;
+    size_t my_cache_size;
+    H5::DataSpace my_mspace;
+    H5::DataSpace my_dspace;
+    NumericBlockReader<Type_> my_reader;
+
+    struct CachedBlock {
+        hsize_t index;
+        std::vector<Type_> values;
+    };
+
+    // Most recently used blocks are at the front of the list.
+    std::list<CachedBlock> my_cache;
+    std::unordered_map<hsize_t, typename std::list<CachedBlock>::iterator> my_cache_map;
+
+    std::vector<size_t> my_order;
+    size_t my_hits = 0;
+    size_t my_misses = 0;
+
+    void check_index(hsize_t i) const {
+        if (i >= my_full_length) {
+            throw std::runtime_error("requesting data beyond the end of the dataset at '" + get_name(*my_ptr) + "'");
+        }
+    }
+
+    const std::vector<Type_>& fetch(hsize_t block_index) {
+        auto it = my_cache_map.find(block_index);
+        if (it != my_cache_map.end()) {
+            ++my_hits;
+            auto lit = it->second;
+            if (lit != my_cache.begin()) {
+                my_cache.splice(my_cache.begin(), my_cache, lit);
+            }
+            return lit->values;
+        }
+
+        ++my_misses;
+        if (my_cache.size() < my_cache_size) {
+            my_cache.emplace_front();
+            my_cache.front().values.resize(my_block_size);
+        } else {
+            // Recycling the least recently used block's memory.
+            my_cache_map.erase(my_cache.back().index);
+            my_cache.splice(my_cache.begin(), my_cache, std::prev(my_cache.end()));
+        }
+
+        // Invalidating the index until the read succeeds, so that a failed
+        // read doesn't leave behind a cache entry with garbage contents.
+        auto& current = my_cache.front();
+        current.index = static_cast<hsize_t>(-1);
+
+        hsize_t start = block_index * my_block_size;
+        hsize_t available = std::min(my_full_length - start, my_block_size);
+        constexpr hsize_t zero = 0;
+        my_mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+        my_dspace.selectHyperslab(H5S_SELECT_SET, &available, &start);
+        my_reader.read(current.values.data(), available, my_mspace, my_dspace);
+
+        current.index = block_index;
+        my_cache_map[block_index] = my_cache.begin();
+        return current.values;
+    }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,335 @@
+#ifndef RITSUKO_HDF5_RANDOM_ACCESS_2D_NUMERIC_DATASET_HPP
+#define RITSUKO_HDF5_RANDOM_ACCESS_2D_NUMERIC_DATASET_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "pick_nd_block_dimensions.hpp"
+#include "get_dimensions.hpp"
+#include "get_name.hpp"
+#include "NumericBlockReader.hpp"
+
+/**
+ * @file RandomAccess2dNumericDataset.hpp
+ * @brief Extract rows and columns from a numeric 2-dimensional HDF5 dataset.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Extract rows and columns from a numeric 2-dimensional HDF5 dataset.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * This extracts individual rows or columns (or batches thereof) from a 2-dimensional HDF5 numeric dataset, where the first dimension is treated as the rows.
+ * The dataset is partitioned into blocks with dimensions defined by `pick_nd_block_dimensions()`, so each block is aligned to the dataset's chunks.
+ * Blocks are decoded on demand and held in a least-recently-used cache with a maximum size in bytes.
+ * This avoids repeated decompression when successive slices pass through the same chunks, even if HDF5's own chunk cache is too small to hold a full row of chunks.
+ *
+ * Requests for multiple slices are processed in order of their blocks, so each block only needs to be looked up once per call,
+ * regardless of the ordering of the requested indices or the size of the cache.
+ * The cache hit rate can be monitored with `hits()` and `misses()` to tune the cache size.
+ */
+template<typename Type_>
+class RandomAccess2dNumericDataset {
+public:
+    /**
+     * @param ptr Pointer to a 2-dimensional HDF5 dataset.
+     * @param buffer_size Size of each cached block, in terms of the number of elements, see `pick_nd_block_dimensions()`.
+     * @param cache_size Maximum size of the cache, in bytes.
+     * At least one block is always cached, even if it exceeds this limit.
+     */
+    RandomAccess2dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size, size_t cache_size) :
+        my_ptr(ptr),
+        my_dimensions(get_dimensions(*ptr, false)),
+        my_reader(ptr)
+    {
+        if (my_dimensions.size() != 2) {
+            throw std::runtime_error("expected a 2-dimensional dataset at '" + get_name(*my_ptr) + "'");
+        }
+
+        my_block_dimensions = pick_nd_block_dimensions(ptr->getCreatePlist(), my_dimensions, buffer_size);
+        size_t block_bytes = std::max(my_block_dimensions[0] * my_block_dimensions[1], static_cast<hsize_t>(1)) * sizeof(Type_);
+        my_cache_size = std::max(cache_size / block_bytes, static_cast<size_t>(1));
+        for (size_t d = 0; d < 2; ++d) {
+            my_grid[d] = (my_block_dimensions[d] ? (my_dimensions[d] + my_block_dimensions[d] - 1) / my_block_dimensions[d] : 0);
+        }
+
+        my_dspace = H5::DataSpace(2, my_dimensions.data());
+    }
+
+    /**
+     * Overloaded constructor with a default cache size of 64 MiB.
+     *
+     * @param ptr Pointer to a 2-dimensional HDF5 dataset.
+     * @param buffer_size Size of each cached block, in terms of the number of elements.
+     */
+    RandomAccess2dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size = 10000) :
+        RandomAccess2dNumericDataset(ptr, buffer_size, 67108864)
+    {}
+
+public:
+    /**
+     * Extract a set of rows into a user-supplied array.
+     * Neighboring rows in the same block are extracted together, so each block is only decoded once per call.
+     *
+     * @param number Number of rows.
+     * @param indices Pointer to an array of length `number`, containing the indices of the rows of interest.
+     * Each index should be less than `nrow()`.
+     * Indices may be unsorted and/or duplicated.
+     * @param[out] output Pointer to an array of length `number * ncol()`.
+     * On return, the row at `indices[i]` is stored at `output + i * ncol()`.
+     */
+    void rows(size_t number, const hsize_t* indices, Type_* output) {
+        extract(0, number, indices, output);
+    }
+
+    /**
+     * Extract a set of columns into a user-supplied array.
+     * Neighboring columns in the same block are extracted together, so each block is only decoded once per call.
+     *
+     * @param number Number of columns.
+     * @param indices Pointer to an array of length `number`, containing the indices of the columns of interest.
+     * Each index should be less than `ncol()`.
+     * Indices may be unsorted and/or duplicated.
+     * @param[out] output Pointer to an array of length `number * nrow()`.
+     * On return, the column at `indices[i]` is stored at `output + i * nrow()`.
+     */
+    void columns(size_t number, const hsize_t* indices, Type_* output) {
+        extract(1, number, indices, output);
+    }
+
+    /**
+     * Overload of `rows()` that accepts and returns vectors.
+     *
+     * @param indices Vector of indices of the rows of interest, see the other `rows()` overload for details.
+     * @return Vector of length equal to `indices.size() * ncol()`, containing the requested rows in row-major order.
+     */
+    std::vector<Type_> rows(const std::vector<hsize_t>& indices) {
+        std::vector<Type_> output(indices.size() * my_dimensions[1]);
+        rows(indices.size(), indices.data(), output.data());
+        return output;
+    }
+
+    /**
+     * Overload of `columns()` that accepts and returns vectors.
+     *
+     * @param indices Vector of indices of the columns of interest, see the other `columns()` overload for details.
+     * @return Vector of length equal to `indices.size() * nrow()`, containing the requested columns in column-major order.
+     */
+    std::vector<Type_> columns(const std::vector<hsize_t>& indices) {
+        std::vector<Type_> output(indices.size() * my_dimensions[0]);
+        columns(indices.size(), indices.data(), output.data());
+        return output;
+    }
+
+    /**
+     * @param i Index of the row of interest.
+     * This should be less than `nrow()`.
+     * @param[out] output Pointer to an array of length `ncol()`.
+     * On return, this is filled with the values of the row.
+     */
+    void row(hsize_t i, Type_* output) {
+        rows(1, &i, output);
+    }
+
+    /**
+     * @param j Index of the column of interest.
+     * This should be less than `ncol()`.
+     * @param[out] output Pointer to an array of length `nrow()`.
+     * On return, this is filled with the values of the column.
+     */
+    void column(hsize_t j, Type_* output) {
+        columns(1, &j, output);
+    }
+
+public:
+    /**
+     * @return Number of rows in the dataset.
+     */
+    hsize_t nrow() const {
+        return my_dimensions[0];
+    }
+
+    /**
+     * @return Number of columns in the dataset.
+     */
+    hsize_t ncol() const {
+        return my_dimensions[1];
+    }
+
+    /**
+     * @return Dimensions of each block.
+     */
+    const std::vector<hsize_t>& block_dimensions() const {
+        return my_block_dimensions;
+    }
+
+    /**
+     * @return Maximum number of blocks in the cache.
+     */
+    size_t cache_capacity() const {
+        return my_cache_size;
+    }
+
+    /**
+     * @return Number of block lookups that were satisfied by the cache.
+     */
+    size_t hits() const {
+        return my_hits;
+    }
+
+    /**
+     * @return Number of block lookups that required a read from file.
+     */
+    size_t misses() const {
+        return my_misses;
+    }
+
+    /**
+     * @return Proportion of block lookups that were satisfied by the cache.
+     * This is zero if no lookups have been performed.
+     */
+    double hit_rate() const {
+        size_t total = my_hits + my_misses;
+        return (total ? static_cast<double>(my_hits) / total : 0);
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    std::vector<hsize_t> my_dimensions, my_block_dimensions;
+    hsize_t my_grid[2];
+    size_t my_cache_size;
+    H5::DataSpace my_mspace;
+    H5::DataSpace my_dspace;
+    NumericBlockReader<Type_> my_reader;
+
+    struct CachedBlock {
+        hsize_t index;
+        std::vector<Type_> values;
+    };
+
+    // Most recently used blocks are at the front of the list.
+    std::list<CachedBlock> my_cache;
+    std::unordered_map<hsize_t, typename std::list<CachedBlock>::iterator> my_cache_map;
+
+    std::vector<size_t> my_order;
+    size_t my_hits = 0;
+    size_t my_misses = 0;
+
+    // 'dim' is the dimension along which the slices are taken, i.e., 0 for
+    // rows and 1 for columns.
+    void extract(int dim, size_t number, const hsize_t* indices, Type_* output) {
+        hsize_t limit = my_dimensions[dim];
+        for (size_t i = 0; i < number; ++i) {
+            if (indices[i] >= limit) {
+                throw std::runtime_error("requesting a " + std::string(dim == 0 ? "row" : "column") + " beyond the end of the dataset at '" + get_name(*my_ptr) + "'");
+            }
+        }
+
+        // Only creating a permutation if the indices are not already sorted.
+        bool sorted = std::is_sorted(indices, indices + number);
+        if (!sorted) {
+            my_order.resize(number);
+            std::iota(my_order.begin(), my_order.end(), static_cast<size_t>(0));
+            std::sort(my_order.begin(), my_order.end(), [&](size_t l, size_t r) -> bool { return indices[l] < indices[r]; });
+        }
+
+        int other = 1 - dim;
+        hsize_t slice_length = my_dimensions[other];
+        hsize_t block_extent = my_block_dimensions[dim];
+        hsize_t other_extent = my_block_dimensions[other];
+
+        size_t i = 0;
+        while (i < number) {
+            // Finding all requested slices in the same block along 'dim'.
+            size_t first = (sorted ? i : my_order[i]);
+            hsize_t block_along = indices[first] / block_extent;
+            hsize_t block_start = block_along * block_extent;
+            hsize_t block_end = block_start + block_extent;
+            size_t group_end = i;
+            while (group_end < number && indices[sorted ? group_end : my_order[group_end]] < block_end) {
+                ++group_end;
+            }
+
+            for (hsize_t b = 0; b < my_grid[other]; ++b) {
+                hsize_t block_index = (dim == 0 ? block_along * my_grid[1] + b : b * my_grid[1] + block_along);
+                const auto& block = fetch(block_index);
+                hsize_t other_start = b * other_extent;
+                hsize_t other_count = std::min(slice_length - other_start, other_extent);
+                hsize_t ncol = (dim == 0 ? other_count : std::min(my_dimensions[1] - block_start, block_extent));
+
+                for (size_t g = i; g < group_end; ++g) {
+                    size_t current = (sorted ? g : my_order[g]);
+                    hsize_t offset = indices[current] - block_start;
+                    auto optr = output + current * slice_length + other_start;
+                    if (dim == 0) {
+                        auto bptr = block.data() + offset * ncol;
+                        std::copy_n(bptr, other_count, optr);
+                    } else {
+                        auto bptr = block.data() + offset;
+                        for (hsize_t k = 0; k < other_count; ++k) {
+                            optr[k] = bptr[k * ncol];
+                        }
+                    }
+                }
+            }
+
+            i = group_end;
+        }
+    }
+
+    const std::vector<Type_>& fetch(hsize_t block_index) {
+        auto it = my_cache_map.find(block_index);
+        if (it != my_cache_map.end()) {
+            ++my_hits;
+            auto lit = it->second;
+            if (lit != my_cache.begin()) {
+                my_cache.splice(my_cache.begin(), my_cache, lit);
+            }
+            return lit->values;
+        }
+
+        ++my_misses;
+        if (my_cache.size() < my_cache_size) {
+            my_cache.emplace_front();
+            my_cache.front().values.resize(my_block_dimensions[0] * my_block_dimensions[1]);
+        } else {
+            // Recycling the least recently used block's memory.
+            my_cache_map.erase(my_cache.back().index);
+            my_cache.splice(my_cache.begin(), my_cache, std::prev(my_cache.end()));
+        }
+
+        // Invalidating the index until the read succeeds, so that a failed
+        // read doesn't leave behind a cache entry with garbage contents.
+        auto& current = my_cache.front();
+        current.index = static_cast<hsize_t>(-1);
+
+        hsize_t starts[2], counts[2];
+        starts[0] = (block_index / my_grid[1]) * my_block_dimensions[0];
+        starts[1] = (block_index % my_grid[1]) * my_block_dimensions[1];
+        for (size_t d = 0; d < 2; ++d) {
+            counts[d] = std::min(my_dimensions[d] - starts[d], my_block_dimensions[d]);
+        }
+        my_mspace.setExtentSimple(2, counts);
+        my_dspace.selectHyperslab(H5S_SELECT_SET, counts, starts);
+        my_reader.read(current.values.data(), counts[0] * counts[1], my_mspace, my_dspace);
+
+        current.index = block_index;
+        my_cache_map[block_index] = my_cache.begin();
+        return current.values;
+    }
+};
+
+}
+
+}
+
+#endif
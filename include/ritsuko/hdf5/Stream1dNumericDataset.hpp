@@ -5,11 +5,14 @@
 
 #include <vector>
 #include <stdexcept>
+#include <memory>
 
 #include "pick_1d_block_size.hpp"
 #include "get_1d_length.hpp"
 #include "get_name.hpp"
 #include "as_numeric_datatype.hpp"
+#include "NumericBlockReader.hpp"
+#include "StreamStats.hpp"
 
 /**
  * @file Stream1dNumericDataset.hpp
@@ -23,11 +26,12 @@ namespace hdf5 {
 /**
  * @brief Stream a numeric 1-dimensional HDF5 dataset into memory.
  * @tparam Type_ Type to represent the data in memory.
+ * @tparam Allocator_ Allocator for the block buffer, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
  *
  * This streams in a 1-dimensional HDF5 numeric dataset in contiguous blocks, using block sizes defined by `pick_1d_block_size()`.
  * Callers can then extract one value at a time or they can acquire the entire block.
  */
-template<typename Type_>
+template<typename Type_, class Allocator_ = std::allocator<Type_> >
 class Stream1dNumericDataset {
 public:
     /**
@@ -35,24 +39,29 @@ public:
      * @param length Length of the dataset as a 1-dimensional vector.
      * @param buffer_size Size of the buffer for holding streamed blocks of values.
      * Larger buffers improve speed at the cost of some memory efficiency.
+     * @param allocator Allocator for the block buffer.
      */
-    Stream1dNumericDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size) : 
+    Stream1dNumericDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
         ptr(ptr), 
         full_length(length), 
         block_size(pick_1d_block_size(ptr->getCreatePlist(), full_length, buffer_size)),
         mspace(1, &block_size),
         dspace(1, &full_length),
-        buffer(block_size)
-    {}
+        buffer(block_size, allocator),
+        reader(ptr)
+    {
+        recorder.record_allocation(buffer.size() * sizeof(Type_));
+    }
 
     /**
      * Overloaded constructor where the length is automatically determined.
      *
      * @param ptr Pointer to a 1-dimensional HDF5 dataset. 
      * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     * @param allocator Allocator for the block buffer.
      */
-    Stream1dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size) : 
-        Stream1dNumericDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size) 
+    Stream1dNumericDataset(const H5::DataSet* ptr, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
+        Stream1dNumericDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size, allocator) 
     {}
 
 public:
@@ -103,12 +112,22 @@ public:
         return consumed + last_loaded;
     }
 
+    /**
+     * @return I/O statistics for this stream.
+     * All counters are zero unless `RITSUKO_HDF5_STREAM_STATS` is defined.
+     */
+    StreamStats stats() const {
+        return recorder.get();
+    }
+
 private:
     const H5::DataSet* ptr;
     hsize_t full_length, block_size;
     H5::DataSpace mspace;
     H5::DataSpace dspace;
-    std::vector<Type_> buffer;
+    std::vector<Type_, Allocator_> buffer;
+    NumericBlockReader<Type_> reader;
+    StreamStatsRecorder recorder;
 
     hsize_t last_loaded = 0;
     hsize_t consumed = 0;
@@ -122,7 +141,8 @@ private:
         constexpr hsize_t zero = 0;
         mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
         dspace.selectHyperslab(H5S_SELECT_SET, &available, &last_loaded);
-        ptr->read(buffer.data(), as_numeric_datatype<Type_>(), mspace, dspace);
+        reader.read(buffer.data(), available, mspace, dspace, recorder);
+        recorder.record_block();
         last_loaded += available;
     }
 };
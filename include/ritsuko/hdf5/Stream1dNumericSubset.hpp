@@ -0,0 +1,267 @@
+#ifndef RITSUKO_HDF5_STREAM_1D_NUMERIC_SUBSET_HPP
+#define RITSUKO_HDF5_STREAM_1D_NUMERIC_SUBSET_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "get_1d_length.hpp"
+#include "get_name.hpp"
+#include "as_numeric_datatype.hpp"
+#include "NumericBlockReader.hpp"
+
+/**
+ * @file Stream1dNumericSubset.hpp
+ * @brief Stream a subset of a numeric 1-dimensional HDF5 dataset into memory.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Stream a subset of a numeric 1-dimensional HDF5 dataset into memory.
+ * @tparam Type_ Type to represent the data in memory.
+ *
+ * This streams in the values of a 1-dimensional HDF5 numeric dataset at an arbitrary set of indices, in the same order as the indices were supplied.
+ * The indices are processed in windows of up to `buffer_size` entries, where all values in a window are extracted from the dataset with a single read.
+ * Specifically, the indices in each window are sorted and deduplicated;
+ * nearby indices are combined into runs that are then assembled into a union of hyperslabs,
+ * or if the indices are too sparse for runs to be worthwhile, they are directly used as a point selection.
+ *
+ * For chunked datasets, a run is extended across a gap between indices if both indices lie in the same chunk.
+ * The gap is read and discarded, which is cheap as the chunk needs to be decompressed in its entirety anyway, but reduces the number of hyperslabs that HDF5 needs to process.
+ * The total number of gap elements in each window is capped at `buffer_size` to limit the memory usage.
+ * For contiguous datasets, only consecutive indices are combined, as any gaps would require additional I/O.
+ *
+ * For sorted indices on a chunked dataset, each window is also trimmed to end at a chunk boundary where possible.
+ * This ensures that each chunk is only decompressed once throughout the stream, provided that `buffer_size` is larger than the chunk size.
+ * No trimming is performed for unsorted indices, as the indices in each window may be scattered across many chunks.
+ */
+template<typename Type_>
+class Stream1dNumericSubset {
+public:
+    /**
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param length Length of the dataset as a 1-dimensional vector.
+     * @param indices Indices of the elements of interest.
+     * Each index should be less than `length`.
+     * Indices may be unsorted and/or duplicated.
+     * @param buffer_size Maximum number of indices to process in each read.
+     * Larger buffers improve speed at the cost of some memory efficiency.
+     */
+    Stream1dNumericSubset(const H5::DataSet* ptr, hsize_t length, std::vector<hsize_t> indices, hsize_t buffer_size) :
+        my_ptr(ptr),
+        my_full_length(length),
+        my_indices(std::move(indices)),
+        my_window_size(std::max(std::min(buffer_size, static_cast<hsize_t>(my_indices.size())), static_cast<hsize_t>(1))),
+        my_gap_limit(buffer_size),
+        my_dspace(1, &my_full_length),
+        my_mspace(1, &my_window_size),
+        my_sorted(std::is_sorted(my_indices.begin(), my_indices.end())),
+        my_buffer(my_window_size),
+        my_reader(ptr)
+    {
+        for (auto i : my_indices) {
+            if (i >= my_full_length) {
+                throw std::runtime_error("requested indices are out of range of the dataset at '" + get_name(*my_ptr) + "'");
+            }
+        }
+
+        auto cplist = my_ptr->getCreatePlist();
+        if (cplist.getLayout() == H5D_CHUNKED) {
+            cplist.getChunk(1, &my_chunk_size);
+        }
+    }
+
+    /**
+     * Overloaded constructor where the length is automatically determined.
+     *
+     * @param ptr Pointer to a 1-dimensional HDF5 dataset.
+     * @param indices Indices of the elements of interest.
+     * @param buffer_size Maximum number of indices to process in each read.
+     */
+    Stream1dNumericSubset(const H5::DataSet* ptr, std::vector<hsize_t> indices, hsize_t buffer_size) :
+        Stream1dNumericSubset(ptr, get_1d_length(ptr->getSpace(), false), std::move(indices), buffer_size)
+    {}
+
+public:
+    /**
+     * @return Value at the current position of the stream, i.e., the value of the dataset at `indices[position()]`.
+     */
+    Type_ get() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return my_buffer[my_consumed];
+    }
+
+    /**
+     * @return Pair containing a pointer to and the length of an array.
+     * The array holds all loaded values of the stream at its current position, up to the specified length.
+     * Note that the pointer is only valid until the next invocation of `next()`.
+     */
+    std::pair<const Type_*, size_t> get_many() {
+        while (my_consumed >= my_available) {
+            my_consumed -= my_available;
+            load();
+        }
+        return std::make_pair(my_buffer.data() + my_consumed, my_available - my_consumed);
+    }
+
+    /**
+     * Advance the position of the stream by `jump`.
+     *
+     * @param jump Number of positions by which to advance the stream.
+     */
+    void next(size_t jump = 1) {
+        my_consumed += jump;
+    }
+
+    /**
+     * @return Number of requested indices, i.e., the length of the stream.
+     */
+    hsize_t length() const {
+        return my_indices.size();
+    }
+
+    /**
+     * @return Current position on the stream.
+     */
+    hsize_t position() const {
+        return my_consumed + my_last_loaded - my_available;
+    }
+
+    /**
+     * @return Number of elements read from the dataset so far, including the discarded elements in the gaps between nearby indices.
+     */
+    hsize_t num_read() const {
+        return my_num_read;
+    }
+
+private:
+    const H5::DataSet* my_ptr;
+    hsize_t my_full_length;
+    std::vector<hsize_t> my_indices;
+    hsize_t my_window_size;
+    hsize_t my_gap_limit;
+    H5::DataSpace my_dspace, my_mspace;
+    bool my_sorted;
+    hsize_t my_chunk_size = 1;
+
+    std::vector<Type_> my_buffer;
+    NumericBlockReader<Type_> my_reader;
+    std::vector<std::pair<hsize_t, size_t> > my_order;
+    std::vector<hsize_t> my_unique;
+    std::vector<hsize_t> my_unique_position;
+    std::vector<std::pair<hsize_t, hsize_t> > my_runs;
+    std::vector<Type_> my_read_buffer;
+    hsize_t my_num_read = 0;
+
+    hsize_t my_last_loaded = 0;
+    hsize_t my_consumed = 0;
+    hsize_t my_available = 0;
+
+    hsize_t choose_window_end() const {
+        hsize_t num_indices = my_indices.size();
+        hsize_t end = std::min(num_indices, my_last_loaded + my_window_size);
+        if (!my_sorted || end == num_indices || my_chunk_size <= 1) {
+            return end;
+        }
+
+        // Backing off so that the window doesn't split a chunk, unless we
+        // would end up with an empty window.
+        hsize_t excluded_chunk = my_indices[end] / my_chunk_size;
+        hsize_t trimmed = end;
+        while (trimmed > my_last_loaded && my_indices[trimmed - 1] / my_chunk_size == excluded_chunk) {
+            --trimmed;
+        }
+        return (trimmed > my_last_loaded ? trimmed : end);
+    }
+
+    void load() {
+        hsize_t num_indices = my_indices.size();
+        if (my_last_loaded >= num_indices) {
+            throw std::runtime_error("requesting data beyond the end of the subset of the dataset at '" + get_name(*my_ptr) + "'");
+        }
+
+        hsize_t end = choose_window_end();
+        my_available = end - my_last_loaded;
+
+        my_order.clear();
+        for (hsize_t i = my_last_loaded; i < end; ++i) {
+            my_order.emplace_back(my_indices[i], i - my_last_loaded);
+        }
+        if (!my_sorted) {
+            std::sort(my_order.begin(), my_order.end());
+        }
+
+        // Combining nearby indices into runs, where a run can span a gap if
+        // the indices on either side are in the same chunk.
+        my_unique.clear();
+        my_unique_position.clear();
+        my_runs.clear();
+        hsize_t run_total = 0, gap_total = 0;
+        for (const auto& o : my_order) {
+            hsize_t current = o.first;
+            if (!my_unique.empty()) {
+                hsize_t last = my_unique.back();
+                if (last == current) {
+                    continue;
+                }
+                hsize_t gap = current - last - 1;
+                if (gap == 0 || (my_chunk_size > 1 && last / my_chunk_size == current / my_chunk_size && gap_total + gap <= my_gap_limit)) {
+                    gap_total += gap;
+                    run_total += gap + 1;
+                    my_runs.back().second += gap + 1;
+                    my_unique.push_back(current);
+                    my_unique_position.push_back(run_total - 1);
+                    continue;
+                }
+            }
+            my_runs.emplace_back(current, 1);
+            my_unique.push_back(current);
+            my_unique_position.push_back(run_total);
+            ++run_total;
+        }
+
+        hsize_t num_unique = my_unique.size();
+        bool use_points = (my_runs.size() * 2 > num_unique);
+        hsize_t num_read = (use_points ? num_unique : run_total);
+        if (use_points) {
+            // Points are sorted so the memory order is consistent with the hyperslab union.
+            my_dspace.selectElements(H5S_SELECT_SET, num_unique, my_unique.data());
+        } else {
+            bool first = true;
+            for (const auto& run : my_runs) {
+                my_dspace.selectHyperslab(first ? H5S_SELECT_SET : H5S_SELECT_OR, &(run.second), &(run.first));
+                first = false;
+            }
+        }
+
+        // Gaps might make the read larger than the window, so the memory space is resized for each read.
+        my_read_buffer.resize(num_read);
+        my_mspace.setExtentSimple(1, &num_read);
+        my_reader.read(my_read_buffer.data(), num_read, my_mspace, my_dspace);
+        my_num_read += num_read;
+
+        size_t u = 0;
+        for (const auto& o : my_order) {
+            while (my_unique[u] != o.first) {
+                ++u;
+            }
+            my_buffer[o.second] = my_read_buffer[use_points ? u : my_unique_position[u]];
+        }
+
+        my_last_loaded = end;
+    }
+};
+
+}
+
+}
+
+#endif
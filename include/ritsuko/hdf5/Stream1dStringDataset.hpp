@@ -5,13 +5,18 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <stdexcept>
+#include <memory>
 
 #include "pick_1d_block_size.hpp"
 #include "get_1d_length.hpp"
 #include "get_name.hpp"
 #include "as_numeric_datatype.hpp"
 #include "utils_string.hpp"
+#include "VariableStringArena.hpp"
+#include "StreamStats.hpp"
 
 /**
  * @file Stream1dStringDataset.hpp
@@ -24,34 +29,50 @@ namespace hdf5 {
 
 /**
  * @brief Stream a 1-dimensional HDF5 string dataset into memory.
+ * @tparam Allocator_ Allocator for the block buffers, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
+ * This is rebound to the element type of each buffer.
  *
  * This streams in a 1-dimensional HDF5 string dataset in contiguous blocks, using block sizes defined by `pick_1d_block_size()`.
  * Callers can then iterate over the individual strings.
+ *
+ * Variable-length strings are allocated by HDF5 from a `VariableStringArena`, which is reset before each block is loaded.
+ * Fixed-length strings are left in the buffer used by `H5::DataSet::read()`.
+ * Callers that only need to inspect the bytes can use `get_view()` to avoid allocating a `std::string` for each element.
+ * Most applications should use the `Stream1dStringDataset` alias, which uses the default allocator.
  */
-class Stream1dStringDataset {
+template<class Allocator_ = std::allocator<char> >
+class BasicStream1dStringDataset {
 public:
     /**
      * @param ptr Pointer to a 1-dimensional HDF5 dataset. 
      * @param length Length of the dataset as a 1-dimensional vector.
      * @param buffer_size Size of the buffer for holding streamed blocks of values.
      * Larger buffers improve speed at the cost of some memory efficiency.
+     * @param allocator Allocator for the block buffers.
      */
-    Stream1dStringDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size) : 
+    BasicStream1dStringDataset(const H5::DataSet* ptr, hsize_t length, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
         ptr(ptr), 
         full_length(length), 
         block_size(pick_1d_block_size(ptr->getCreatePlist(), full_length, buffer_size)),
         mspace(1, &block_size),
         dspace(1, &full_length),
         dtype(ptr->getDataType()),
-        is_variable(dtype.isVariableStr())
+        is_variable(dtype.isVariableStr()),
+        var_buffer(allocator),
+        var_lengths(allocator),
+        fix_buffer(allocator),
+        fix_lengths(allocator)
     {
         if (is_variable) {
             var_buffer.resize(block_size);
+            var_lengths.resize(block_size);
+            var_memory.reset(new VariableStringArena);
         } else {
             fixed_length = dtype.getSize();
             fix_buffer.resize(fixed_length * block_size);
+            fix_lengths.resize(block_size);
         }
-        final_buffer.resize(block_size);
+        recorder.record_allocation(var_buffer.size() * sizeof(char*) + var_lengths.size() * sizeof(size_t) + fix_buffer.size() + fix_lengths.size() * sizeof(size_t));
     }
 
     /**
@@ -59,9 +80,10 @@ public:
      *
      * @param ptr Pointer to a 1-dimensional HDF5 dataset. 
      * @param buffer_size Size of the buffer for holding streamed blocks of values.
+     * @param allocator Allocator for the block buffers.
      */
-    Stream1dStringDataset(const H5::DataSet* ptr, hsize_t buffer_size) : 
-        Stream1dStringDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size) 
+    BasicStream1dStringDataset(const H5::DataSet* ptr, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
+        BasicStream1dStringDataset(ptr, get_1d_length(ptr->getSpace(), false), buffer_size, allocator) 
     {}
 
 public:
@@ -69,24 +91,32 @@ public:
      * @return String at the current position of the stream.
      */
     std::string get() {
-        while (consumed >= available) {
-            consumed -= available;
-            load(); 
-        }
-        return final_buffer[consumed];
+        return std::string(get_view());
     }
 
     /**
      * @return String at the current position of the stream.
-     * Unlike `get()`, this avoids a copy by directly acquiring the string,
-     * but it invalidates all subsequent `get()` and `steal()` requests until `next()` is called.
+     * This is retained for back-compatibility and is now equivalent to `get()`, as each string is constructed directly from the loaded block.
      */
     std::string steal() {
+        return get();
+    }
+
+    /**
+     * @return View of the string at the current position of the stream.
+     * This does not allocate any memory but is only valid until the next block is loaded, i.e., the next call to `get()`, `get_view()` or `steal()` after `next()`.
+     */
+    std::string_view get_view() {
         while (consumed >= available) {
             consumed -= available;
             load(); 
         }
-        return std::move(final_buffer[consumed]);
+
+        if (is_variable) {
+            return std::string_view(var_buffer[consumed], var_lengths[consumed]);
+        } else {
+            return std::string_view(fix_buffer.data() + consumed * fixed_length, fix_lengths[consumed]);
+        }
     }
 
     /**
@@ -112,6 +142,22 @@ public:
         return consumed + last_loaded;
     }
 
+    /**
+     * @param check Whether to check that each string contains valid UTF-8, see `find_invalid_utf8()`.
+     * If `true`, an error is raised when loading a block that contains an invalid string, reporting the index of the first such string in the dataset.
+     */
+    void set_check_utf8(bool check) {
+        check_utf8 = check;
+    }
+
+    /**
+     * @return I/O statistics for this stream.
+     * All counters are zero unless `RITSUKO_HDF5_STREAM_STATS` is defined.
+     */
+    StreamStats stats() const {
+        return recorder.get();
+    }
+
 private:
     const H5::DataSet* ptr;
     hsize_t full_length, block_size;
@@ -120,10 +166,15 @@ private:
 
     H5::DataType dtype;
     bool is_variable;
-    std::vector<char*> var_buffer;
+    typedef std::allocator_traits<Allocator_> AllocatorTraits;
+    std::vector<char*, typename AllocatorTraits::template rebind_alloc<char*> > var_buffer;
+    std::vector<size_t, typename AllocatorTraits::template rebind_alloc<size_t> > var_lengths;
+    std::unique_ptr<VariableStringArena> var_memory;
     size_t fixed_length = 0;
-    std::vector<char> fix_buffer;
-    std::vector<std::string> final_buffer;
+    std::vector<char, typename AllocatorTraits::template rebind_alloc<char> > fix_buffer;
+    std::vector<size_t, typename AllocatorTraits::template rebind_alloc<size_t> > fix_lengths;
+    bool check_utf8 = false;
+    StreamStatsRecorder recorder;
 
     hsize_t last_loaded = 0;
     hsize_t consumed = 0;
@@ -139,31 +190,64 @@ private:
         dspace.selectHyperslab(H5S_SELECT_SET, &available, &last_loaded);
 
         if (is_variable) {
-            ptr->read(var_buffer.data(), dtype, mspace, dspace);
-            [[maybe_unused]] VariableStringCleaner deletor(dtype.getId(), mspace.getId(), var_buffer.data());
-            for (hsize_t i = 0; i < available; ++i) {
-                if (var_buffer[i] == NULL) {
-                    throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(*ptr) + "'");
-                }
-                auto& curstr = final_buffer[i];
-                curstr.clear();
-                curstr.insert(0, var_buffer[i]);
+            // Strings from the previous block are no longer needed.
+            var_memory->reset();
+            auto old_capacity = var_memory->capacity();
+            recorder.record_read(available, available * sizeof(char*), [&]() -> void {
+                ptr->read(var_buffer.data(), dtype, mspace, dspace, var_memory->transfer_plist());
+            });
+            if (var_memory->capacity() > old_capacity) {
+                recorder.record_allocation(var_memory->capacity() - old_capacity);
             }
 
+            recorder.record_conversion([&]() -> void {
+                for (hsize_t i = 0; i < available; ++i) {
+                    if (var_buffer[i] == NULL) {
+                        throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(*ptr) + "'");
+                    }
+                    var_lengths[i] = std::strlen(var_buffer[i]);
+                }
+            });
+
         } else {
-            auto bptr = fix_buffer.data();
-            ptr->read(bptr, dtype, mspace, dspace);
-            for (size_t i = 0; i < available; ++i, bptr += fixed_length) {
-                auto& curstr = final_buffer[i];
-                curstr.clear();
-                curstr.insert(curstr.end(), bptr, bptr + find_string_length(bptr, fixed_length));
-            }
+            // No need to copy anything as get_view() points directly into the buffer.
+            recorder.record_read(available, available * fixed_length, [&]() -> void {
+                ptr->read(fix_buffer.data(), dtype, mspace, dspace);
+            });
+            recorder.record_conversion([&]() -> void {
+                find_string_lengths(fix_buffer.data(), fixed_length, available, fix_lengths.data());
+            });
+        }
+
+        if (check_utf8) {
+            recorder.record_conversion([&]() -> void {
+                for (hsize_t i = 0; i < available; ++i) {
+                    const char* sptr;
+                    size_t slen;
+                    if (is_variable) {
+                        sptr = var_buffer[i];
+                        slen = var_lengths[i];
+                    } else {
+                        sptr = fix_buffer.data() + i * fixed_length;
+                        slen = fix_lengths[i];
+                    }
+                    if (find_invalid_utf8(sptr, slen) != slen) {
+                        throw std::runtime_error("invalid UTF-8 in string " + std::to_string(last_loaded + i) + " of '" + get_name(*ptr) + "'");
+                    }
+                }
+            });
         }
 
+        recorder.record_block();
         last_loaded += available;
     }
 };
 
+/**
+ * Stream a 1-dimensional HDF5 string dataset with the default allocator.
+ */
+typedef BasicStream1dStringDataset<> Stream1dStringDataset;
+
 }
 
 }
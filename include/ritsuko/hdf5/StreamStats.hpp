@@ -0,0 +1,169 @@
+#ifndef RITSUKO_HDF5_STREAM_STATS_HPP
+#define RITSUKO_HDF5_STREAM_STATS_HPP
+
+#include "H5Cpp.h"
+
+#include <cstddef>
+
+#ifdef RITSUKO_HDF5_STREAM_STATS
+#include <chrono>
+#endif
+
+/**
+ * @file StreamStats.hpp
+ * @brief Statistics for streaming HDF5 datasets.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief I/O statistics for a stream.
+ *
+ * These are only collected if the `RITSUKO_HDF5_STREAM_STATS` macro is defined before including any **ritsuko** headers.
+ * Otherwise, all counters are left at zero.
+ */
+struct StreamStats {
+    /**
+     * Number of calls to `H5Dread()`.
+     */
+    size_t num_reads = 0;
+
+    /**
+     * Number of elements read from file.
+     */
+    hsize_t elements_read = 0;
+
+    /**
+     * Number of bytes read into memory.
+     */
+    hsize_t bytes_read = 0;
+
+    /**
+     * Time spent in `H5Dread()`, in seconds.
+     * This includes any type conversion performed by HDF5 itself.
+     */
+    double read_time = 0;
+
+    /**
+     * Time spent in **ritsuko**'s own conversion of the loaded data, e.g., byte-swapping, widening numbers or building strings, in seconds.
+     */
+    double conversion_time = 0;
+
+    /**
+     * Number of blocks loaded or iterated over.
+     */
+    size_t blocks_loaded = 0;
+
+    /**
+     * Number of bytes allocated for buffers.
+     */
+    size_t bytes_allocated = 0;
+
+    /**
+     * @param other Statistics from another stream.
+     * @return Reference to this object, after adding all counters from `other`.
+     */
+    StreamStats& operator+=(const StreamStats& other) {
+        num_reads += other.num_reads;
+        elements_read += other.elements_read;
+        bytes_read += other.bytes_read;
+        read_time += other.read_time;
+        conversion_time += other.conversion_time;
+        blocks_loaded += other.blocks_loaded;
+        bytes_allocated += other.bytes_allocated;
+        return *this;
+    }
+};
+
+/**
+ * @brief Record I/O statistics for a stream.
+ *
+ * If `RITSUKO_HDF5_STREAM_STATS` is not defined, this class is empty and all of its methods compile down to the wrapped function calls,
+ * so there is no overhead from instrumenting the streams.
+ */
+class StreamStatsRecorder {
+public:
+    /**
+     * Execute a function that calls `H5Dread()`, recording it as a single read.
+     *
+     * @tparam Function_ Function that accepts no arguments.
+     * @param elements Number of elements to be read.
+     * @param bytes Number of bytes to be read into memory.
+     * @param fun Function to execute.
+     */
+    template<class Function_>
+    void record_read([[maybe_unused]] hsize_t elements, [[maybe_unused]] hsize_t bytes, Function_ fun) {
+#ifdef RITSUKO_HDF5_STREAM_STATS
+        auto start = std::chrono::steady_clock::now();
+        fun();
+        my_stats.read_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++my_stats.num_reads;
+        my_stats.elements_read += elements;
+        my_stats.bytes_read += bytes;
+#else
+        fun();
+#endif
+    }
+
+    /**
+     * Execute a function that converts loaded data, recording the time spent.
+     *
+     * @tparam Function_ Function that accepts no arguments.
+     * @param fun Function to execute.
+     */
+    template<class Function_>
+    void record_conversion(Function_ fun) {
+#ifdef RITSUKO_HDF5_STREAM_STATS
+        auto start = std::chrono::steady_clock::now();
+        fun();
+        my_stats.conversion_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#else
+        fun();
+#endif
+    }
+
+    /**
+     * Record the loading of a block.
+     */
+    void record_block() {
+#ifdef RITSUKO_HDF5_STREAM_STATS
+        ++my_stats.blocks_loaded;
+#endif
+    }
+
+    /**
+     * Record the allocation of a buffer.
+     *
+     * @param bytes Number of bytes allocated.
+     */
+    void record_allocation([[maybe_unused]] size_t bytes) {
+#ifdef RITSUKO_HDF5_STREAM_STATS
+        my_stats.bytes_allocated += bytes;
+#endif
+    }
+
+    /**
+     * @return Statistics recorded so far.
+     * All counters are zero if `RITSUKO_HDF5_STREAM_STATS` is not defined.
+     */
+    StreamStats get() const {
+#ifdef RITSUKO_HDF5_STREAM_STATS
+        return my_stats;
+#else
+        return StreamStats();
+#endif
+    }
+
+private:
+#ifdef RITSUKO_HDF5_STREAM_STATS
+    StreamStats my_stats;
+#endif
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef RITSUKO_HDF5_VARIABLE_STRING_ARENA_HPP
+#define RITSUKO_HDF5_VARIABLE_STRING_ARENA_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstddef>
+
+/**
+ * @file VariableStringArena.hpp
+ * @brief Arena-backed memory manager for HDF5's variable-length strings.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Arena-backed memory manager for HDF5's variable-length strings.
+ *
+ * By default, HDF5 calls `malloc()` for each variable-length string in `H5::DataSet::read()`,
+ * and each string must then be individually freed by `H5Dvlen_reclaim()` (see `VariableStringCleaner`).
+ * Instead, this class provides a transfer property list where all variable-length data is allocated from large blocks of memory.
+ * Reclaiming the strings is then a matter of calling `reset()`, which allows the blocks to be reused by the next read.
+ * Blocks are only released when the arena is destroyed.
+ *
+ * The transfer property list holds a pointer to this object, so instances cannot be copied or moved.
+ * Attributes cannot be read with a custom memory manager, as `H5Aread()` does not accept a transfer property list.
+ */
+class VariableStringArena {
+public:
+    /**
+     * @param block_size Size of each block of memory, in bytes.
+     * Larger allocations are given their own block.
+     */
+    VariableStringArena(size_t block_size = 65536) : my_block_size(block_size) {
+        H5Pset_vlen_mem_manager(my_plist.getId(), allocate, this, release, this);
+    }
+
+    /**
+     * @cond
+     */
+    VariableStringArena(const VariableStringArena&) = delete;
+    VariableStringArena& operator=(const VariableStringArena&) = delete;
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Transfer property list to pass to `H5::DataSet::read()`.
+     * All variable-length data is allocated from this arena and remains valid until `reset()` is called.
+     */
+    const H5::DSetMemXferPropList& transfer_plist() const {
+        return my_plist;
+    }
+
+    /**
+     * Reclaim all memory that was allocated by previous reads.
+     * Any pointers to variable-length data from previous reads are invalidated.
+     */
+    void reset() {
+        my_current = 0;
+        my_used = 0;
+        my_large.clear();
+        my_large_bytes = 0;
+    }
+
+    /**
+     * @return Total size of all blocks held by the arena, in bytes.
+     */
+    size_t capacity() const {
+        return my_blocks.size() * my_block_size + my_large_bytes;
+    }
+
+private:
+    H5::DSetMemXferPropList my_plist;
+    size_t my_block_size;
+
+    std::vector<std::unique_ptr<unsigned char[]> > my_blocks;
+    size_t my_current = 0;
+    size_t my_used = 0;
+
+    std::vector<std::unique_ptr<unsigned char[]> > my_large;
+    size_t my_large_bytes = 0;
+
+    static constexpr size_t alignment = alignof(std::max_align_t);
+
+    // These are called from inside HDF5, so they must not throw.
+    static void* allocate(size_t size, void* info) {
+        return static_cast<VariableStringArena*>(info)->allocate_internal(size);
+    }
+
+    static void release(void*, void*) {}
+
+    static bool store(std::vector<std::unique_ptr<unsigned char[]> >& holder, unsigned char* ptr) {
+        try {
+            holder.emplace_back(ptr);
+        } catch (...) {
+            delete [] ptr;
+            return false;
+        }
+        return true;
+    }
+
+    void* allocate_internal(size_t size) {
+        size = (size + alignment - 1) / alignment * alignment;
+        if (size == 0) {
+            size = alignment;
+        }
+
+        if (size > my_block_size) {
+            unsigned char* ptr = new(std::nothrow) unsigned char[size];
+            if (ptr == NULL || !store(my_large, ptr)) {
+                return NULL;
+            }
+            my_large_bytes += size;
+            return ptr;
+        }
+
+        while (my_current < my_blocks.size()) {
+            if (my_used + size <= my_block_size) {
+                unsigned char* ptr = my_blocks[my_current].get() + my_used;
+                my_used += size;
+                return ptr;
+            }
+            ++my_current;
+            my_used = 0;
+        }
+
+        unsigned char* ptr = new(std::nothrow) unsigned char[my_block_size];
+        if (ptr == NULL || !store(my_blocks, ptr)) {
+            return NULL;
+        }
+        my_current = my_blocks.size() - 1;
+        my_used = size;
+        return ptr;
+    }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,398 @@
+#ifndef RITSUKO_HDF5_FIND_DUPLICATE_STRING_HPP
+#define RITSUKO_HDF5_FIND_DUPLICATE_STRING_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <stdexcept>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "get_1d_length.hpp"
+#include "for_each_string.hpp"
+#include "utils_string.hpp"
+
+/**
+ * @file find_duplicate_string.hpp
+ * @brief Find duplicated strings in a HDF5 dataset.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for `find_duplicate_1d_string()`.
+ */
+struct FindDuplicateStringOptions {
+    /**
+     * Maximum number of bytes to use for the hash table.
+     * If the table for the entire dataset would exceed this limit, the hashes are partitioned into temporary files that are processed one at a time.
+     */
+    size_t memory_limit = 268435456;
+};
+
+/**
+ * Compute a 64-bit hash of a string.
+ * This processes 8 bytes at a time and is intended for hash tables within a single process, as the result depends on the machine's byte order.
+ *
+ * @param ptr Pointer to the start of the string.
+ * @param len Length of the string.
+ * @return Hash of the string.
+ */
+inline uint64_t hash_string(const char* ptr, size_t len) {
+    auto mix = [](uint64_t k) -> uint64_t {
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ull;
+        k ^= k >> 33;
+        return k;
+    };
+
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (static_cast<uint64_t>(len) * 0x9fb21c651e98df25ull);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t k;
+        std::memcpy(&k, ptr + i, 8);
+        h = (h ^ mix(k)) * 0x9fb21c651e98df25ull;
+        h ^= h >> 29;
+    }
+    if (i < len) {
+        uint64_t k = 0;
+        std::memcpy(&k, ptr + i, len - i);
+        h = (h ^ mix(k)) * 0x9fb21c651e98df25ull;
+    }
+    return mix(h);
+}
+
+/**
+ * @cond
+ */
+namespace internal {
+
+struct HashedIndex {
+    uint64_t hash;
+    uint64_t index;
+};
+
+// Open-addressing table with linear probing. Entries store 'index + 1' so
+// that zero can be used to mark empty slots.
+class HashedIndexTable {
+public:
+    HashedIndexTable(size_t number) {
+        size_t capacity = 16;
+        while (capacity < number * 2) {
+            capacity *= 2;
+        }
+        my_entries.resize(capacity, HashedIndex{ 0, 0 });
+        my_mask = capacity - 1;
+    }
+
+    static size_t bytes(size_t number) {
+        size_t capacity = 16;
+        while (capacity < number * 2) {
+            capacity *= 2;
+        }
+        return capacity * sizeof(HashedIndex);
+    }
+
+    // Calls 'same(other)' for each previous index with the same hash,
+    // returning the first index for which it is true. Otherwise, the new
+    // index is inserted and the maximum value is returned.
+    template<class Same_>
+    uint64_t insert(uint64_t hash, uint64_t index, Same_ same) {
+        size_t pos = hash & my_mask;
+        while (true) {
+            auto& entry = my_entries[pos];
+            if (entry.index == 0) {
+                entry.hash = hash;
+                entry.index = index + 1;
+                return std::numeric_limits<uint64_t>::max();
+            }
+            if (entry.hash == hash && same(entry.index - 1)) {
+                return entry.index - 1;
+            }
+            pos = (pos + 1) & my_mask;
+        }
+    }
+
+private:
+    std::vector<HashedIndex> my_entries;
+    size_t my_mask;
+};
+
+struct FileCloser {
+    void operator()(std::FILE* handle) const {
+        std::fclose(handle);
+    }
+};
+
+// Reloads individual strings for exact comparisons, reusing the same
+// dataspaces and buffer across calls.
+class StringLoader {
+public:
+    StringLoader(const H5::DataSet& handle, const H5::DataType& dtype, hsize_t full_length) :
+        my_handle(handle),
+        my_dtype(dtype),
+        my_variable(dtype.isVariableStr()),
+        my_mspace(1, &one),
+        my_dspace(1, &full_length)
+    {
+        if (!my_variable) {
+            my_buffer.resize(dtype.getSize());
+        }
+    }
+
+    // The returned view is only valid until the next call.
+    std::string_view load(hsize_t index) {
+        my_dspace.selectHyperslab(H5S_SELECT_SET, &one, &index);
+
+        if (my_variable) {
+            char* vptr = NULL;
+            my_handle.read(&vptr, my_dtype, my_mspace, my_dspace);
+            [[maybe_unused]] VariableStringCleaner deletor(my_dtype.getId(), my_mspace.getId(), &vptr);
+            if (vptr == NULL) {
+                throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(my_handle) + "'");
+            }
+            size_t len = std::strlen(vptr);
+            my_buffer.resize(len);
+            std::copy_n(vptr, len, my_buffer.data());
+            return std::string_view(my_buffer.data(), len);
+        } else {
+            my_handle.read(my_buffer.data(), my_dtype, my_mspace, my_dspace);
+            return std::string_view(my_buffer.data(), find_string_length(my_buffer.data(), my_buffer.size()));
+        }
+    }
+
+private:
+    static constexpr hsize_t one = 1;
+    const H5::DataSet& my_handle;
+    const H5::DataType& my_dtype;
+    bool my_variable;
+    H5::DataSpace my_mspace, my_dspace;
+    std::vector<char> my_buffer;
+};
+
+// Each partition's records are stored in increasing order of index.
+struct HashPartition {
+    std::unique_ptr<std::FILE, FileCloser> file;
+    hsize_t count = 0;
+    size_t depth = 0;
+    bool splittable = true;
+};
+
+// Different depths use different functions of the hash, so that a skewed
+// partition can be split again.
+inline size_t choose_partition(uint64_t hash, size_t depth, size_t number) {
+    uint64_t k = hash + static_cast<uint64_t>(depth) * 0x9e3779b97f4a7c15ull;
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    return k % number;
+}
+
+class HashPartitioner {
+public:
+    HashPartitioner(size_t number, size_t depth) : my_depth(depth), my_partitions(number) {
+        for (auto& part : my_partitions) {
+            std::FILE* tmp = std::tmpfile();
+            if (tmp == NULL) {
+                throw std::runtime_error("failed to create a temporary file for duplicate detection");
+            }
+            part.file.reset(tmp);
+            part.depth = depth;
+        }
+    }
+
+    void add(const HashedIndex& record) {
+        auto& part = my_partitions[choose_partition(record.hash, my_depth, my_partitions.size())];
+        if (std::fwrite(&record, sizeof(record), 1, part.file.get()) != 1) {
+            throw std::runtime_error("failed to write to a temporary file for duplicate detection");
+        }
+        ++part.count;
+    }
+
+    std::vector<HashPartition>& partitions() {
+        return my_partitions;
+    }
+
+private:
+    size_t my_depth;
+    std::vector<HashPartition> my_partitions;
+};
+
+// Streams a partition's records in fixed-size batches, so that only the
+// hash table needs to be held in memory.
+template<class Function_>
+void stream_partition(HashPartition& part, std::vector<HashedIndex>& batch, Function_ fun) {
+    auto fptr = part.file.get();
+    std::rewind(fptr);
+    hsize_t remaining = part.count;
+    while (remaining) {
+        size_t available = std::min(remaining, static_cast<hsize_t>(batch.size()));
+        if (std::fread(batch.data(), sizeof(HashedIndex), available, fptr) != available) {
+            throw std::runtime_error("failed to read from a temporary file for duplicate detection");
+        }
+        for (size_t i = 0; i < available; ++i) {
+            if (!fun(batch[i])) {
+                return;
+            }
+        }
+        remaining -= available;
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Find the first duplicated string in a 1-dimensional string dataset.
+ * Strings are streamed with `for_each_1d_string()` and only their 64-bit hashes and indices are stored in a compact open-addressing hash table.
+ * When two strings have the same hash, they are compared exactly by reloading the earlier string from the dataset, so hash collisions do not cause false positives.
+ * This uses much less memory than loading all strings into a `std::unordered_set<std::string>`.
+ *
+ * If the hash table would exceed `FindDuplicateStringOptions::memory_limit`, the hashes are instead written to temporary files based on their values.
+ * Each partition is then streamed and checked separately, such that only one partition's table is held in memory at any time.
+ * Partitions that still exceed the limit, e.g., due to an uneven distribution of hashes, are split again with a different function of the hash.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 string dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param options Further options.
+ *
+ * @return If duplicates are present, the indices of the first duplicated pair, i.e., the pair with the smallest second index;
+ * the first index is that of an earlier string with the same value.
+ * Otherwise, an empty optional is returned.
+ */
+inline std::optional<std::pair<hsize_t, hsize_t> > find_duplicate_1d_string(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, const FindDuplicateStringOptions& options) {
+    auto dtype = handle.getDataType();
+    internal::StringLoader loader(handle, dtype, full_length);
+    std::optional<std::pair<hsize_t, hsize_t> > output;
+
+    if (internal::HashedIndexTable::bytes(full_length) <= options.memory_limit) {
+        internal::HashedIndexTable table(full_length);
+        for_each_1d_string(handle, full_length, buffer_size, [&](hsize_t i, const char* ptr, size_t len) -> bool {
+            std::string_view current(ptr, len);
+            auto found = table.insert(hash_string(ptr, len), i, [&](uint64_t j) -> bool {
+                return loader.load(j) == current;
+            });
+            if (found == std::numeric_limits<uint64_t>::max()) {
+                return true;
+            }
+            output = std::make_pair(static_cast<hsize_t>(found), i);
+            return false;
+        });
+        return output;
+    }
+
+    // Choosing the largest partition whose table fits in the memory limit.
+    size_t max_per_partition = 1;
+    while (internal::HashedIndexTable::bytes(max_per_partition * 2) <= options.memory_limit) {
+        max_per_partition *= 2;
+    }
+    std::vector<internal::HashedIndex> batch(std::min(max_per_partition, static_cast<size_t>(65536)));
+
+    std::vector<internal::HashPartition> pending;
+    {
+        size_t num_partitions = (full_length + max_per_partition - 1) / max_per_partition;
+        internal::HashPartitioner partitioner(num_partitions, 0);
+        for_each_1d_string(handle, full_length, buffer_size, [&](hsize_t i, const char* ptr, size_t len) -> void {
+            partitioner.add(internal::HashedIndex{ hash_string(ptr, len), i });
+        });
+        for (auto& part : partitioner.partitions()) {
+            pending.push_back(std::move(part));
+        }
+    }
+
+    hsize_t best = std::numeric_limits<hsize_t>::max();
+    std::string current;
+    while (!pending.empty()) {
+        auto part = std::move(pending.back());
+        pending.pop_back();
+
+        // Re-splitting partitions that exceed the memory limit. This stops if
+        // a split makes no progress, i.e., all records have the same hash, in
+        // which case the first duplicate is found immediately anyway.
+        if (part.count > max_per_partition && part.splittable) {
+            size_t num_partitions = std::max((part.count + max_per_partition - 1) / max_per_partition, static_cast<hsize_t>(2));
+            internal::HashPartitioner partitioner(num_partitions, part.depth + 1);
+            internal::stream_partition(part, batch, [&](const internal::HashedIndex& rec) -> bool {
+                partitioner.add(rec);
+                return true;
+            });
+            for (auto& child : partitioner.partitions()) {
+                if (child.count) {
+                    child.splittable = (child.count < part.count);
+                    pending.push_back(std::move(child));
+                }
+            }
+            continue;
+        }
+
+        // Records are in increasing order of index, so the first verified
+        // duplicate is the earliest in this partition.
+        internal::HashedIndexTable table(part.count);
+        internal::stream_partition(part, batch, [&](const internal::HashedIndex& rec) -> bool {
+            if (rec.index >= best) {
+                return false;
+            }
+            bool loaded = false;
+            auto found = table.insert(rec.hash, rec.index, [&](uint64_t j) -> bool {
+                if (!loaded) {
+                    current = loader.load(rec.index);
+                    loaded = true;
+                }
+                return loader.load(j) == current;
+            });
+            if (found == std::numeric_limits<uint64_t>::max()) {
+                return true;
+            }
+            best = rec.index;
+            output = std::make_pair(static_cast<hsize_t>(found), static_cast<hsize_t>(rec.index));
+            return false;
+        });
+    }
+
+    return output;
+}
+
+/**
+ * Overload of `find_duplicate_1d_string()` that determines the length via `get_1d_length()`.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 string dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param options Further options.
+ *
+ * @return Indices of the first duplicated pair, if any.
+ */
+inline std::optional<std::pair<hsize_t, hsize_t> > find_duplicate_1d_string(const H5::DataSet& handle, hsize_t buffer_size, const FindDuplicateStringOptions& options) {
+    return find_duplicate_1d_string(handle, get_1d_length(handle, false), buffer_size, options);
+}
+
+/**
+ * Overload of `find_duplicate_1d_string()` with default options.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 string dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ *
+ * @return Indices of the first duplicated pair, if any.
+ */
+inline std::optional<std::pair<hsize_t, hsize_t> > find_duplicate_1d_string(const H5::DataSet& handle, hsize_t buffer_size) {
+    return find_duplicate_1d_string(handle, buffer_size, FindDuplicateStringOptions());
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef RITSUKO_HDF5_FOR_EACH_STRING_HPP
+#define RITSUKO_HDF5_FOR_EACH_STRING_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+
+#include "get_name.hpp"
+#include "get_1d_length.hpp"
+#include "get_dimensions.hpp"
+#include "pick_1d_block_size.hpp"
+#include "pick_nd_block_dimensions.hpp"
+#include "IterateNdDataset.hpp"
+#include "VariableStringArena.hpp"
+#include "utils_string.hpp"
+
+/**
+ * @file for_each_string.hpp
+ * @brief Visit each string in a HDF5 dataset.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+template<class Function_>
+bool visit_string(Function_& fun, hsize_t index, const char* ptr, size_t len) {
+    if constexpr(std::is_same<decltype(fun(index, ptr, len)), void>::value) {
+        fun(index, ptr, len);
+        return true;
+    } else {
+        return fun(index, ptr, len);
+    }
+}
+
+// Reads a block of strings and visits each string in the order of the
+// memory buffer. 'index' maps each position in the buffer to the index of
+// the string in the dataset.
+class StringBlockVisitor {
+public:
+    StringBlockVisitor(const H5::DataSet& handle) : my_handle(handle), my_dtype(handle.getDataType()), my_variable(my_dtype.isVariableStr()) {
+        if (!my_variable) {
+            my_fixed_length = my_dtype.getSize();
+        }
+    }
+
+    template<class Index_, class Function_>
+    bool visit(size_t number, const H5::DataSpace& mspace, const H5::DataSpace& dspace, Index_ index, Function_& fun) {
+        if (my_variable) {
+            my_var_buffer.resize(number);
+            my_arena.reset();
+            my_handle.read(my_var_buffer.data(), my_dtype, mspace, dspace, my_arena.transfer_plist());
+            for (size_t i = 0; i < number; ++i) {
+                auto ptr = my_var_buffer[i];
+                if (ptr == NULL) {
+                    throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(my_handle) + "'");
+                }
+                if (!visit_string(fun, index(i), ptr, std::strlen(ptr))) {
+                    return false;
+                }
+            }
+
+        } else {
+            my_fix_buffer.resize(number * my_fixed_length);
+            my_fix_lengths.resize(number);
+            my_handle.read(my_fix_buffer.data(), my_dtype, mspace, dspace);
+            find_string_lengths(my_fix_buffer.data(), my_fixed_length, number, my_fix_lengths.data());
+            auto ptr = my_fix_buffer.data();
+            for (size_t i = 0; i < number; ++i, ptr += my_fixed_length) {
+                if (!visit_string(fun, index(i), ptr, my_fix_lengths[i])) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+    const H5::DataSet& my_handle;
+    H5::DataType my_dtype;
+    bool my_variable;
+
+    std::vector<char*> my_var_buffer;
+    VariableStringArena my_arena;
+    size_t my_fixed_length = 0;
+    std::vector<char> my_fix_buffer;
+    std::vector<size_t> my_fix_lengths;
+};
+
+// Maps each offset in a row-major block buffer to the row-major index of the
+// string in the dataset. Offsets should be supplied in increasing order so
+// that the index is only recomputed at the start of each row of the block.
+class NdBlockIndexer {
+public:
+    NdBlockIndexer(const std::vector<hsize_t>& dimensions) : my_dimensions(dimensions), my_position(dimensions.size()) {}
+
+    void reset(const std::vector<hsize_t>& starts, const std::vector<hsize_t>& counts) {
+        my_starts = &starts;
+        my_counts = &counts;
+        std::fill(my_position.begin(), my_position.end(), 0);
+        my_row_start = 0;
+        compute_base();
+    }
+
+    hsize_t operator()(size_t j) {
+        size_t ndims = my_dimensions.size();
+        const auto& counts = *my_counts;
+        while (j - my_row_start >= counts[ndims - 1]) {
+            my_row_start += counts[ndims - 1];
+            for (size_t d = ndims - 1; d > 0; --d) {
+                auto& x = my_position[d - 1];
+                ++x;
+                if (x < counts[d - 1]) {
+                    break;
+                }
+                x = 0;
+            }
+            compute_base();
+        }
+        return my_row_base + (j - my_row_start);
+    }
+
+private:
+    const std::vector<hsize_t>& my_dimensions;
+    const std::vector<hsize_t>* my_starts = NULL;
+    const std::vector<hsize_t>* my_counts = NULL;
+    std::vector<hsize_t> my_position;
+    hsize_t my_row_start = 0, my_row_base = 0;
+
+    void compute_base() {
+        my_row_base = 0;
+        for (size_t d = 0, ndims = my_dimensions.size(); d < ndims; ++d) {
+            my_row_base = my_row_base * my_dimensions[d] + (*my_starts)[d] + my_position[d];
+        }
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Visit each string in a 1-dimensional string dataset, in order.
+ * Strings are read in chunk-aligned blocks (see `pick_1d_block_size()`) and `fun` is called directly on the bytes in the block buffer.
+ * No memory is allocated for individual strings, making this more efficient than `Stream1dStringDataset` for checks that only inspect each string, e.g., for allowed values.
+ *
+ * @tparam Function_ Function to be called on each string.
+ * This should accept the index of the string in the dataset (as a `hsize_t`), a `const char*` pointer to the start of the string, and the length of the string (as a `size_t`).
+ * The string is not guaranteed to be null-terminated and the pointer is only valid during the call.
+ * The function may return a boolean indicating whether to continue the iteration, or it may return `void` to visit all strings.
+ *
+ * @param handle Handle to the 1-dimensional HDF5 string dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited, i.e., `false` if `fun` terminated the iteration early.
+ */
+template<class Function_>
+bool for_each_1d_string(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, Function_ fun) {
+    hsize_t block_size = pick_1d_block_size(handle.getCreatePlist(), full_length, buffer_size);
+    H5::DataSpace mspace(1, &block_size), dspace(1, &full_length);
+    internal::StringBlockVisitor visitor(handle);
+
+    for (hsize_t i = 0; i < full_length; i += block_size) {
+        auto available = std::min(full_length - i, block_size);
+        constexpr hsize_t zero = 0;
+        mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+        dspace.selectHyperslab(H5S_SELECT_SET, &available, &i);
+        if (!visitor.visit(available, mspace, dspace, [&](size_t j) -> hsize_t { return i + j; }, fun)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Overload of `for_each_1d_string()` that determines the length via `get_1d_length()`.
+ *
+ * @tparam Function_ Function to be called on each string, see `for_each_1d_string()` for details.
+ * @param handle Handle to the 1-dimensional HDF5 string dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited.
+ */
+template<class Function_>
+bool for_each_1d_string(const H5::DataSet& handle, hsize_t buffer_size, Function_ fun) {
+    return for_each_1d_string(handle, get_1d_length(handle, false), buffer_size, std::move(fun));
+}
+
+/**
+ * Visit each string in an N-dimensional string dataset.
+ * Strings are read in chunk-aligned blocks (see `pick_nd_block_dimensions()`) and `fun` is called directly on the bytes in the block buffer.
+ * Blocks are visited in the order defined by `IterateNdDataset`, and strings are visited in row-major order within each block;
+ * this means that strings are not necessarily visited in row-major order across the entire dataset.
+ *
+ * @tparam Function_ Function to be called on each string, see `for_each_1d_string()` for details.
+ * The index passed to `fun` is the row-major index of the string in the dataset.
+ *
+ * @param handle Handle to the HDF5 string dataset.
+ * @param dimensions Dimensions of the dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited, i.e., `false` if `fun` terminated the iteration early.
+ */
+template<class Function_>
+bool for_each_nd_string(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t buffer_size, Function_ fun) {
+    auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
+    IterateNdDataset iter(dimensions, blocks);
+    internal::StringBlockVisitor visitor(handle);
+    internal::NdBlockIndexer indexer(dimensions);
+
+    while (!iter.finished()) {
+        indexer.reset(iter.starts(), iter.counts());
+        bool okay = visitor.visit(iter.current_block_size(), iter.memory_space(), iter.file_space(), [&](size_t j) -> hsize_t { return indexer(j); }, fun);
+        if (!okay) {
+            return false;
+        }
+        iter.next();
+    }
+
+    return true;
+}
+
+/**
+ * Overload of `for_each_nd_string()` that automatically determines the dimensions.
+ *
+ * @tparam Function_ Function to be called on each string, see `for_each_1d_string()` for details.
+ * @param handle Handle to the HDF5 string dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited.
+ */
+template<class Function_>
+bool for_each_nd_string(const H5::DataSet& handle, hsize_t buffer_size, Function_ fun) {
+    auto dimensions = get_dimensions(handle, false);
+    return for_each_nd_string(handle, dimensions, buffer_size, std::move(fun));
+}
+
+}
+
+}
+
+#endif
@@ -2,7 +2,14 @@
 #define RITSUKO_HDF5_HPP
 
 #include "Stream1dNumericDataset.hpp"
+#include "NumericBlockReader.hpp"
+#include "BlockReader.hpp"
+#include "LockstepStream1dDatasets.hpp"
 #include "Stream1dStringDataset.hpp"
+#include "RandomAccess1dNumericDataset.hpp"
+#include "RandomAccess2dNumericDataset.hpp"
+#include "Stream1dNumericSubset.hpp"
+#include "MappedStream1dNumericDataset.hpp"
 #include "as_numeric_datatype.hpp"
 #include "exceeds_limit.hpp"
 #include "get_1d_length.hpp"
@@ -11,13 +18,20 @@
 #include "is_utf8_string.hpp"
 #include "load_attribute.hpp"
 #include "load_dataset.hpp"
+#include "read_dataset_into.hpp"
+#include "serialize.hpp"
+#include "VariableStringArena.hpp"
+#include "StreamStats.hpp"
 #include "missing_placeholder.hpp"
 #include "miscellaneous.hpp"
 #include "open.hpp"
 #include "pick_1d_block_size.hpp"
 #include "pick_nd_block_dimensions.hpp"
 #include "IterateNdDataset.hpp"
+#include "parallel_iterate_nd_dataset.hpp"
 #include "validate_string.hpp"
+#include "for_each_string.hpp"
+#include "find_duplicate_string.hpp"
 #include "utils_string.hpp"
 
 /**
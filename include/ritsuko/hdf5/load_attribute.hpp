@@ -5,7 +5,10 @@
 
 #include <vector>
 #include <string>
+#include <cstring>
+#include <cstdint>
 
+#include "../StringColumn.hpp"
 #include "get_1d_length.hpp"
 #include "as_numeric_datatype.hpp"
 #include "utils_string.hpp"
@@ -77,9 +80,11 @@ inline std::vector<std::string> load_1d_string_attribute(const H5::Attribute& at
         size_t len = dtype.getSize();
         std::vector<char> buffer(len * full_length);
         attr.read(dtype, buffer.data());
+        std::vector<size_t> lengths(full_length);
+        find_string_lengths(buffer.data(), len, full_length, lengths.data());
         auto ptr = buffer.data();
         for (size_t i = 0; i < full_length; ++i, ptr += len) {
-            output.emplace_back(ptr, ptr + find_string_length(ptr, len));
+            output.emplace_back(ptr, ptr + lengths[i]);
         }
     }
 
@@ -96,6 +101,72 @@ inline std::vector<std::string> load_1d_string_attribute(const H5::Attribute& at
     return load_1d_string_attribute(attr, get_1d_length(attr.getSpace(), false));
 }
 
+/**
+ * @tparam Offset_ Integer type for the offsets in the column.
+ * @param attr Handle to a 1-dimensional string attribute.
+ * Callers are responsible for checking that `attr` contains a string datatype class.
+ * @param full_length Length of the attribute in `attr`, usually obtained by `get_1d_length()`.
+ * @return Column of strings, filled directly from the buffer used by `H5::Attribute::read()`.
+ */
+template<typename Offset_ = int64_t>
+StringColumn<Offset_> load_1d_string_attribute_as_column(const H5::Attribute& attr, hsize_t full_length) {
+    auto dtype = attr.getDataType();
+    StringColumn<Offset_> output;
+
+    if (dtype.isVariableStr()) {
+        auto mspace = attr.getSpace(); // don't set as a temporary in the Cleaner constructor, as it will be deleted and its ID invalidated.
+        std::vector<char*> buffer(full_length);
+        attr.read(dtype, buffer.data());
+        [[maybe_unused]] VariableStringCleaner deletor(dtype.getId(), mspace.getId(), buffer.data());
+
+        std::vector<size_t> lengths(full_length);
+        size_t total = 0;
+        for (hsize_t i = 0; i < full_length; ++i) {
+            if (buffer[i] == NULL) {
+                throw std::runtime_error("detected a NULL pointer for a variable length string attribute");
+            }
+            lengths[i] = std::strlen(buffer[i]);
+            total += lengths[i];
+        }
+
+        output.reserve(full_length, total);
+        for (hsize_t i = 0; i < full_length; ++i) {
+            output.push_back(buffer[i], lengths[i]);
+        }
+
+    } else {
+        size_t len = dtype.getSize();
+        std::vector<char> buffer(len * full_length);
+        attr.read(dtype, buffer.data());
+        std::vector<size_t> lengths(full_length);
+        find_string_lengths(buffer.data(), len, full_length, lengths.data());
+
+        size_t total = 0;
+        for (auto l : lengths) {
+            total += l;
+        }
+        output.reserve(full_length, total);
+        auto ptr = buffer.data();
+        for (size_t i = 0; i < full_length; ++i, ptr += len) {
+            output.push_back(ptr, lengths[i]);
+        }
+    }
+
+    return output;
+}
+
+/**
+ * Overload of `load_1d_string_attribute_as_column()` that determines the length of the attribute via `get_1d_length()`.
+ * @tparam Offset_ Integer type for the offsets in the column.
+ * @param attr Handle to a 1-dimensional string attribute.
+ * Callers are responsible for checking that `attr` contains a string datatype class.
+ * @return Column of strings.
+ */
+template<typename Offset_ = int64_t>
+StringColumn<Offset_> load_1d_string_attribute_as_column(const H5::Attribute& attr) {
+    return load_1d_string_attribute_as_column<Offset_>(attr, get_1d_length(attr.getSpace(), false));
+}
+
 /**
  * @tparam Type_ Type for holding the data in memory, see `as_numeric_datatype()` for supported types.
  * @param attr Handle to a scalar numeric attribute.
@@ -4,12 +4,20 @@
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <memory>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
+#include <limits>
+#include <cstdint>
 
 #include "H5Cpp.h"
 
+#include "../StringColumn.hpp"
 #include "get_name.hpp"
 #include "Stream1dStringDataset.hpp"
 #include "Stream1dNumericDataset.hpp"
+#include "read_dataset_into.hpp"
 #include "as_numeric_datatype.hpp"
 #include "utils_string.hpp"
 
@@ -51,6 +59,8 @@ inline std::string load_scalar_string_dataset(const H5::DataSet& handle) {
 
 /**
  * Load a 1-dimensional string dataset into a vector of strings.
+ * For large compressed datasets, consider using `parallel_load_1d_string_dataset()` instead.
+ *
  * @param handle Handle to the 1-dimensional HDF5 dataset.
  * @param full_length Length of the dataset as a 1-dimensional vector.
  * @param buffer_size Size of the buffer for holding loaded strings.
@@ -76,6 +86,153 @@ inline std::vector<std::string> load_1d_string_dataset(const H5::DataSet& handle
     return load_1d_string_dataset(handle, get_1d_length(handle, false), buffer_size);
 }
 
+/**
+ * Load a 1-dimensional string dataset into a contiguous `StringColumn`.
+ * Each string is appended directly from the loaded block via `Stream1dStringDataset::get_view()`, without creating a `std::string` for each element.
+ *
+ * @tparam Offset_ Integer type for the offsets in the column.
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @return Column of strings.
+ */
+template<typename Offset_ = int64_t>
+StringColumn<Offset_> load_1d_string_dataset_as_column(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size) {
+    Stream1dStringDataset stream(&handle, full_length, buffer_size);
+    StringColumn<Offset_> output;
+    output.reserve(full_length, 0);
+    for (hsize_t i = 0; i < full_length; ++i, stream.next()) {
+        output.push_back(stream.get_view());
+    }
+    return output;
+}
+
+/**
+ * Overload of `load_1d_string_dataset_as_column()` that determines the length via `get_1d_length()`.
+ *
+ * @tparam Offset_ Integer type for the offsets in the column.
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @return Column of strings.
+ */
+template<typename Offset_ = int64_t>
+StringColumn<Offset_> load_1d_string_dataset_as_column(const H5::DataSet& handle, hsize_t buffer_size) {
+    return load_1d_string_dataset_as_column<Offset_>(handle, get_1d_length(handle, false), buffer_size);
+}
+
+/**
+ * @brief Dictionary-encoded contents of a string dataset.
+ * @tparam Code_ Integer type for the codes.
+ */
+template<typename Code_>
+struct FactorDataset {
+    /**
+     * Whether the dataset was dictionary-encoded.
+     * If true, `codes` and `levels` are filled and `strings` is empty.
+     * If false, the number of unique strings exceeded the cap in `load_1d_string_dataset_as_factor()`, in which case `strings` is filled and `codes` and `levels` are empty.
+     */
+    bool is_factor = true;
+
+    /**
+     * Code for each element of the dataset, i.e., the index of its string in `levels`.
+     */
+    std::vector<Code_> codes;
+
+    /**
+     * Unique strings in the dataset, in order of their first appearance.
+     */
+    std::vector<std::string> levels;
+
+    /**
+     * Contents of the dataset as plain strings, only used if `is_factor = false`.
+     */
+    std::vector<std::string> strings;
+};
+
+/**
+ * Load a 1-dimensional string dataset with dictionary encoding.
+ * This is more memory-efficient than `load_1d_string_dataset()` when the dataset contains many repeated strings, e.g., sample labels or categories,
+ * as only one copy of each unique string is stored alongside an integer code per element.
+ * Strings are deduplicated on the fly with a hash table, using `Stream1dStringDataset::get_view()` to avoid creating a `std::string` for each element.
+ *
+ * @tparam Code_ Integer type for the codes.
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param max_levels Maximum number of unique strings.
+ * If this is exceeded, dictionary encoding is abandoned and the remaining elements are loaded as plain strings.
+ * This is also capped at the largest value of `Code_`.
+ * @return Contents of the dataset.
+ */
+template<typename Code_ = uint32_t>
+FactorDataset<Code_> load_1d_string_dataset_as_factor(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, size_t max_levels) {
+    Stream1dStringDataset stream(&handle, full_length, buffer_size);
+    FactorDataset<Code_> output;
+    output.codes.reserve(full_length);
+
+    // Using a deque so that existing strings are never moved, as the keys of
+    // the hash table are views into these strings.
+    std::deque<std::string> levels;
+    std::unordered_map<std::string_view, Code_> mapping;
+    max_levels = std::min(max_levels, static_cast<size_t>(std::numeric_limits<Code_>::max()));
+
+    hsize_t i = 0;
+    for (; i < full_length; ++i, stream.next()) {
+        auto current = stream.get_view();
+        auto it = mapping.find(current);
+        if (it != mapping.end()) {
+            output.codes.push_back(it->second);
+            continue;
+        }
+
+        if (levels.size() >= max_levels) {
+            output.is_factor = false;
+            break;
+        }
+        Code_ code = levels.size();
+        levels.emplace_back(current);
+        mapping[std::string_view(levels.back())] = code;
+        output.codes.push_back(code);
+    }
+
+    if (output.is_factor) {
+        output.levels.reserve(levels.size());
+        for (auto& l : levels) {
+            output.levels.emplace_back(std::move(l));
+        }
+        return output;
+    }
+
+    // Falling back to plain strings if we exceeded the cap.
+    mapping.clear();
+    output.strings.reserve(full_length);
+    for (auto c : output.codes) {
+        output.strings.push_back(levels[c]);
+    }
+    output.codes.clear();
+    output.codes.shrink_to_fit();
+    levels.clear();
+
+    for (; i < full_length; ++i, stream.next()) {
+        output.strings.emplace_back(stream.get_view());
+    }
+    return output;
+}
+
+/**
+ * Overload of `load_1d_string_dataset_as_factor()` that determines the length via `get_1d_length()`,
+ * without any limit on the number of unique strings other than that imposed by `Code_`.
+ *
+ * @tparam Code_ Integer type for the codes.
+ * @param handle Handle to the 1-dimensional HDF5 dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings.
+ * @return Contents of the dataset.
+ */
+template<typename Code_ = uint32_t>
+FactorDataset<Code_> load_1d_string_dataset_as_factor(const H5::DataSet& handle, hsize_t buffer_size) {
+    return load_1d_string_dataset_as_factor<Code_>(handle, get_1d_length(handle, false), buffer_size, std::numeric_limits<size_t>::max());
+}
+
 /**
  * Load a scalar numeric dataset into a single number.
  * @tparam Type_ Type of the number in memory.
@@ -91,33 +248,36 @@ Type_ load_scalar_numeric_dataset(const H5::DataSet& handle) {
 
 /**
  * Load a 1-dimensional numeric dataset into a vector.
+ * This reads directly into the vector's storage via `read_1d_numeric_dataset_into()`.
+ *
  * @tparam Type_ Type of the number in memory.
+ * @tparam Allocator_ Allocator for the vector.
+ * This can be set to `DefaultInitAllocator` to avoid zero-initializing the vector before it is filled.
  * @param handle Handle to the HDF5 dataset.
  * @param full_length Length of the dataset as a 1-dimensional vector.
  * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param allocator Allocator instance for the vector.
  * @return Vector of numbers.
  */
-template<typename Type_>
-std::vector<Type_> load_1d_numeric_dataset(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size) {
-    Stream1dNumericDataset<Type_> stream(&handle, full_length, buffer_size);
-    std::vector<Type_> output;
-    output.reserve(full_length);
-    for (hsize_t i = 0; i < full_length; ++i, stream.next()) {
-        output.push_back(stream.get());
-    }
+template<typename Type_, class Allocator_ = std::allocator<Type_> >
+std::vector<Type_, Allocator_> load_1d_numeric_dataset(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) {
+    std::vector<Type_, Allocator_> output(full_length, allocator);
+    read_1d_numeric_dataset_into(handle, full_length, output.data(), buffer_size);
     return output;
 }
 
 /**
  * Overload of `load_1d_numeric_dataset()` that determines the length via `get_1d_length()`.
  * @tparam Type_ Type of the number in memory.
+ * @tparam Allocator_ Allocator for the vector.
  * @param handle Handle to the HDF5 dataset.
  * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param allocator Allocator instance for the vector.
  * @return Vector of numbers.
  */
-template<typename Type_>
-std::vector<Type_> load_1d_numeric_dataset(const H5::DataSet& handle, hsize_t buffer_size) {
-    return load_1d_numeric_dataset<Type_>(handle, get_1d_length(handle, false), buffer_size);
+template<typename Type_, class Allocator_ = std::allocator<Type_> >
+std::vector<Type_, Allocator_> load_1d_numeric_dataset(const H5::DataSet& handle, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) {
+    return load_1d_numeric_dataset<Type_, Allocator_>(handle, get_1d_length(handle, false), buffer_size, allocator);
 }
 
 }
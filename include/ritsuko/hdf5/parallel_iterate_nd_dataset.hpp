@@ -0,0 +1,345 @@
+#ifndef RITSUKO_HDF5_PARALLEL_ITERATE_ND_DATASET_HPP
+#define RITSUKO_HDF5_PARALLEL_ITERATE_ND_DATASET_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstddef>
+
+#include "../parallelize.hpp"
+#include "../permute_dimensions.hpp"
+#include "serialize.hpp"
+
+/**
+ * @file parallel_iterate_nd_dataset.hpp
+ * @brief Iterate through an N-dimensional dataset by block on multiple threads.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for `parallel_iterate_nd_dataset()`.
+ */
+struct ParallelIterateNdDatasetOptions {
+    /**
+     * Memory layout of each block, as the order of the dataset dimensions from slowest- to fastest-changing.
+     * For example, for a 2-dimensional dataset, `{ 1, 0 }` will yield column-major blocks.
+     * This should be a permutation of the dimension indices, see `is_dimension_permutation()`.
+     * If empty, blocks are laid out in row-major order, i.e., the same layout as HDF5.
+     * See `NdBlockSelection::permute()` for details.
+     */
+    std::vector<size_t> layout;
+};
+
+/**
+ * @brief Selection for the current block of a worker in `parallel_iterate_nd_dataset()`.
+ *
+ * Each worker has its own instance, so the dataspaces can be used without interference from other workers.
+ * All members are overwritten when the worker moves to its next block.
+ */
+struct NdBlockSelection {
+    /**
+     * Index of the worker processing this block.
+     */
+    size_t worker = 0;
+
+    /**
+     * Starting coordinates of the block.
+     */
+    std::vector<hsize_t> starts;
+
+    /**
+     * Dimensions of the block.
+     * This is usually equal to the block dimensions, except at the edges of the dataset where the block may be truncated.
+     */
+    std::vector<hsize_t> counts;
+
+    /**
+     * Number of elements in the block.
+     */
+    size_t size = 0;
+
+    /**
+     * Dataspace for storing the block contents in memory, assuming a contiguous allocation with space for at least `size` elements.
+     */
+    H5::DataSpace memory_space;
+
+    /**
+     * Dataspace for extracting the block contents from file.
+     */
+    H5::DataSpace file_space;
+
+    /**
+     * Memory layout of the block, as the order of the dataset dimensions from slowest- to fastest-changing, see `ParallelIterateNdDatasetOptions::layout`.
+     */
+    std::vector<size_t> layout;
+
+    /**
+     * Whether `layout` differs from row-major order.
+     */
+    bool permuted = false;
+
+    /**
+     * Stride of each dimension of the block in the requested `layout`, i.e., after `permute()`.
+     * The element at position `x` in the permuted block is located at `x[0] * strides[0] + x[1] * strides[1] + ...`.
+     */
+    std::vector<size_t> strides;
+
+    /**
+     * Convert the row-major block contents (e.g., as read with `memory_space`) into the requested `layout`.
+     * This does not make any HDF5 calls and should be called outside of `serialize()`, so that the permutations are performed in parallel across workers.
+     *
+     * @tparam Type_ Type of the data in memory.
+     * @param[in] input Pointer to an array of length `size`, containing the block contents in row-major order.
+     * @param[out] output Pointer to an array of length `size`, which should not overlap with `input`.
+     * On return, this contains the block contents in the requested `layout`.
+     * If `permuted = false`, this is just a copy of `input`.
+     */
+    template<typename Type_>
+    void permute(const Type_* input, Type_* output) const {
+        if (permuted) {
+            permute_dimensions(input, counts, layout, output);
+        } else {
+            std::copy_n(input, size, output);
+        }
+    }
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Each worker owns a contiguous range of blocks, taking blocks from the front.
+// Once a worker's range is exhausted, it steals the back half of the largest
+// remaining range. Only one lock is held at any time to avoid deadlocks.
+class BlockStealer {
+public:
+    BlockStealer(size_t num_tasks, size_t num_workers) : my_ranges(num_workers) {
+        size_t per_worker = num_tasks / num_workers, remainder = num_tasks % num_workers;
+        size_t start = 0;
+        for (size_t w = 0; w < num_workers; ++w) {
+            auto& range = my_ranges[w];
+            range.begin = start;
+            start += per_worker + (w < remainder);
+            range.end = start;
+        }
+    }
+
+    bool next(size_t worker, size_t& task) {
+        auto& own = my_ranges[worker];
+        {
+            std::lock_guard<std::mutex> lck(own.lock);
+            if (own.begin < own.end) {
+                task = own.begin;
+                ++own.begin;
+                return true;
+            }
+        }
+
+        while (true) {
+            size_t victim = 0, most = 0;
+            for (size_t w = 0, end = my_ranges.size(); w < end; ++w) {
+                auto& range = my_ranges[w];
+                std::lock_guard<std::mutex> lck(range.lock);
+                auto remaining = range.end - range.begin;
+                if (remaining > most) {
+                    most = remaining;
+                    victim = w;
+                }
+            }
+            if (most == 0) {
+                return false;
+            }
+
+            size_t first, last;
+            {
+                auto& range = my_ranges[victim];
+                std::lock_guard<std::mutex> lck(range.lock);
+                auto remaining = range.end - range.begin;
+                if (remaining == 0) {
+                    continue; // someone else got there first.
+                }
+                last = range.end;
+                first = last - (remaining + 1) / 2;
+                range.end = first;
+            }
+
+            std::lock_guard<std::mutex> lck(own.lock);
+            task = first;
+            own.begin = first + 1;
+            own.end = last;
+            return true;
+        }
+    }
+
+private:
+    struct alignas(64) Range {
+        std::mutex lock;
+        size_t begin = 0, end = 0;
+    };
+    std::vector<Range> my_ranges;
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Iterate through an N-dimensional dataset by block, processing blocks concurrently on multiple worker threads.
+ * The grid of blocks is partitioned into contiguous ranges of row-major block indices, one per worker.
+ * Workers that finish their own range early will steal the remaining blocks from other workers, which balances the load when the cost of each block is variable, e.g., due to compression.
+ *
+ * Each worker has its own `NdBlockSelection` with its own dataspaces, which are updated inside `serialize()` before `fun` is called for each block.
+ * `fun` itself is called outside of the lock, so any HDF5 calls in `fun` (e.g., `H5::DataSet::read()` or `H5Dread_chunk()`) should be wrapped in `serialize()`.
+ * Each worker also has its own instance of `State_`, which can hold buffers for loading data as well as the partial results for that worker.
+ * Once all blocks are processed, the per-worker states are returned so that the caller can reduce them into a final result.
+ *
+ * If `fun` throws in any worker, the other workers stop after their current block and the first exception is rethrown by `parallelize()`.
+ *
+ * If a non-row-major `ParallelIterateNdDatasetOptions::layout` is requested, `fun` should read each block into a row-major staging buffer via `NdBlockSelection::memory_space`,
+ * and then call `NdBlockSelection::permute()` outside of `serialize()` to obtain the block in the requested layout.
+ * The strides of the permuted block are available in `NdBlockSelection::strides`.
+ *
+ * @tparam State_ Per-worker state, which should be default-constructible.
+ * @tparam Function_ Function to process each block.
+ * This should accept a `const NdBlockSelection&` and a `State_&`.
+ *
+ * @param dimensions Dataset dimension extents.
+ * This should contain at least one value.
+ * @param blocks Block dimensions, typically obtained from `pick_nd_block_dimensions()`.
+ * This should be of the same length as `dimensions`, where each value of `blocks` is no greater than its counterpart in `dimensions`.
+ * @param num_threads Number of worker threads.
+ * @param options Further options.
+ * @param fun Function to process each block.
+ *
+ * @return Vector of per-worker states, of length equal to `num_threads` (or 1, if `num_threads` is not positive).
+ * States of workers that did not process any blocks are left in their default-constructed form.
+ */
+template<class State_, class Function_>
+std::vector<State_> parallel_iterate_nd_dataset(const std::vector<hsize_t>& dimensions, const std::vector<hsize_t>& blocks, int num_threads, const ParallelIterateNdDatasetOptions& options, Function_ fun) {
+    size_t num_workers = std::max(num_threads, 1);
+    std::vector<State_> states(num_workers);
+
+    size_t ndims = dimensions.size();
+    std::vector<size_t> layout(ndims);
+    bool permuted = false;
+    if (options.layout.empty()) {
+        std::iota(layout.begin(), layout.end(), 0);
+    } else {
+        if (!is_dimension_permutation(options.layout, ndims)) {
+            throw std::runtime_error("layout should be a permutation of the dataset dimensions");
+        }
+        layout = options.layout;
+        for (size_t i = 0; i < ndims; ++i) {
+            if (layout[i] != i) {
+                permuted = true;
+                break;
+            }
+        }
+    }
+
+    std::vector<hsize_t> grid(ndims);
+    size_t num_blocks = 1;
+    for (size_t d = 0; d < ndims; ++d) {
+        if (blocks[d] == 0) {
+            return states;
+        }
+        grid[d] = (dimensions[d] + blocks[d] - 1) / blocks[d];
+        num_blocks *= grid[d];
+    }
+
+    num_workers = std::min(num_workers, num_blocks);
+    std::vector<std::unique_ptr<NdBlockSelection> > selections;
+    selections.reserve(num_workers);
+    for (size_t w = 0; w < num_workers; ++w) {
+        selections.emplace_back(new NdBlockSelection);
+        auto& sel = *(selections.back());
+        sel.worker = w;
+        sel.starts.resize(ndims);
+        sel.counts.resize(ndims);
+        sel.file_space = H5::DataSpace(ndims, dimensions.data());
+        sel.layout = layout;
+        sel.permuted = permuted;
+        sel.strides.resize(ndims);
+    }
+
+    internal::BlockStealer stealer(num_blocks, num_workers);
+    std::atomic<bool> failed(false);
+
+    // Treating each worker as a separate task, so that workers are still
+    // correctly distinguished if RITSUKO_CUSTOM_PARALLEL runs them serially.
+    parallelize(num_workers, num_workers, [&](size_t, size_t start, size_t length) -> void {
+        for (size_t w = start, end = start + length; w < end; ++w) {
+            auto& sel = *(selections[w]);
+            auto& state = states[w];
+
+            try {
+                size_t task;
+                while (!failed.load(std::memory_order_relaxed) && stealer.next(w, task)) {
+                    sel.size = 1;
+                    for (size_t i = ndims; i > 0; --i) {
+                        auto d = i - 1;
+                        sel.starts[d] = (task % grid[d]) * blocks[d];
+                        task /= grid[d];
+                        sel.counts[d] = std::min(dimensions[d] - sel.starts[d], blocks[d]);
+                        sel.size *= sel.counts[d];
+                    }
+
+                    size_t stride = 1;
+                    for (size_t i = ndims; i > 0; --i) {
+                        auto d = layout[i - 1];
+                        sel.strides[d] = stride;
+                        stride *= sel.counts[d];
+                    }
+
+                    serialize([&]() -> void {
+                        sel.file_space.selectHyperslab(H5S_SELECT_SET, sel.counts.data(), sel.starts.data());
+                        sel.memory_space.setExtentSimple(ndims, sel.counts.data());
+                    });
+
+                    fun(static_cast<const NdBlockSelection&>(sel), state);
+                }
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+                throw;
+            }
+        }
+    });
+
+    return states;
+}
+
+/**
+ * Overload of `parallel_iterate_nd_dataset()` with default options, i.e., row-major blocks.
+ *
+ * @tparam State_ Per-worker state, which should be default-constructible.
+ * @tparam Function_ Function to process each block.
+ * This should accept a `const NdBlockSelection&` and a `State_&`.
+ *
+ * @param dimensions Dataset dimension extents.
+ * @param blocks Block dimensions, typically obtained from `pick_nd_block_dimensions()`.
+ * @param num_threads Number of worker threads.
+ * @param fun Function to process each block.
+ *
+ * @return Vector of per-worker states.
+ */
+template<class State_, class Function_>
+std::vector<State_> parallel_iterate_nd_dataset(const std::vector<hsize_t>& dimensions, const std::vector<hsize_t>& blocks, int num_threads, Function_ fun) {
+    return parallel_iterate_nd_dataset<State_>(dimensions, blocks, num_threads, ParallelIterateNdDatasetOptions(), std::move(fun));
+}
+
+}
+
+}
+
+#endif
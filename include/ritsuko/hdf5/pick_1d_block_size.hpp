@@ -3,6 +3,11 @@
 
 #include "H5Cpp.h"
 
+#include <vector>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+
 /**
  * @file pick_1d_block_size.hpp
  * @brief Pick a block size for a 1-dimensional HDF5 dataset.
@@ -47,6 +52,64 @@ inline hsize_t pick_1d_block_size(const H5::DSetCreatPropList& cplist, hsize_t f
     return num_chunks * chunk_size;
 }
 
+/**
+ * Pick a block size to use for lockstep 1-dimensional iteration over multiple datasets of the same length, e.g., columns of a data frame.
+ * For compressed datasets, this aims to be the largest multiple of the least common multiple of all chunk sizes that fits into the buffer,
+ * such that each block is aligned to the chunk boundaries of every dataset.
+ * If the least common multiple does not fit, the block size is chosen by `pick_1d_block_size()` for the dataset with the largest chunks;
+ * blocks will then be aligned to that dataset's chunks but may straddle chunk boundaries in the other datasets.
+ *
+ * @param cplists The creation property lists for all datasets.
+ * @param full_length Length of each dataset, e.g., from `get_1d_length()`.
+ * @param buffer_size Size of the buffer in terms of the number of elements per dataset.
+ *
+ * @return The block size (in terms of the number of elements).
+ */
+inline hsize_t pick_shared_1d_block_size(const std::vector<H5::DSetCreatPropList>& cplists, hsize_t full_length, hsize_t buffer_size = 10000) {
+    if (full_length < buffer_size) {
+        return full_length;
+    }
+
+    hsize_t common = 1, largest = 0;
+    size_t largest_index = 0;
+    bool fits = true;
+    for (size_t i = 0; i < cplists.size(); ++i) {
+        const auto& cplist = cplists[i];
+        if (cplist.getLayout() != H5D_CHUNKED) {
+            continue;
+        }
+
+        hsize_t chunk_size;
+        cplist.getChunk(1, &chunk_size);
+        if (chunk_size > largest) {
+            largest = chunk_size;
+            largest_index = i;
+        }
+
+        if (fits) {
+            hsize_t scaled = common / std::gcd(common, chunk_size);
+            if (scaled > std::numeric_limits<hsize_t>::max() / chunk_size) {
+                fits = false;
+            } else {
+                common = scaled * chunk_size;
+            }
+        }
+    }
+
+    if (largest == 0) {
+        return buffer_size;
+    }
+
+    // Each block can be as large as the buffer, or a single chunk of the
+    // largest dataset, whichever is larger; this mimics pick_1d_block_size().
+    hsize_t limit = std::min(std::max(buffer_size, largest), full_length);
+    if (fits && common <= limit) {
+        return (limit / common) * common;
+    }
+
+    return pick_1d_block_size(cplists[largest_index], full_length, buffer_size);
+}
+
 }
 
 }
@@ -0,0 +1,209 @@
+#ifndef RITSUKO_HDF5_READ_DATASET_INTO_HPP
+#define RITSUKO_HDF5_READ_DATASET_INTO_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#include "pick_1d_block_size.hpp"
+#include "pick_nd_block_dimensions.hpp"
+#include "IterateNdDataset.hpp"
+#include "get_1d_length.hpp"
+#include "get_dimensions.hpp"
+#include "get_name.hpp"
+#include "NumericBlockReader.hpp"
+
+/**
+ * @file read_dataset_into.hpp
+ * @brief Read numeric datasets directly into user-supplied memory.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * Read a contiguous range of a 1-dimensional numeric dataset directly into a user-supplied array.
+ * Values are read in blocks with boundaries defined by `pick_1d_block_size()`, so each read is aligned to the dataset's chunks.
+ * Unlike `Stream1dNumericDataset`, each block is written straight into `output` without any intermediate buffering,
+ * other than the staging buffer used by `NumericBlockReader` for in-library type conversions.
+ *
+ * @tparam Type_ Type of the number in memory.
+ * @param handle Handle to the HDF5 dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param start Index of the first element of the range.
+ * @param length Length of the range.
+ * `start + length` should be no greater than `full_length`.
+ * @param[out] output Pointer to an array of length no less than `length`.
+ * On return, this is filled with the values of the range.
+ * @param buffer_size Size of each block to read, in terms of the number of elements.
+ * Smaller values reduce the memory usage of HDF5's internal type conversion buffers at the cost of more reads.
+ */
+template<typename Type_>
+void read_1d_numeric_dataset_into(const H5::DataSet& handle, hsize_t full_length, hsize_t start, hsize_t length, Type_* output, hsize_t buffer_size) {
+    if (start > full_length || length > full_length - start) {
+        throw std::runtime_error("requested range is out of bounds for the dataset at '" + get_name(handle) + "'");
+    }
+    if (length == 0) {
+        return;
+    }
+
+    hsize_t block_size = pick_1d_block_size(handle.getCreatePlist(), full_length, buffer_size);
+    H5::DataSpace mspace(1, &block_size), dspace(1, &full_length);
+    NumericBlockReader<Type_> reader(&handle);
+
+    hsize_t end = start + length;
+    hsize_t position = start;
+    while (position < end) {
+        // Snapping to the next block boundary so that reads stay aligned to the chunks.
+        hsize_t next = std::min(end, (position / block_size + 1) * block_size);
+        hsize_t available = next - position;
+        constexpr hsize_t zero = 0;
+        mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+        dspace.selectHyperslab(H5S_SELECT_SET, &available, &position);
+        reader.read(output + (position - start), available, mspace, dspace);
+        position = next;
+    }
+}
+
+/**
+ * Overload of `read_1d_numeric_dataset_into()` that reads the entire dataset.
+ *
+ * @tparam Type_ Type of the number in memory.
+ * @param handle Handle to the HDF5 dataset.
+ * @param full_length Length of the dataset as a 1-dimensional vector.
+ * @param[out] output Pointer to an array of length no less than `full_length`.
+ * On return, this is filled with the contents of the dataset.
+ * @param buffer_size Size of each block to read, in terms of the number of elements.
+ */
+template<typename Type_>
+void read_1d_numeric_dataset_into(const H5::DataSet& handle, hsize_t full_length, Type_* output, hsize_t buffer_size) {
+    read_1d_numeric_dataset_into(handle, full_length, 0, full_length, output, buffer_size);
+}
+
+/**
+ * Overload of `read_1d_numeric_dataset_into()` that reads the entire dataset and determines its length via `get_1d_length()`.
+ *
+ * @tparam Type_ Type of the number in memory.
+ * @param handle Handle to the HDF5 dataset.
+ * @param[out] output Pointer to an array of length no less than the length of the dataset.
+ * On return, this is filled with the contents of the dataset.
+ * @param buffer_size Size of each block to read, in terms of the number of elements.
+ */
+template<typename Type_>
+void read_1d_numeric_dataset_into(const H5::DataSet& handle, Type_* output, hsize_t buffer_size) {
+    read_1d_numeric_dataset_into(handle, get_1d_length(handle, false), output, buffer_size);
+}
+
+/**
+ * Read an N-dimensional numeric dataset directly into a user-supplied row-major array.
+ * Values are read in blocks with dimensions defined by `pick_nd_block_dimensions()`, so each read is aligned to the dataset's chunks.
+ * Each block is written straight into its final location in `output` without any intermediate buffering,
+ * unless `NumericBlockReader` performs the type conversion (see `NumericBlockReader::is_in_library()`);
+ * in that case, each block is converted into a contiguous buffer and then copied into `output`.
+ *
+ * The destination array may be larger than the dataset, e.g., to pad each row to a multiple of the SIMD width or to embed the dataset in a larger array.
+ * This is specified via `memory_dimensions`, which defines the extents of the row-major array referenced by `output`.
+ * The dataset is then stored in the hyperslab of the destination array that starts at the origin and has extents equal to `dimensions`.
+ * Equivalently, the stride of dimension `d` in `output` is the product of `memory_dimensions[d + 1]`, `memory_dimensions[d + 2]`, etc.
+ *
+ * @tparam Type_ Type of the number in memory.
+ * @param handle Handle to the HDF5 dataset.
+ * @param dimensions Dimensions of the dataset, typically from `get_dimensions()`.
+ * @param[out] output Pointer to a row-major array with extents defined by `memory_dimensions`.
+ * On return, this is filled with the contents of the dataset.
+ * Elements outside of the hyperslab described above are not modified.
+ * @param memory_dimensions Extents of the destination array.
+ * This should have the same length as `dimensions`, where each entry is no less than its counterpart in `dimensions`.
+ * @param buffer_size Size of each block to read, in terms of the number of elements.
+ */
+template<typename Type_>
+void read_nd_numeric_dataset_into(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, Type_* output, const std::vector<hsize_t>& memory_dimensions, hsize_t buffer_size) {
+    size_t ndims = dimensions.size();
+    if (memory_dimensions.size() != ndims) {
+        throw std::runtime_error("memory dimensions should have the same length as the dimensions of the dataset at '" + get_name(handle) + "'");
+    }
+    for (size_t d = 0; d < ndims; ++d) {
+        if (memory_dimensions[d] < dimensions[d]) {
+            throw std::runtime_error("memory dimensions should be no less than the dimensions of the dataset at '" + get_name(handle) + "'");
+        }
+    }
+
+    auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
+    IterateNdDataset iter(dimensions, std::move(blocks));
+    NumericBlockReader<Type_> reader(&handle);
+
+    if (!reader.is_in_library()) {
+        // HDF5 can write each block directly into the strided destination.
+        H5::DataSpace mspace(ndims, memory_dimensions.data());
+        while (!iter.finished()) {
+            mspace.selectHyperslab(H5S_SELECT_SET, iter.counts().data(), iter.starts().data());
+            reader.read(output, iter.current_block_size(), mspace, iter.file_space());
+            iter.next();
+        }
+        return;
+    }
+
+    // Otherwise, each block is converted into a contiguous buffer first, and
+    // then each of its rows is copied into the destination.
+    std::vector<Type_> buffer;
+    std::vector<hsize_t> strides(ndims, 1), position(ndims);
+    for (size_t d = ndims; d > 1; --d) {
+        strides[d - 2] = strides[d - 1] * memory_dimensions[d - 1];
+    }
+
+    while (!iter.finished()) {
+        hsize_t block_size = iter.current_block_size();
+        buffer.resize(block_size);
+        reader.read(buffer.data(), block_size, iter.memory_space(), iter.file_space());
+
+        if (block_size) {
+            const auto& starts = iter.starts();
+            const auto& counts = iter.counts();
+            hsize_t row_length = (ndims ? counts[ndims - 1] : 1);
+            std::fill(position.begin(), position.end(), 0);
+
+            for (hsize_t b = 0; b < block_size; b += row_length) {
+                hsize_t offset = 0;
+                for (size_t d = 0; d < ndims; ++d) {
+                    offset += (starts[d] + position[d]) * strides[d];
+                }
+                std::copy_n(buffer.data() + b, row_length, output + offset);
+
+                // Advancing to the next row within the block.
+                for (size_t d = ndims; d > 1; --d) {
+                    if (++position[d - 2] < counts[d - 2]) {
+                        break;
+                    }
+                    position[d - 2] = 0;
+                }
+            }
+        }
+
+        iter.next();
+    }
+}
+
+/**
+ * Overload of `read_nd_numeric_dataset_into()` where the destination array has the same dimensions as the dataset.
+ *
+ * @tparam Type_ Type of the number in memory.
+ * @param handle Handle to the HDF5 dataset.
+ * @param dimensions Dimensions of the dataset, typically from `get_dimensions()`.
+ * @param[out] output Pointer to a row-major array with extents equal to `dimensions`.
+ * On return, this is filled with the contents of the dataset.
+ * @param buffer_size Size of each block to read, in terms of the number of elements.
+ */
+template<typename Type_>
+void read_nd_numeric_dataset_into(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, Type_* output, hsize_t buffer_size) {
+    read_nd_numeric_dataset_into(handle, dimensions, output, dimensions, buffer_size);
+}
+
+}
+
+}
+
+#endif
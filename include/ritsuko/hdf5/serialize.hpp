@@ -0,0 +1,52 @@
+#ifndef RITSUKO_HDF5_SERIALIZE_HPP
+#define RITSUKO_HDF5_SERIALIZE_HPP
+
+#include <mutex>
+
+/**
+ * @file serialize.hpp
+ * @brief Serialize calls to the HDF5 library.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+/**
+ * @return Reference to a global mutex that protects calls to the HDF5 library.
+ */
+inline std::mutex& fetch_default_mutex() {
+    static std::mutex hdf5_lock;
+    return hdf5_lock;
+}
+
+/**
+ * Execute a function that calls the HDF5 library, while holding the global HDF5 lock.
+ * This is necessary when HDF5 calls are made from multiple threads, as HDF5 itself is not thread-safe unless specifically built to be so.
+ * Parallelized functions in **ritsuko** restrict all HDF5 calls to `serialize()`, leaving only the CPU-bound work to run concurrently.
+ *
+ * By default, this locks the mutex returned by `fetch_default_mutex()`.
+ * Applications can define a `RITSUKO_HDF5_PARALLEL_LOCK` function-like macro to use their own locking mechanism, e.g., if HDF5 calls are already serialized elsewhere.
+ * The macro should accept `fun` and execute it while holding the lock.
+ * Alternatively, if the linked HDF5 library is thread-safe, `RITSUKO_HDF5_NO_PARALLEL_LOCK` can be defined to skip locking altogether.
+ *
+ * @tparam Function_ Function that accepts no arguments.
+ * @param fun Function to be executed.
+ */
+template<class Function_>
+void serialize(Function_ fun) {
+#ifdef RITSUKO_HDF5_PARALLEL_LOCK
+    RITSUKO_HDF5_PARALLEL_LOCK(fun);
+#else
+#ifndef RITSUKO_HDF5_NO_PARALLEL_LOCK
+    std::lock_guard<std::mutex> lck(fetch_default_mutex());
+#endif
+    fun();
+#endif
+}
+
+}
+
+}
+
+#endif
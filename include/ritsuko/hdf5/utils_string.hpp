@@ -3,6 +3,10 @@
 
 #include "H5Cpp.h"
 
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
 /**
  * @file utils_string.hpp
  * @brief Utilities for dealing with HDF5 strings.
@@ -21,9 +25,110 @@ namespace hdf5 {
  * @return The number of characters to the first occurence of the null terminator or `max`, depending on which is smaller.
  */
 inline size_t find_string_length(const char* ptr, size_t max) {
-    size_t j = 0;
-    for (; j < max && ptr[j] != '\0'; ++j) {}
-    return j;
+    // memchr() is typically vectorized by the standard library.
+    auto found = static_cast<const char*>(std::memchr(ptr, '\0', max));
+    return (found == NULL ? max : static_cast<size_t>(found - ptr));
+}
+
+/**
+ * Get the lengths of multiple fixed-width strings, e.g., from a block of a fixed-length string dataset.
+ * Each length is defined as described for `find_string_length()`.
+ *
+ * @param ptr Pointer to the start of an array of `number` strings, each of which occupies `width` bytes.
+ * @param width Width of each string.
+ * @param number Number of strings.
+ * @param[out] lengths Pointer to an array of length `number`, to store the length of each string.
+ */
+inline void find_string_lengths(const char* ptr, size_t width, size_t number, size_t* lengths) {
+    // For long strings, the per-call overhead of memchr() is negligible.
+    if (width > 32) {
+        for (size_t i = 0; i < number; ++i, ptr += width) {
+            lengths[i] = find_string_length(ptr, width);
+        }
+        return;
+    }
+
+    // For short strings, we scan every byte without early termination. This
+    // is branch-free and allows the compiler to vectorize the inner loop.
+    for (size_t i = 0; i < number; ++i, ptr += width) {
+        size_t len = width;
+        for (size_t j = width; j > 0; --j) {
+            len = (ptr[j - 1] == '\0' ? j - 1 : len);
+        }
+        lengths[i] = len;
+    }
+}
+
+/**
+ * Find the first invalid byte in a putative UTF-8 string.
+ * This checks for truncated or unexpected continuation bytes, overlong encodings, surrogates and code points beyond U+10FFFF.
+ * Runs of ASCII characters are skipped 16 bytes at a time, so validation of mostly-ASCII text proceeds at close to memory bandwidth.
+ *
+ * @param ptr Pointer to the start of a string.
+ * @param len Length of the string.
+ *
+ * @return Position of the first byte of the first invalid sequence in the string.
+ * This is equal to `len` if the string is valid UTF-8.
+ */
+inline size_t find_invalid_utf8(const char* ptr, size_t len) {
+    auto uptr = reinterpret_cast<const unsigned char*>(ptr);
+    constexpr uint64_t high_bits = 0x8080808080808080ull;
+    size_t i = 0;
+
+    while (i < len) {
+        // ASCII fast path: checking the high bit of 16 bytes at once.
+        while (len - i >= 16) {
+            uint64_t first, second;
+            std::memcpy(&first, uptr + i, 8);
+            std::memcpy(&second, uptr + i + 8, 8);
+            if ((first | second) & high_bits) {
+                break;
+            }
+            i += 16;
+        }
+        if (i == len) {
+            break;
+        }
+
+        unsigned char lead = uptr[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+
+        size_t ncont;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            ncont = 1;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            ncont = 2;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            ncont = 3;
+        } else {
+            return i; // continuation byte, overlong 2-byte lead, or beyond U+10FFFF.
+        }
+
+        if (len - i <= ncont) {
+            return i;
+        }
+        for (size_t k = 1; k <= ncont; ++k) {
+            if ((uptr[i + k] & 0xC0) != 0x80) {
+                return i;
+            }
+        }
+
+        unsigned char next = uptr[i + 1];
+        if ((lead == 0xE0 && next < 0xA0) || // overlong 3-byte encoding.
+            (lead == 0xED && next > 0x9F) || // UTF-16 surrogates.
+            (lead == 0xF0 && next < 0x90) || // overlong 4-byte encoding.
+            (lead == 0xF4 && next > 0x8F))   // beyond U+10FFFF.
+        {
+            return i;
+        }
+
+        i += ncont + 1;
+    }
+
+    return len;
 }
 
 /**
@@ -4,6 +4,10 @@
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 
 #include "H5Cpp.h"
 
@@ -13,7 +17,11 @@
 #include "pick_1d_block_size.hpp"
 #include "pick_nd_block_dimensions.hpp"
 #include "IterateNdDataset.hpp"
+#include "parallel_iterate_nd_dataset.hpp"
+#include "serialize.hpp"
 #include "utils_string.hpp"
+#include "StreamStats.hpp"
+#include "VariableStringArena.hpp"
 
 /**
  * @file validate_string.hpp
@@ -49,21 +57,55 @@ inline void validate_scalar_string_dataset(const H5::DataSet& handle) {
 /**
  * Check that a 1-dimensional string dataset is valid.
  * Currently, this involves checking that there are no `NULL` entries for variable-length string datatypes.
- * For fixed-width string datasets, this function is a no-op.
+ * For fixed-width string datasets, this function is a no-op unless `check_utf8 = true`.
+ *
+ * @tparam Allocator_ Allocator for the buffer of loaded strings, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
  *
  * @param handle Handle to the HDF5 string dataset.
  * @param full_length Length of the dataset as a 1-dimensional vector.
  * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param[out] stats Pointer to an I/O statistics object.
+ * If not `NULL`, the statistics for the validation are added to this object on successful completion.
+ * This is only filled if `RITSUKO_HDF5_STREAM_STATS` is defined.
+ * @param check_utf8 Whether to check that each string contains valid UTF-8, see `find_invalid_utf8()`.
+ * If `true`, an error is raised that reports the index of the first invalid string.
+ * @param allocator Allocator instance for the buffers, e.g., a `std::pmr::polymorphic_allocator` with a specific memory resource.
  */
-inline void validate_1d_string_dataset(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size) {
+template<class Allocator_ = std::allocator<char*> >
+void validate_1d_string_dataset(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, StreamStats* stats = NULL, bool check_utf8 = false, const Allocator_& allocator = Allocator_()) {
     auto dtype = handle.getDataType();
-    if (!dtype.isVariableStr()) {
+    bool is_variable = dtype.isVariableStr();
+    if (!is_variable && !check_utf8) {
         return;
     }
 
     hsize_t block_size = pick_1d_block_size(handle.getCreatePlist(), full_length, buffer_size);
     H5::DataSpace mspace(1, &block_size), dspace(1, &full_length);
-    std::vector<char*> buffer(block_size);
+    typedef std::allocator_traits<Allocator_> AllocatorTraits;
+    typedef typename AllocatorTraits::template rebind_alloc<char*> BufferAllocator;
+    typedef typename AllocatorTraits::template rebind_alloc<char> FixBufferAllocator;
+    typedef typename AllocatorTraits::template rebind_alloc<size_t> FixLengthsAllocator;
+    std::vector<char*, BufferAllocator> buffer{ BufferAllocator(allocator) };
+    std::vector<char, FixBufferAllocator> fix_buffer{ FixBufferAllocator(allocator) };
+    std::vector<size_t, FixLengthsAllocator> fix_lengths{ FixLengthsAllocator(allocator) };
+    size_t fixed_length = 0;
+    VariableStringArena arena;
+    StreamStatsRecorder recorder;
+
+    if (is_variable) {
+        buffer.resize(block_size);
+    } else {
+        fixed_length = dtype.getSize();
+        fix_buffer.resize(fixed_length * block_size);
+        fix_lengths.resize(block_size);
+    }
+    recorder.record_allocation(buffer.size() * sizeof(char*) + fix_buffer.size() + fix_lengths.size() * sizeof(size_t));
+
+    auto check_string = [&](hsize_t index, const char* ptr, size_t len) -> void {
+        if (find_invalid_utf8(ptr, len) != len) {
+            throw std::runtime_error("invalid UTF-8 in string " + std::to_string(index) + " of '" + get_name(handle) + "'");
+        }
+    };
 
     for (hsize_t i = 0; i < full_length; i += block_size) {
         auto available = std::min(full_length - i, block_size);
@@ -71,14 +113,36 @@ inline void validate_1d_string_dataset(const H5::DataSet& handle, hsize_t full_l
         mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
         dspace.selectHyperslab(H5S_SELECT_SET, &available, &i);
 
-        handle.read(buffer.data(), dtype, mspace, dspace);
-        [[maybe_unused]] VariableStringCleaner deletor(dtype.getId(), mspace.getId(), buffer.data());
-        for (hsize_t j = 0; j < available; ++j) {
-            if (buffer[j] == NULL) {
-                throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(handle) + "'");
+        if (is_variable) {
+            arena.reset();
+            recorder.record_read(available, available * sizeof(char*), [&]() -> void {
+                handle.read(buffer.data(), dtype, mspace, dspace, arena.transfer_plist());
+            });
+            recorder.record_block();
+            for (hsize_t j = 0; j < available; ++j) {
+                if (buffer[j] == NULL) {
+                    throw std::runtime_error("detected a NULL pointer for a variable length string in '" + get_name(handle) + "'");
+                }
+                if (check_utf8) {
+                    check_string(i + j, buffer[j], std::strlen(buffer[j]));
+                }
+            }
+
+        } else {
+            recorder.record_read(available, available * fixed_length, [&]() -> void {
+                handle.read(fix_buffer.data(), dtype, mspace, dspace);
+            });
+            recorder.record_block();
+            find_string_lengths(fix_buffer.data(), fixed_length, available, fix_lengths.data());
+            for (hsize_t j = 0; j < available; ++j) {
+                check_string(i + j, fix_buffer.data() + j * fixed_length, fix_lengths[j]);
             }
         }
     }
+
+    if (stats) {
+        *stats += recorder.get();
+    }
 }
 
 /**
@@ -90,43 +154,128 @@ inline void validate_1d_string_dataset(const H5::DataSet& handle, hsize_t buffer
     validate_1d_string_dataset(handle, get_1d_length(handle, false), buffer_size);
 }
 
+/**
+ * @cond
+ */
+namespace internal {
+
+inline hsize_t block_offset_to_index(const std::vector<hsize_t>& starts, const std::vector<hsize_t>& counts, const std::vector<hsize_t>& dimensions, size_t offset) {
+    size_t ndims = dimensions.size();
+
+    std::vector<hsize_t> coordinates(ndims);
+    for (size_t d = ndims; d > 0; --d) {
+        coordinates[d - 1] = starts[d - 1] + offset % counts[d - 1];
+        offset /= counts[d - 1];
+    }
+
+    hsize_t index = 0;
+    for (size_t d = 0; d < ndims; ++d) {
+        index = index * dimensions[d] + coordinates[d];
+    }
+    return index;
+}
+
+inline hsize_t block_offset_to_index(const IterateNdDataset& iter, size_t offset) {
+    return block_offset_to_index(iter.starts(), iter.counts(), iter.dimensions(), offset);
+}
+
+}
+/**
+ * @endcond
+ */
+
 /**
  * Check that an N-dimensional string dataset is valid.
  * Currently, this involves checking that there are no `NULL` entries for variable-length string datatypes.
- * For fixed-width string datasets, this function is a no-op.
+ * For fixed-width string datasets, this function is a no-op unless `check_utf8 = true`.
+ *
+ * @tparam Allocator_ Allocator for the buffer of loaded strings, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
  *
  * @param handle Handle to the HDF5 string dataset.
  * @param dimensions Dimensions of the dataset.
  * @param buffer_size Size of the buffer for holding loaded strings.
+ * @param[out] stats Pointer to an I/O statistics object.
+ * If not `NULL`, the statistics for the validation are added to this object on successful completion.
+ * This is only filled if `RITSUKO_HDF5_STREAM_STATS` is defined.
+ * @param check_utf8 Whether to check that each string contains valid UTF-8, see `find_invalid_utf8()`.
+ * If `true`, an error is raised that reports the row-major index of the first invalid string to be encountered.
+ * @param allocator Allocator instance for the buffers, e.g., a `std::pmr::polymorphic_allocator` with a specific memory resource.
  */
-inline void validate_nd_string_dataset(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t buffer_size) {
+template<class Allocator_ = std::allocator<char*> >
+void validate_nd_string_dataset(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t buffer_size, StreamStats* stats = NULL, bool check_utf8 = false, const Allocator_& allocator = Allocator_()) {
     auto stype = handle.getDataType();
-    if (!stype.isVariableStr()) {
+    bool is_variable = stype.isVariableStr();
+    if (!is_variable && !check_utf8) {
         return;
     }
 
     auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
     IterateNdDataset iter(dimensions, blocks);
-    std::vector<char*> buffer;
+    typedef std::allocator_traits<Allocator_> AllocatorTraits;
+    typedef typename AllocatorTraits::template rebind_alloc<char*> BufferAllocator;
+    typedef typename AllocatorTraits::template rebind_alloc<char> FixBufferAllocator;
+    typedef typename AllocatorTraits::template rebind_alloc<size_t> FixLengthsAllocator;
+    std::vector<char*, BufferAllocator> buffer{ BufferAllocator(allocator) };
+    std::vector<char, FixBufferAllocator> fix_buffer{ FixBufferAllocator(allocator) };
+    std::vector<size_t, FixLengthsAllocator> fix_lengths{ FixLengthsAllocator(allocator) };
+    size_t fixed_length = (is_variable ? 0 : stype.getSize());
+    VariableStringArena arena;
+    StreamStatsRecorder recorder;
+
+    auto check_string = [&](size_t offset, const char* ptr, size_t len) -> void {
+        if (find_invalid_utf8(ptr, len) != len) {
+            throw std::runtime_error("invalid UTF-8 in string " + std::to_string(internal::block_offset_to_index(iter, offset)) + " of '" + get_name(handle) + "'");
+        }
+    };
 
     while (!iter.finished()) {
-        buffer.resize(iter.current_block_size());
-
-        // Scope this to ensure that 'mspace' doesn't get changed by
-        // 'iter.next()' before the destructor is called.
-        {
-            const auto& mspace = iter.memory_space();
-            [[maybe_unused]] VariableStringCleaner stream(stype.getId(), mspace.getId(), buffer.data());
-            handle.read(buffer.data(), stype, mspace, iter.file_space());
-            for (auto x : buffer) {
-                if (x == NULL) {
+        size_t current = iter.current_block_size();
+
+        if (is_variable) {
+            auto old_capacity = buffer.capacity();
+            buffer.resize(current);
+            if (buffer.capacity() != old_capacity) {
+                recorder.record_allocation(buffer.capacity() * sizeof(char*));
+            }
+
+            arena.reset();
+            recorder.record_read(current, current * sizeof(char*), [&]() -> void {
+                handle.read(buffer.data(), stype, iter.memory_space(), iter.file_space(), arena.transfer_plist());
+            });
+            recorder.record_block();
+            for (size_t j = 0; j < current; ++j) {
+                if (buffer[j] == NULL) {
                     throw std::runtime_error("detected NULL pointer in a variable-length string dataset");
                 }
+                if (check_utf8) {
+                    check_string(j, buffer[j], std::strlen(buffer[j]));
+                }
+            }
+
+        } else {
+            auto old_capacity = fix_buffer.capacity();
+            fix_buffer.resize(current * fixed_length);
+            fix_lengths.resize(current);
+            if (fix_buffer.capacity() != old_capacity) {
+                recorder.record_allocation(fix_buffer.capacity() + fix_lengths.capacity() * sizeof(size_t));
+            }
+
+            recorder.record_read(current, current * fixed_length, [&]() -> void {
+                handle.read(fix_buffer.data(), stype, iter.memory_space(), iter.file_space());
+            });
+            recorder.record_block();
+            find_string_lengths(fix_buffer.data(), fixed_length, current, fix_lengths.data());
+            for (size_t j = 0; j < current; ++j) {
+                check_string(j, fix_buffer.data() + j * fixed_length, fix_lengths[j]);
             }
         }
 
         iter.next();
     }
+
+    if (stats) {
+        *stats += recorder.get();
+    }
 }
 
 /**
@@ -139,6 +288,99 @@ inline void validate_nd_string_dataset(const H5::DataSet& handle, hsize_t buffer
     validate_nd_string_dataset(handle, dimensions, buffer_size);
 }
 
+/**
+ * @cond
+ */
+namespace internal {
+
+struct ParallelStringValidation {
+    VariableStringArena arena;
+    std::vector<char*> var_buffer;
+    std::vector<char> fix_buffer;
+    std::vector<size_t> fix_lengths;
+    hsize_t first_null = std::numeric_limits<hsize_t>::max();
+    hsize_t first_invalid = std::numeric_limits<hsize_t>::max();
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Multi-threaded version of `validate_nd_string_dataset()`, where blocks are distributed across workers by `parallel_iterate_nd_dataset()`.
+ * Each worker reads its blocks inside `serialize()` and performs the checks outside of the lock.
+ * This is most useful with `check_utf8 = true`, where the checks are more expensive than the reads.
+ *
+ * Unlike `validate_nd_string_dataset()`, all blocks are processed before an error is raised.
+ * If any `NULL` entries are present, an error is raised for the `NULL` entry with the lowest row-major index;
+ * otherwise, if any strings contain invalid UTF-8, an error is raised for the invalid string with the lowest row-major index.
+ * This ensures that the error message is the same regardless of how the blocks were distributed across workers.
+ *
+ * @param handle Handle to the HDF5 string dataset.
+ * @param dimensions Dimensions of the dataset.
+ * @param buffer_size Size of the buffer for holding loaded strings in each worker.
+ * @param num_threads Number of worker threads.
+ * @param check_utf8 Whether to check that each string contains valid UTF-8, see `find_invalid_utf8()`.
+ */
+inline void parallel_validate_nd_string_dataset(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t buffer_size, int num_threads, bool check_utf8 = false) {
+    auto stype = handle.getDataType();
+    bool is_variable = stype.isVariableStr();
+    if (!is_variable && !check_utf8) {
+        return;
+    }
+
+    auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
+    size_t fixed_length = (is_variable ? 0 : stype.getSize());
+
+    auto states = parallel_iterate_nd_dataset<internal::ParallelStringValidation>(dimensions, blocks, num_threads, [&](const NdBlockSelection& block, internal::ParallelStringValidation& state) -> void {
+        auto check_string = [&](size_t offset, const char* ptr, size_t len) -> void {
+            if (find_invalid_utf8(ptr, len) != len) {
+                state.first_invalid = std::min(state.first_invalid, internal::block_offset_to_index(block.starts, block.counts, dimensions, offset));
+            }
+        };
+
+        if (is_variable) {
+            state.var_buffer.resize(block.size);
+            serialize([&]() -> void {
+                state.arena.reset();
+                handle.read(state.var_buffer.data(), stype, block.memory_space, block.file_space, state.arena.transfer_plist());
+            });
+            for (size_t j = 0; j < block.size; ++j) {
+                auto ptr = state.var_buffer[j];
+                if (ptr == NULL) {
+                    state.first_null = std::min(state.first_null, internal::block_offset_to_index(block.starts, block.counts, dimensions, j));
+                } else if (check_utf8) {
+                    check_string(j, ptr, std::strlen(ptr));
+                }
+            }
+
+        } else {
+            state.fix_buffer.resize(block.size * fixed_length);
+            state.fix_lengths.resize(block.size);
+            serialize([&]() -> void {
+                handle.read(state.fix_buffer.data(), stype, block.memory_space, block.file_space);
+            });
+            find_string_lengths(state.fix_buffer.data(), fixed_length, block.size, state.fix_lengths.data());
+            for (size_t j = 0; j < block.size; ++j) {
+                check_string(j, state.fix_buffer.data() + j * fixed_length, state.fix_lengths[j]);
+            }
+        }
+    });
+
+    hsize_t first_null = std::numeric_limits<hsize_t>::max(), first_invalid = first_null;
+    for (const auto& state : states) {
+        first_null = std::min(first_null, state.first_null);
+        first_invalid = std::min(first_invalid, state.first_invalid);
+    }
+    if (first_null != std::numeric_limits<hsize_t>::max()) {
+        throw std::runtime_error("detected NULL pointer in a variable-length string dataset");
+    }
+    if (first_invalid != std::numeric_limits<hsize_t>::max()) {
+        throw std::runtime_error("invalid UTF-8 in string " + std::to_string(first_invalid) + " of '" + get_name(handle) + "'");
+    }
+}
+
 /**
  * Check that a scalar string attribute is valid.
  * Currently, this involves checking that there are no `NULL` entries for variable-length string datatypes.
@@ -7,11 +7,13 @@
 #include <string>
 #include <stdexcept>
 #include <cstdint>
+#include <memory>
 
 #include "../pick_1d_block_size.hpp"
 #include "../get_1d_length.hpp"
 #include "../get_name.hpp"
 #include "../utils_string.hpp"
+#include "../StreamStats.hpp"
 #include "Pointer.hpp"
 
 /**
@@ -30,11 +32,13 @@ namespace vls {
  *
  * @tparam Offset_ Unsigned integer type for the starting offset on the heap. 
  * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Allocator_ Allocator for the block buffers, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
+ * This is rebound to the element type of each buffer.
  *
  * This streams in a 1-dimensional VLS array in contiguous blocks, using block sizes defined by `pick_1d_block_size()`.
  * Callers can then iterate over the individual strings.
  */
-template<typename Offset_, typename Length_>
+template<typename Offset_, typename Length_, class Allocator_ = std::allocator<uint8_t> >
 class Stream1dArray {
 public:
     /**
@@ -43,8 +47,9 @@ public:
      * @param length Length of the `pointers` dataset as a 1-dimensional vector.
      * @param buffer_size Size of the buffer for holding streamed blocks of strings.
      * Larger buffers improve speed at the cost of some memory efficiency.
+     * @param allocator Allocator for the block buffers.
      */
-    Stream1dArray(const H5::DataSet* pointers, const H5::DataSet* heap, hsize_t length, hsize_t buffer_size) : 
+    Stream1dArray(const H5::DataSet* pointers, const H5::DataSet* heap, hsize_t length, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
         my_pointers(pointers), 
         my_heap(heap),
         my_pointer_full_length(length), 
@@ -54,9 +59,11 @@ public:
         my_pointer_dspace(1, &my_pointer_full_length),
         my_heap_dspace(1, &my_heap_full_length),
         my_pointer_dtype(define_pointer_datatype<Offset_, Length_>()),
-        my_pointer_buffer(my_pointer_block_size),
-        my_final_buffer(my_pointer_block_size)
+        my_pointer_buffer(my_pointer_block_size, allocator),
+        my_heap_buffer(allocator),
+        my_final_buffer(my_pointer_block_size, allocator)
     {
+        my_recorder.record_allocation(my_pointer_buffer.size() * sizeof(Pointer<Offset_, Length_>) + my_final_buffer.size() * sizeof(std::string));
     }
 
     /**
@@ -66,9 +73,10 @@ public:
      * @param heap Pointer to a 1-dimensional HDF5 dataset containing the VLS heap, see `open_heap()`.
      * @param buffer_size Size of the buffer for holding streamed blocks of strings.
      * Larger buffers improve speed at the cost of some memory efficiency.
+     * @param allocator Allocator for the block buffers.
      */
-    Stream1dArray(const H5::DataSet* pointers, const H5::DataSet* heap, hsize_t buffer_size) : 
-        Stream1dArray(pointers, heap, get_1d_length(pointers->getSpace(), false), buffer_size) 
+    Stream1dArray(const H5::DataSet* pointers, const H5::DataSet* heap, hsize_t buffer_size, const Allocator_& allocator = Allocator_()) : 
+        Stream1dArray(pointers, heap, get_1d_length(pointers->getSpace(), false), buffer_size, allocator) 
     {}
 
 public:
@@ -119,6 +127,22 @@ public:
         return my_consumed + my_last_loaded;
     }
 
+    /**
+     * @param check Whether to check that each string contains valid UTF-8, see `find_invalid_utf8()`.
+     * If `true`, an error is raised when loading a block that contains an invalid string, reporting the index of the first such string in the array.
+     */
+    void set_check_utf8(bool check) {
+        my_check_utf8 = check;
+    }
+
+    /**
+     * @return I/O statistics for this stream.
+     * All counters are zero unless `RITSUKO_HDF5_STREAM_STATS` is defined.
+     */
+    StreamStats stats() const {
+        return my_recorder.get();
+    }
+
 private:
     const H5::DataSet* my_pointers;
     const H5::DataSet* my_heap;
@@ -128,9 +152,12 @@ private:
     H5::DataSpace my_heap_mspace, my_heap_dspace;
 
     H5::DataType my_pointer_dtype;
-    std::vector<Pointer<Offset_, Length_> > my_pointer_buffer;
-    std::vector<uint8_t> my_heap_buffer;
-    std::vector<std::string> my_final_buffer;
+    typedef std::allocator_traits<Allocator_> AllocatorTraits;
+    std::vector<Pointer<Offset_, Length_>, typename AllocatorTraits::template rebind_alloc<Pointer<Offset_, Length_> > > my_pointer_buffer;
+    std::vector<uint8_t, typename AllocatorTraits::template rebind_alloc<uint8_t> > my_heap_buffer;
+    std::vector<std::string, typename AllocatorTraits::template rebind_alloc<std::string> > my_final_buffer;
+    bool my_check_utf8 = false;
+    StreamStatsRecorder my_recorder;
 
     hsize_t my_last_loaded = 0;
     hsize_t my_consumed = 0;
@@ -146,7 +173,9 @@ private:
         my_pointer_mspace.selectHyperslab(H5S_SELECT_SET, &my_available, &zero);
         my_pointer_dspace.selectHyperslab(H5S_SELECT_SET, &my_available, &my_last_loaded);
         my_heap_dspace.selectNone();
-        my_pointers->read(my_pointer_buffer.data(), my_pointer_dtype, my_pointer_mspace, my_pointer_dspace);
+        my_recorder.record_read(my_available, my_available * sizeof(Pointer<Offset_, Length_>), [&]() -> void {
+            my_pointers->read(my_pointer_buffer.data(), my_pointer_dtype, my_pointer_mspace, my_pointer_dspace);
+        });
 
         for (size_t i = 0; i < my_available; ++i) {
             const auto& val = my_pointer_buffer[i];
@@ -166,10 +195,21 @@ private:
                 my_heap_mspace.setExtentSimple(1, &count);
                 my_heap_mspace.selectAll();
                 my_heap_dspace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+                auto old_capacity = my_heap_buffer.capacity();
                 my_heap_buffer.resize(count);
-                my_heap->read(my_heap_buffer.data(), H5::PredType::NATIVE_UINT8, my_heap_mspace, my_heap_dspace);
-                const char* text_ptr = reinterpret_cast<const char*>(my_heap_buffer.data());
-                curstr.insert(curstr.end(), text_ptr, text_ptr + find_string_length(text_ptr, count));
+                if (my_heap_buffer.capacity() != old_capacity) {
+                    my_recorder.record_allocation(my_heap_buffer.capacity());
+                }
+                my_recorder.record_read(count, count, [&]() -> void {
+                    my_heap->read(my_heap_buffer.data(), H5::PredType::NATIVE_UINT8, my_heap_mspace, my_heap_dspace);
+                });
+                my_recorder.record_conversion([&]() -> void {
+                    const char* text_ptr = reinterpret_cast<const char*>(my_heap_buffer.data());
+                    curstr.insert(curstr.end(), text_ptr, text_ptr + find_string_length(text_ptr, count));
+                });
+                if (my_check_utf8 && find_invalid_utf8(curstr.data(), curstr.size()) != curstr.size()) {
+                    throw std::runtime_error("invalid UTF-8 in string " + std::to_string(my_last_loaded + i) + " of the VLS array at '" + get_name(*my_pointers) + "'");
+                }
 
                 /*
                  * Is it generally portable to reinterpret_cast the bytes in a
@@ -188,6 +228,7 @@ private:
             }
         }
 
+        my_recorder.record_block();
         my_last_loaded += my_available;
     }
 };
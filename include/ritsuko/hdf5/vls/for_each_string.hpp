@@ -0,0 +1,242 @@
+#ifndef RITSUKO_HDF5_VLS_FOR_EACH_STRING_HPP
+#define RITSUKO_HDF5_VLS_FOR_EACH_STRING_HPP
+
+#include "H5Cpp.h"
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#include "../get_name.hpp"
+#include "../get_1d_length.hpp"
+#include "../get_dimensions.hpp"
+#include "../pick_1d_block_size.hpp"
+#include "../pick_nd_block_dimensions.hpp"
+#include "../IterateNdDataset.hpp"
+#include "../utils_string.hpp"
+#include "../for_each_string.hpp"
+#include "Pointer.hpp"
+
+/**
+ * @file for_each_string.hpp
+ * @brief Visit each string in a VLS array.
+ */
+
+namespace ritsuko {
+
+namespace hdf5 {
+
+namespace vls {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Reads a block of pointers and visits each string in the order of the
+// memory buffer. 'index' maps each position in the buffer to the index of
+// the string in the pointer dataset.
+template<typename Offset_, typename Length_>
+class VlsBlockVisitor {
+public:
+    VlsBlockVisitor(const H5::DataSet& pointers, const H5::DataSet& heap, hsize_t buffer_size) :
+        my_pointers(pointers),
+        my_heap(heap),
+        my_heap_length(get_1d_length(heap.getSpace(), false)),
+        my_buffer_size(buffer_size),
+        my_heap_dspace(1, &my_heap_length),
+        my_dtype(define_pointer_datatype<Offset_, Length_>())
+    {}
+
+    template<class Index_, class Function_>
+    bool visit(size_t number, const H5::DataSpace& mspace, const H5::DataSpace& dspace, Index_ index, Function_& fun) {
+        my_buffer.resize(number);
+        my_pointers.read(my_buffer.data(), my_dtype, mspace, dspace);
+
+        hsize_t lowest = my_heap_length, highest = 0, total = 0;
+        for (size_t j = 0; j < number; ++j) {
+            hsize_t start = my_buffer[j].offset;
+            hsize_t count = my_buffer[j].length;
+            if (start > my_heap_length || start + count > my_heap_length) {
+                throw std::runtime_error("VLS array pointers at '" + get_name(my_pointers) + "' are out of range of the heap at '" + get_name(my_heap) + "'");
+            }
+            if (count) {
+                lowest = std::min(lowest, start);
+                highest = std::max(highest, start + count);
+                total += count;
+            }
+        }
+
+        // Reading the entire span if it's not too sparse, otherwise we'd be
+        // reading a lot of unnecessary bytes from the heap.
+        bool whole = (total && highest - lowest <= std::max(total * 2, my_buffer_size));
+        const char* span = NULL;
+        if (whole) {
+            span = read_heap(lowest, highest - lowest);
+        }
+
+        for (size_t j = 0; j < number; ++j) {
+            hsize_t count = my_buffer[j].length;
+            const char* text = "";
+            if (count) {
+                if (whole) {
+                    text = span + (my_buffer[j].offset - lowest);
+                } else {
+                    text = read_heap(my_buffer[j].offset, count);
+                }
+            }
+            if (!hdf5::internal::visit_string(fun, index(j), text, find_string_length(text, count))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    const H5::DataSet& my_pointers;
+    const H5::DataSet& my_heap;
+    hsize_t my_heap_length;
+    hsize_t my_buffer_size;
+    H5::DataSpace my_heap_mspace, my_heap_dspace;
+    H5::CompType my_dtype;
+    std::vector<Pointer<Offset_, Length_> > my_buffer;
+    std::vector<uint8_t> my_heap_buffer;
+
+    const char* read_heap(hsize_t start, hsize_t count) {
+        my_heap_mspace.setExtentSimple(1, &count);
+        my_heap_mspace.selectAll();
+        my_heap_dspace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+        my_heap_buffer.resize(count);
+        my_heap.read(my_heap_buffer.data(), H5::PredType::NATIVE_UINT8, my_heap_mspace, my_heap_dspace);
+        return reinterpret_cast<const char*>(my_heap_buffer.data());
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Visit each string in a 1-dimensional VLS array, in order.
+ * Pointers are read in chunk-aligned blocks (see `pick_1d_block_size()`) and `fun` is called directly on the bytes of the heap.
+ * For each block of pointers, the span of the heap covering all of the block's strings is read in a single call if it is not much larger than the strings themselves;
+ * otherwise, each string is read separately from the heap.
+ * No memory is allocated for individual strings.
+ *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap.
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Function_ Function to be called on each string, see `hdf5::for_each_1d_string()` for details.
+ * Each string is truncated at its first null terminator, if any, as in `Stream1dArray`.
+ *
+ * @param pointers Handle to a 1-dimensional HDF5 dataset containing the VLS pointers, see `open_pointers()`.
+ * @param heap Handle to a 1-dimensional HDF5 dataset containing the VLS heap, see `open_heap()`.
+ * @param full_length Length of the `pointers` dataset as a 1-dimensional vector.
+ * @param buffer_size Size of the buffer for holding loaded pointers.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited, i.e., `false` if `fun` terminated the iteration early.
+ */
+template<typename Offset_, typename Length_, class Function_>
+bool for_each_1d_string(const H5::DataSet& pointers, const H5::DataSet& heap, hsize_t full_length, hsize_t buffer_size, Function_ fun) {
+    hsize_t block_size = pick_1d_block_size(pointers.getCreatePlist(), full_length, buffer_size);
+    H5::DataSpace mspace(1, &block_size), dspace(1, &full_length);
+    internal::VlsBlockVisitor<Offset_, Length_> visitor(pointers, heap, buffer_size);
+
+    for (hsize_t i = 0; i < full_length; i += block_size) {
+        auto available = std::min(full_length - i, block_size);
+        constexpr hsize_t zero = 0;
+        mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
+        dspace.selectHyperslab(H5S_SELECT_SET, &available, &i);
+        if (!visitor.visit(available, mspace, dspace, [&](size_t j) -> hsize_t { return i + j; }, fun)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Overload of `for_each_1d_string()` that determines the length via `get_1d_length()`.
+ *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap.
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Function_ Function to be called on each string, see `hdf5::for_each_1d_string()` for details.
+ * @param pointers Handle to a 1-dimensional HDF5 dataset containing the VLS pointers, see `open_pointers()`.
+ * @param heap Handle to a 1-dimensional HDF5 dataset containing the VLS heap, see `open_heap()`.
+ * @param buffer_size Size of the buffer for holding loaded pointers.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited.
+ */
+template<typename Offset_, typename Length_, class Function_>
+bool for_each_1d_string(const H5::DataSet& pointers, const H5::DataSet& heap, hsize_t buffer_size, Function_ fun) {
+    return for_each_1d_string<Offset_, Length_>(pointers, heap, get_1d_length(pointers.getSpace(), false), buffer_size, std::move(fun));
+}
+
+/**
+ * Visit each string in an N-dimensional VLS array.
+ * Pointers are read in chunk-aligned blocks (see `pick_nd_block_dimensions()`) and the heap is read as described for `for_each_1d_string()`.
+ * Blocks are visited in the order defined by `IterateNdDataset`, and strings are visited in row-major order within each block;
+ * this means that strings are not necessarily visited in row-major order across the entire dataset.
+ *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap.
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Function_ Function to be called on each string, see `hdf5::for_each_1d_string()` for details.
+ * The index passed to `fun` is the row-major index of the string in the `pointers` dataset.
+ *
+ * @param pointers Handle to a HDF5 dataset containing the VLS pointers, see `open_pointers()`.
+ * @param heap Handle to a 1-dimensional HDF5 dataset containing the VLS heap, see `open_heap()`.
+ * @param dimensions Dimensions of the `pointers` dataset.
+ * @param buffer_size Size of the buffer for holding loaded pointers.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited, i.e., `false` if `fun` terminated the iteration early.
+ */
+template<typename Offset_, typename Length_, class Function_>
+bool for_each_nd_string(const H5::DataSet& pointers, const H5::DataSet& heap, const std::vector<hsize_t>& dimensions, hsize_t buffer_size, Function_ fun) {
+    auto blocks = pick_nd_block_dimensions(pointers.getCreatePlist(), dimensions, buffer_size);
+    IterateNdDataset iter(dimensions, blocks);
+    internal::VlsBlockVisitor<Offset_, Length_> visitor(pointers, heap, buffer_size);
+    hdf5::internal::NdBlockIndexer indexer(dimensions);
+
+    while (!iter.finished()) {
+        indexer.reset(iter.starts(), iter.counts());
+        bool okay = visitor.visit(iter.current_block_size(), iter.memory_space(), iter.file_space(), [&](size_t j) -> hsize_t { return indexer(j); }, fun);
+        if (!okay) {
+            return false;
+        }
+        iter.next();
+    }
+
+    return true;
+}
+
+/**
+ * Overload of `for_each_nd_string()` that automatically determines the dimensions.
+ *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap.
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Function_ Function to be called on each string, see `hdf5::for_each_1d_string()` for details.
+ * @param pointers Handle to a HDF5 dataset containing the VLS pointers, see `open_pointers()`.
+ * @param heap Handle to a 1-dimensional HDF5 dataset containing the VLS heap, see `open_heap()`.
+ * @param buffer_size Size of the buffer for holding loaded pointers.
+ * @param fun Function to be called on each string.
+ *
+ * @return Whether all strings were visited.
+ */
+template<typename Offset_, typename Length_, class Function_>
+bool for_each_nd_string(const H5::DataSet& pointers, const H5::DataSet& heap, hsize_t buffer_size, Function_ fun) {
+    auto dimensions = get_dimensions(pointers, false);
+    return for_each_nd_string<Offset_, Length_>(pointers, heap, dimensions, buffer_size, std::move(fun));
+}
+
+}
+
+}
+
+}
+
+#endif
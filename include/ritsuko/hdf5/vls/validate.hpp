@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <memory>
+#include <algorithm>
 
 #include "H5Cpp.h"
 
@@ -11,6 +13,9 @@
 #include "../pick_1d_block_size.hpp"
 #include "../pick_nd_block_dimensions.hpp"
 #include "../IterateNdDataset.hpp"
+#include "../parallel_iterate_nd_dataset.hpp"
+#include "../serialize.hpp"
+#include "../StreamStats.hpp"
 #include "Pointer.hpp"
 
 /**
@@ -28,17 +33,28 @@ namespace vls {
  * Check that the pointers for a 1-dimensional VLS array is valid.
  * An error is thrown if any pointers are out of range of the associated heap dataset.
  *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap. 
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Allocator_ Allocator for the buffer of loaded pointers, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
+ *
  * @param handle Handle to the pointer dataset for a VLS array, see `open_pointers()`.
  * @param full_length Length of the dataset as a 1-dimensional vector.
  * @param heap_length Length of the heap dataset. 
  * @param buffer_size Size of the buffer for reading pointers by block. 
+ * @param[out] stats Pointer to an I/O statistics object.
+ * If not `NULL`, the statistics for the validation are added to this object on successful completion.
+ * This is only filled if `RITSUKO_HDF5_STREAM_STATS` is defined.
+ * @param allocator Allocator instance for the buffer, e.g., a `std::pmr::polymorphic_allocator` with a specific memory resource.
  */
-template<typename Offset_, typename Length_>
-inline void validate_1d_array(const H5::DataSet& handle, hsize_t full_length, hsize_t heap_length, hsize_t buffer_size) {
+template<typename Offset_, typename Length_, class Allocator_ = std::allocator<Pointer<Offset_, Length_> > >
+inline void validate_1d_array(const H5::DataSet& handle, hsize_t full_length, hsize_t heap_length, hsize_t buffer_size, StreamStats* stats = NULL, const Allocator_& allocator = Allocator_()) {
     hsize_t block_size = pick_1d_block_size(handle.getCreatePlist(), full_length, buffer_size);
     H5::DataSpace mspace(1, &block_size), dspace(1, &full_length);
-    std::vector<Pointer<Offset_, Length_> > buffer(block_size);
+    typedef typename std::allocator_traits<Allocator_>::template rebind_alloc<Pointer<Offset_, Length_> > BufferAllocator;
+    std::vector<Pointer<Offset_, Length_>, BufferAllocator> buffer(block_size, BufferAllocator(allocator));
     auto dtype = define_pointer_datatype<Offset_, Length_>();
+    StreamStatsRecorder recorder;
+    recorder.record_allocation(buffer.size() * sizeof(Pointer<Offset_, Length_>));
 
     for (hsize_t i = 0; i < full_length; i += block_size) {
         auto available = std::min(full_length - i, block_size);
@@ -46,7 +62,10 @@ inline void validate_1d_array(const H5::DataSet& handle, hsize_t full_length, hs
         mspace.selectHyperslab(H5S_SELECT_SET, &available, &zero);
         dspace.selectHyperslab(H5S_SELECT_SET, &available, &i);
 
-        handle.read(buffer.data(), dtype, mspace, dspace);
+        recorder.record_read(available, available * sizeof(Pointer<Offset_, Length_>), [&]() -> void {
+            handle.read(buffer.data(), dtype, mspace, dspace);
+        });
+        recorder.record_block();
         for (hsize_t j = 0; j < available; ++j) {
             const auto& val = buffer[j];
             hsize_t start = val.offset;
@@ -56,32 +75,53 @@ inline void validate_1d_array(const H5::DataSet& handle, hsize_t full_length, hs
             }
         }
     }
+
+    if (stats) {
+        *stats += recorder.get();
+    }
 }
 
 /**
  * Check that the pointers for an N-dimensional VLS array is valid.
  * An error is thrown if any pointers are out of range of the associated heap dataset.
  *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap. 
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ * @tparam Allocator_ Allocator for the buffer of loaded pointers, e.g., `PooledAllocator` or `std::pmr::polymorphic_allocator`.
+ *
  * @param handle Handle to the pointer dataset for a VLS array, see `open_pointers()`.
  * @param dimensions Dimensions of the dataset. 
  * @param heap_length Length of the heap dataset. 
  * @param buffer_size Size of the buffer for reading pointers by block. 
+ * @param[out] stats Pointer to an I/O statistics object.
+ * If not `NULL`, the statistics for the validation are added to this object on successful completion.
+ * This is only filled if `RITSUKO_HDF5_STREAM_STATS` is defined.
+ * @param allocator Allocator instance for the buffer, e.g., a `std::pmr::polymorphic_allocator` with a specific memory resource.
  */
-template<typename Offset_, typename Length_>
-void validate_nd_array(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t heap_length, hsize_t buffer_size) {
-    std::vector<Pointer<Offset_, Length_> > buffer;
+template<typename Offset_, typename Length_, class Allocator_ = std::allocator<Pointer<Offset_, Length_> > >
+void validate_nd_array(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t heap_length, hsize_t buffer_size, StreamStats* stats = NULL, const Allocator_& allocator = Allocator_()) {
+    typedef typename std::allocator_traits<Allocator_>::template rebind_alloc<Pointer<Offset_, Length_> > BufferAllocator;
+    std::vector<Pointer<Offset_, Length_>, BufferAllocator> buffer{ BufferAllocator(allocator) };
     auto dtype = define_pointer_datatype<Offset_, Length_>();
     auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
     IterateNdDataset iter(dimensions, blocks);
+    StreamStatsRecorder recorder;
 
     while (!iter.finished()) {
+        auto old_capacity = buffer.capacity();
         buffer.resize(iter.current_block_size());
+        if (buffer.capacity() != old_capacity) {
+            recorder.record_allocation(buffer.capacity() * sizeof(Pointer<Offset_, Length_>));
+        }
 
         // Scope this to ensure that 'mspace' doesn't get changed by
         // 'iter.next()' before the destructor is called.
         {
             const auto& mspace = iter.memory_space();
-            handle.read(buffer.data(), dtype, mspace, iter.file_space());
+            recorder.record_read(buffer.size(), buffer.size() * sizeof(Pointer<Offset_, Length_>), [&]() -> void {
+                handle.read(buffer.data(), dtype, mspace, iter.file_space());
+            });
+            recorder.record_block();
             for (const auto& val : buffer) {
                 hsize_t start = val.offset;
                 hsize_t count = val.length;
@@ -93,6 +133,55 @@ void validate_nd_array(const H5::DataSet& handle, const std::vector<hsize_t>& di
 
         iter.next();
     }
+
+    if (stats) {
+        *stats += recorder.get();
+    }
+}
+
+/**
+ * Multi-threaded version of `validate_nd_array()`, where blocks of pointers are distributed across workers by `parallel_iterate_nd_dataset()`.
+ * Each worker reads its blocks inside `serialize()` and checks the pointers outside of the lock.
+ *
+ * @tparam Offset_ Unsigned integer type for the starting offset on the heap.
+ * @tparam Length_ Unsigned integer type for the length of the string.
+ *
+ * @param handle Handle to a HDF5 dataset containing the VLS pointers, see `open_pointers()`.
+ * @param dimensions Dimensions of the dataset.
+ * @param heap_length Length of the heap dataset, see `open_heap()`.
+ * @param buffer_size Size of the buffer for holding loaded pointers in each worker.
+ * @param num_threads Number of worker threads.
+ */
+template<typename Offset_, typename Length_>
+void parallel_validate_nd_array(const H5::DataSet& handle, const std::vector<hsize_t>& dimensions, hsize_t heap_length, hsize_t buffer_size, int num_threads) {
+    struct State {
+        std::vector<Pointer<Offset_, Length_> > buffer;
+        bool out_of_range = false;
+    };
+
+    auto dtype = define_pointer_datatype<Offset_, Length_>();
+    auto blocks = pick_nd_block_dimensions(handle.getCreatePlist(), dimensions, buffer_size);
+
+    auto states = parallel_iterate_nd_dataset<State>(dimensions, blocks, num_threads, [&](const NdBlockSelection& block, State& state) -> void {
+        state.buffer.resize(block.size);
+        serialize([&]() -> void {
+            handle.read(state.buffer.data(), dtype, block.memory_space, block.file_space);
+        });
+        for (const auto& val : state.buffer) {
+            hsize_t start = val.offset;
+            hsize_t count = val.length;
+            if (start > heap_length || start + count > heap_length) {
+                state.out_of_range = true;
+                break;
+            }
+        }
+    });
+
+    for (const auto& state : states) {
+        if (state.out_of_range) {
+            throw std::runtime_error("VLS array pointers at '" + get_name(handle) + "' are out of range of the heap");
+        }
+    }
 }
 
 }
@@ -5,6 +5,7 @@
 #include "Pointer.hpp"
 #include "Stream1dArray.hpp"
 #include "validate.hpp"
+#include "for_each_string.hpp"
 
 /**
  * @file vls.hpp
@@ -0,0 +1,77 @@
+#ifndef RITSUKO_PARALLELIZE_HPP
+#define RITSUKO_PARALLELIZE_HPP
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * @file parallelize.hpp
+ * @brief Parallelize tasks across worker threads.
+ */
+
+namespace ritsuko {
+
+/**
+ * Split `num_tasks` tasks into contiguous ranges and execute each range on a separate worker thread.
+ * The calling thread waits until all workers have finished;
+ * if any worker throws, the first exception is rethrown on the calling thread.
+ *
+ * Applications may override the threading mechanism by defining a `RITSUKO_CUSTOM_PARALLEL` macro before including this header.
+ * This should be a function-like macro that accepts the same arguments as `parallelize()`, e.g., to use a pre-existing thread pool or OpenMP.
+ *
+ * @tparam Function_ Function to be executed by each worker.
+ * This should accept three `size_t` arguments - the worker index, the index of the first task in its range, and the number of tasks in its range.
+ * @param num_workers Number of worker threads.
+ * If this is 1 or less, all tasks are executed on the calling thread.
+ * @param num_tasks Number of tasks.
+ * @param fun Function to execute.
+ */
+template<class Function_>
+void parallelize(size_t num_workers, size_t num_tasks, Function_ fun) {
+#ifdef RITSUKO_CUSTOM_PARALLEL
+    RITSUKO_CUSTOM_PARALLEL(num_workers, num_tasks, fun);
+#else
+    if (num_tasks == 0) {
+        return;
+    }
+    if (num_workers <= 1 || num_tasks == 1) {
+        fun(0, 0, num_tasks);
+        return;
+    }
+
+    size_t per_worker = num_tasks / num_workers + (num_tasks % num_workers > 0);
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    std::vector<std::exception_ptr> errors(num_workers);
+
+    size_t start = 0;
+    for (size_t w = 0; w < num_workers && start < num_tasks; ++w) {
+        size_t length = std::min(per_worker, num_tasks - start);
+        workers.emplace_back([&fun,&errors](size_t w, size_t start, size_t length) -> void {
+            try {
+                fun(w, start, length);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        }, w, start, length);
+        start += length;
+    }
+
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+#endif
+}
+
+}
+
+#endif
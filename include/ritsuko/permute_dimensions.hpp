@@ -0,0 +1,167 @@
+#ifndef RITSUKO_PERMUTE_DIMENSIONS_HPP
+#define RITSUKO_PERMUTE_DIMENSIONS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+/**
+ * @file permute_dimensions.hpp
+ * @brief Permute the dimensions of an N-dimensional array.
+ */
+
+namespace ritsuko {
+
+/**
+ * Transpose a matrix with cache blocking.
+ * The matrix is processed in square tiles so that both the reads from `input` and the writes to `output` stay within a few cache lines at a time,
+ * and the loops over each tile have a fixed length so that the compiler can vectorize them.
+ *
+ * @tparam Type_ Type of the matrix elements.
+ * @param[in] input Pointer to the input matrix, where element `(r, c)` is at `input[r * input_stride + c]`.
+ * @param nrow Number of rows in the input matrix.
+ * @param ncol Number of columns in the input matrix.
+ * @param input_stride Distance between consecutive rows of the input matrix, no less than `ncol`.
+ * @param[out] output Pointer to the output matrix, where element `(r, c)` of the input is stored at `output[c * output_stride + r]`.
+ * This should not overlap with `input`.
+ * @param output_stride Distance between consecutive columns of the input in the output matrix, no less than `nrow`.
+ */
+template<typename Type_>
+void transpose_matrix(const Type_* input, size_t nrow, size_t ncol, size_t input_stride, Type_* output, size_t output_stride) {
+    constexpr size_t tile = 16;
+    size_t full_rows = nrow - nrow % tile, full_cols = ncol - ncol % tile;
+
+    for (size_t r0 = 0; r0 < nrow; r0 += tile) {
+        size_t rlen = std::min(tile, nrow - r0);
+        for (size_t c0 = 0; c0 < ncol; c0 += tile) {
+            size_t clen = std::min(tile, ncol - c0);
+            auto iptr = input + r0 * input_stride + c0;
+            auto optr = output + c0 * output_stride + r0;
+
+            if (r0 < full_rows && c0 < full_cols) {
+                // Fixed trip counts for the full tiles.
+                for (size_t c = 0; c < tile; ++c) {
+                    for (size_t r = 0; r < tile; ++r) {
+                        optr[c * output_stride + r] = iptr[r * input_stride + c];
+                    }
+                }
+            } else {
+                for (size_t c = 0; c < clen; ++c) {
+                    for (size_t r = 0; r < rlen; ++r) {
+                        optr[c * output_stride + r] = iptr[r * input_stride + c];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Check whether a vector is a permutation of the dimensions of an array.
+ *
+ * @param layout Vector of dimension indices.
+ * @param ndims Number of dimensions.
+ * @return Whether `layout` contains each integer in `[0, ndims)` exactly once.
+ */
+inline bool is_dimension_permutation(const std::vector<size_t>& layout, size_t ndims) {
+    if (layout.size() != ndims) {
+        return false;
+    }
+    std::vector<unsigned char> found(ndims);
+    for (auto l : layout) {
+        if (l >= ndims || found[l]) {
+            return false;
+        }
+        found[l] = 1;
+    }
+    return true;
+}
+
+/**
+ * Permute the dimensions of an N-dimensional array, e.g., to convert a row-major array into a column-major array.
+ * The permutation is decomposed into a series of 2-dimensional transpositions between the fastest-changing dimensions of the input and output,
+ * each of which is performed by `transpose_matrix()`.
+ * If the fastest-changing dimension is the same in the input and output, contiguous runs are copied directly.
+ *
+ * @tparam Type_ Type of the array elements.
+ * @tparam Dim_ Integer type for the dimension extents.
+ * @param[in] input Pointer to the input array in row-major order, i.e., the last dimension is the fastest-changing.
+ * @param dimensions Dimension extents of the input array.
+ * @param layout Order of the dimensions in the output array, from slowest- to fastest-changing.
+ * For example, the output is row-major if `layout` is `{ 0, 1, ..., N - 1 }` and column-major if it is `{ N - 1, ..., 1, 0 }`.
+ * This should be a permutation of the dimension indices, see `is_dimension_permutation()`.
+ * @param[out] output Pointer to the output array, with space for the product of `dimensions`.
+ * This should not overlap with `input`.
+ */
+template<typename Type_, typename Dim_>
+void permute_dimensions(const Type_* input, const std::vector<Dim_>& dimensions, const std::vector<size_t>& layout, Type_* output) {
+    size_t ndims = dimensions.size();
+    if (!is_dimension_permutation(layout, ndims)) {
+        throw std::runtime_error("layout should be a permutation of the dimension indices");
+    }
+
+    size_t total = 1;
+    for (auto d : dimensions) {
+        total *= d;
+    }
+    if (total == 0) {
+        return;
+    }
+
+    std::vector<size_t> in_strides(ndims), out_strides(ndims);
+    size_t stride = 1;
+    for (size_t i = ndims; i > 0; --i) {
+        in_strides[i - 1] = stride;
+        stride *= dimensions[i - 1];
+    }
+    stride = 1;
+    for (size_t i = ndims; i > 0; --i) {
+        auto d = layout[i - 1];
+        out_strides[d] = stride;
+        stride *= dimensions[d];
+    }
+
+    size_t in_fast = ndims - 1, out_fast = layout[ndims - 1];
+
+    // Remaining dimensions are iterated in the output order so that the
+    // writes are as sequential as possible.
+    std::vector<size_t> outer;
+    for (auto d : layout) {
+        if (d != in_fast && d != out_fast) {
+            outer.push_back(d);
+        }
+    }
+    std::vector<size_t> position(outer.size());
+    size_t in_offset = 0, out_offset = 0;
+
+    while (true) {
+        if (in_fast == out_fast) {
+            std::copy_n(input + in_offset, dimensions[in_fast], output + out_offset);
+        } else {
+            transpose_matrix(input + in_offset, dimensions[out_fast], dimensions[in_fast], in_strides[out_fast], output + out_offset, out_strides[in_fast]);
+        }
+
+        size_t o = outer.size();
+        for (; o > 0; --o) {
+            auto d = outer[o - 1];
+            auto& p = position[o - 1];
+            ++p;
+            in_offset += in_strides[d];
+            out_offset += out_strides[d];
+            if (p < static_cast<size_t>(dimensions[d])) {
+                break;
+            }
+            in_offset -= p * in_strides[d];
+            out_offset -= p * out_strides[d];
+            p = 0;
+        }
+        if (o == 0) {
+            break;
+        }
+    }
+}
+
+}
+
+#endif
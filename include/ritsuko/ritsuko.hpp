@@ -6,6 +6,12 @@
 #include "find_extremes.hpp"
 #include "choose_missing_placeholder.hpp"
 #include "parse_version_string.hpp"
+#include "DefaultInitAllocator.hpp"
+#include "parallelize.hpp"
+#include "AlignedBufferPool.hpp"
+#include "StringColumn.hpp"
+#include "export_to_arrow.hpp"
+#include "permute_dimensions.hpp"
 
 /**
  * @file ritsuko.hpp
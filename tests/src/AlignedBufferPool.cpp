@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/AlignedBufferPool.hpp"
+#include "ritsuko/hdf5/Stream1dNumericDataset.hpp"
+#include "ritsuko/hdf5/Stream1dStringDataset.hpp"
+#include "ritsuko/hdf5/validate_string.hpp"
+#include "ritsuko/hdf5/load_dataset.hpp"
+#include "hdf5/utils.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <thread>
+
+TEST(AlignedBufferPool, Basic) {
+    ritsuko::AlignedBufferPool pool;
+
+    void* first = pool.allocate(100);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0);
+    pool.deallocate(first, 100);
+    EXPECT_EQ(pool.cached_bytes(), 128);
+
+    // Recycled for any request in the same size class.
+    void* second = pool.allocate(120);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(pool.cached_bytes(), 0);
+
+    void* third = pool.allocate(10);
+    EXPECT_NE(third, second);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(third) % 64, 0);
+
+    pool.deallocate(second, 120);
+    pool.deallocate(third, 10);
+    EXPECT_EQ(pool.cached_bytes(), 192);
+    pool.clear();
+    EXPECT_EQ(pool.cached_bytes(), 0);
+}
+
+TEST(AlignedBufferPool, Limits) {
+    ritsuko::AlignedBufferPoolOptions opt;
+    opt.max_cached_bytes = 1000;
+    ritsuko::AlignedBufferPool pool(opt);
+
+    void* small = pool.allocate(500);
+    void* big = pool.allocate(5000);
+    pool.deallocate(big, 5000); // exceeds the limit, so it gets released immediately.
+    EXPECT_EQ(pool.cached_bytes(), 0);
+    pool.deallocate(small, 500);
+    EXPECT_EQ(pool.cached_bytes(), 512);
+
+    // Large buffers are aligned to huge page boundaries.
+    pool.options().huge_pages = true;
+    pool.options().max_cached_bytes = 100000000;
+    void* huge = pool.allocate(3000000);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(huge) % ritsuko::AlignedBufferPool::large_alignment, 0);
+    pool.deallocate(huge, 3000000);
+    EXPECT_EQ(pool.allocate(4000000), huge);
+    pool.deallocate(huge, 4000000);
+}
+
+TEST(AlignedBufferPool, PooledAllocator) {
+    auto& pool = ritsuko::thread_local_buffer_pool();
+    pool.clear();
+
+    const int* previous;
+    {
+        std::vector<int, ritsuko::PooledAllocator<int> > foo(100);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(foo.data()) % 64, 0);
+        std::iota(foo.begin(), foo.end(), 0);
+        EXPECT_EQ(foo.back(), 99);
+        previous = foo.data();
+    }
+    EXPECT_EQ(pool.cached_bytes(), 512);
+
+    {
+        std::vector<int, ritsuko::PooledAllocator<int> > bar(80);
+        EXPECT_EQ(bar.data(), previous);
+    }
+
+    EXPECT_TRUE(ritsuko::PooledAllocator<int>() == ritsuko::PooledAllocator<double>());
+}
+
+TEST(AlignedBufferPool, CrossThread) {
+    auto& pool = ritsuko::thread_local_buffer_pool();
+    pool.clear();
+
+    // Freeing on another thread returns the buffer to the system instead of
+    // adding it to either thread's pool.
+    {
+        auto foo = std::make_unique<std::vector<int, ritsuko::PooledAllocator<int> > >(1000);
+        std::iota(foo->begin(), foo->end(), 0);
+        size_t other_cached = 12345;
+        std::thread worker([&]() -> void {
+            foo.reset();
+            other_cached = ritsuko::thread_local_buffer_pool().cached_bytes();
+        });
+        worker.join();
+        EXPECT_EQ(other_cached, 0);
+        EXPECT_EQ(pool.cached_bytes(), 0);
+    }
+
+    // Buffers allocated on another thread can be freed on this thread.
+    {
+        std::unique_ptr<std::vector<double, ritsuko::PooledAllocator<double> > > foo;
+        std::thread worker([&]() -> void {
+            foo = std::make_unique<std::vector<double, ritsuko::PooledAllocator<double> > >(500, 1.5);
+        });
+        worker.join();
+        EXPECT_EQ(foo->back(), 1.5);
+        foo.reset();
+        EXPECT_EQ(pool.cached_bytes(), 0);
+    }
+
+    // Freeing after the thread's pool is destroyed, e.g., by another thread-local object.
+    // Thread-local objects are destroyed in reverse order of construction, so
+    // 'late' is destroyed after the pool that is constructed by its resize().
+    std::thread worker([&]() -> void {
+        thread_local std::vector<int, ritsuko::PooledAllocator<int> > late;
+        late.resize(100);
+        late[0] = 1;
+    });
+    worker.join();
+
+    // Allocators on the same thread still recycle their buffers.
+    {
+        std::vector<int, ritsuko::PooledAllocator<int> > foo(100);
+    }
+    EXPECT_EQ(pool.cached_bytes(), 512);
+}
+
+TEST(AlignedBufferPool, Overflow) {
+    ritsuko::AlignedBufferPool pool;
+    size_t maxed = std::numeric_limits<size_t>::max();
+    EXPECT_ANY_THROW(pool.allocate(maxed));
+    EXPECT_ANY_THROW(pool.allocate(maxed / 2 + 2));
+
+    ritsuko::PooledAllocator<double> alloc;
+    EXPECT_ANY_THROW(alloc.allocate(maxed / 4));
+    EXPECT_ANY_THROW(alloc.allocate(maxed / 8 + 1));
+}
+
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t count = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) {
+        ++count;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+};
+
+TEST(AlignedBufferPool, Streams) {
+    const char* path = "TEST-pool.h5";
+    std::vector<int> example(1234);
+    std::iota(example.begin(), example.end(), 0);
+    std::vector<std::string> strings(example.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+        strings[i] = std::to_string(i);
+    }
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "numbers", example, H5::PredType::NATIVE_INT);
+        create_dataset(handle, "strings", strings, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto nhandle = handle.openDataSet("numbers");
+    auto shandle = handle.openDataSet("strings");
+
+    // Many short-lived streams recycle the same buffers.
+    for (int rep = 0; rep < 3; ++rep) {
+        ritsuko::hdf5::Stream1dNumericDataset<int, ritsuko::PooledAllocator<int> > stream(&nhandle, 100);
+        auto many = stream.get_many();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(many.first) % 64, 0);
+        for (auto x : example) {
+            EXPECT_EQ(stream.get(), x);
+            stream.next();
+        }
+    }
+
+    {
+        ritsuko::hdf5::BasicStream1dStringDataset<ritsuko::PooledAllocator<char> > stream(&shandle, 100);
+        for (const auto& x : strings) {
+            EXPECT_EQ(stream.get(), x);
+            stream.next();
+        }
+    }
+
+    ritsuko::hdf5::validate_1d_string_dataset<ritsuko::PooledAllocator<char*> >(shandle, strings.size(), 100);
+    ritsuko::hdf5::validate_nd_string_dataset<ritsuko::PooledAllocator<char*> >(shandle, std::vector<hsize_t>{ strings.size() }, 100);
+
+    // Works with polymorphic allocators.
+    {
+        std::pmr::monotonic_buffer_resource resource;
+        std::pmr::polymorphic_allocator<int> alloc(&resource);
+        ritsuko::hdf5::Stream1dNumericDataset<int, std::pmr::polymorphic_allocator<int> > stream(&nhandle, 100, alloc);
+        for (auto x : example) {
+            EXPECT_EQ(stream.get(), x);
+            stream.next();
+        }
+    }
+
+    // Validators and loaders use the supplied allocator instance.
+    {
+        CountingResource resource;
+        std::pmr::polymorphic_allocator<char*> alloc(&resource);
+        ritsuko::hdf5::validate_1d_string_dataset(shandle, strings.size(), 100, NULL, true, alloc);
+        EXPECT_GT(resource.count, 0);
+
+        auto before = resource.count;
+        ritsuko::hdf5::validate_nd_string_dataset(shandle, std::vector<hsize_t>{ strings.size() }, 100, NULL, false, alloc);
+        EXPECT_GT(resource.count, before);
+
+        before = resource.count;
+        auto loaded = ritsuko::hdf5::load_1d_numeric_dataset<int>(nhandle, 100, std::pmr::polymorphic_allocator<int>(&resource));
+        EXPECT_GT(resource.count, before);
+        EXPECT_EQ(loaded.get_allocator().resource(), &resource);
+        EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), example.begin(), example.end()));
+    }
+}
@@ -0,0 +1,19 @@
+#include "ritsuko/DefaultInitAllocator.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+
+TEST(DefaultInitAllocator, Basic) {
+    std::vector<int, ritsuko::DefaultInitAllocator<int> > foo(10);
+    EXPECT_EQ(foo.size(), 10);
+    foo.resize(20, 5);
+    EXPECT_EQ(foo.back(), 5);
+    foo.push_back(100);
+    EXPECT_EQ(foo.back(), 100);
+
+    // Works for non-trivial types.
+    std::vector<std::string, ritsuko::DefaultInitAllocator<std::string> > bar(5);
+    EXPECT_TRUE(bar[0].empty());
+    bar.emplace_back("asdasd");
+    EXPECT_EQ(bar.back(), "asdasd");
+}
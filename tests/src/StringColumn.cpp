@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/StringColumn.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+TEST(StringColumn, Basic) {
+    ritsuko::StringColumn<> column;
+    EXPECT_EQ(column.size(), 0);
+    EXPECT_EQ(column.offsets(), std::vector<int64_t>{ 0 });
+
+    column.push_back("foo");
+    column.push_back("", 0);
+    column.push_back(std::string("barbar"));
+    column.push_back("whee!!!", 4);
+
+    EXPECT_EQ(column.size(), 4);
+    EXPECT_EQ(column[0], "foo");
+    EXPECT_EQ(column[1], "");
+    EXPECT_EQ(column[2], "barbar");
+    EXPECT_EQ(column[3], "whee");
+    EXPECT_EQ(column.offsets(), std::vector<int64_t>({ 0, 3, 3, 9, 13 }));
+    EXPECT_EQ(std::string(column.bytes().begin(), column.bytes().end()), "foobarbarwhee");
+
+    // Moving does not reallocate the buffers.
+    auto ptr = column.bytes().data();
+    auto moved = std::move(column);
+    EXPECT_EQ(moved.bytes().data(), ptr);
+    EXPECT_EQ(moved[2], "barbar");
+
+    moved.clear();
+    EXPECT_EQ(moved.size(), 0);
+    EXPECT_EQ(moved.offsets(), std::vector<int64_t>{ 0 });
+}
+
+TEST(StringColumn, Overflow) {
+    ritsuko::StringColumn<int8_t> column;
+    std::string x(100, 'a');
+    column.push_back(x);
+    EXPECT_ANY_THROW({
+        try {
+            column.push_back(x);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("exceeds the limit"));
+            throw;
+        }
+    });
+    EXPECT_EQ(column.size(), 1);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/export_to_arrow.hpp"
+#include <vector>
+#include <string>
+#include <limits>
+#include <cstdint>
+
+static bool is_valid(const ArrowArray& array, size_t i) {
+    if (array.buffers[0] == NULL) {
+        return true;
+    }
+    auto bitmap = static_cast<const uint8_t*>(array.buffers[0]);
+    return (bitmap[i / 8] >> (i % 8)) & 1;
+}
+
+TEST(ExportToArrow, Numeric) {
+    std::vector<int32_t> values { 1, -1, 5, -1, 10, 20, 30, 40, 50, -1 };
+    auto ptr = values.data();
+
+    ArrowArray array;
+    ArrowSchema schema;
+    ritsuko::export_numeric_to_arrow(std::move(values), std::optional<int32_t>(-1), &array, &schema);
+
+    EXPECT_STREQ(schema.format, "i");
+    EXPECT_EQ(schema.flags, ARROW_FLAG_NULLABLE);
+    EXPECT_EQ(array.length, 10);
+    EXPECT_EQ(array.null_count, 3);
+    EXPECT_EQ(array.n_buffers, 2);
+    EXPECT_EQ(array.buffers[1], ptr); // no copy.
+
+    std::vector<bool> expected { true, false, true, false, true, true, true, true, true, false };
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(is_valid(array, i), expected[i]);
+    }
+
+    array.release(&array);
+    EXPECT_EQ(array.release, nullptr);
+    schema.release(&schema);
+    EXPECT_EQ(schema.release, nullptr);
+}
+
+TEST(ExportToArrow, NumericNoMissing) {
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        ritsuko::export_numeric_to_arrow(std::vector<double>{ 1.5, 2.5 }, std::optional<double>(), &array, &schema);
+        EXPECT_STREQ(schema.format, "g");
+        EXPECT_EQ(schema.flags, 0);
+        EXPECT_EQ(array.null_count, 0);
+        EXPECT_EQ(array.buffers[0], nullptr);
+        EXPECT_EQ(static_cast<const double*>(array.buffers[1])[1], 2.5);
+        array.release(&array);
+        schema.release(&schema);
+    }
+
+    // Placeholder is supplied but not present.
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        ritsuko::export_numeric_to_arrow(std::vector<uint8_t>{ 1, 2, 3 }, std::optional<uint8_t>(255), &array, &schema);
+        EXPECT_STREQ(schema.format, "C");
+        EXPECT_EQ(schema.flags, ARROW_FLAG_NULLABLE);
+        EXPECT_EQ(array.null_count, 0);
+        EXPECT_EQ(array.buffers[0], nullptr);
+        array.release(&array);
+        schema.release(&schema);
+    }
+}
+
+TEST(ExportToArrow, NumericNan) {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    ArrowArray array;
+    ArrowSchema schema;
+    ritsuko::export_numeric_to_arrow(std::vector<float>{ 1, static_cast<float>(nan), 3 }, std::optional<float>(nan), &array, &schema);
+    EXPECT_STREQ(schema.format, "f");
+    EXPECT_EQ(array.null_count, 1);
+    EXPECT_TRUE(is_valid(array, 0));
+    EXPECT_FALSE(is_valid(array, 1));
+    EXPECT_TRUE(is_valid(array, 2));
+    array.release(&array);
+    schema.release(&schema);
+}
+
+TEST(ExportToArrow, Strings) {
+    ritsuko::StringColumn<int32_t> column;
+    for (auto x : { "foo", "NA", "", "whee" }) {
+        column.push_back(x);
+    }
+    auto bptr = column.bytes().data();
+    auto optr = column.offsets().data();
+
+    ArrowArray array;
+    ArrowSchema schema;
+    ritsuko::export_strings_to_arrow(std::move(column), std::optional<std::string>("NA"), &array, &schema);
+
+    EXPECT_STREQ(schema.format, "u");
+    EXPECT_EQ(array.length, 4);
+    EXPECT_EQ(array.null_count, 1);
+    EXPECT_EQ(array.n_buffers, 3);
+    EXPECT_EQ(array.buffers[1], optr);
+    EXPECT_EQ(array.buffers[2], bptr);
+    EXPECT_TRUE(is_valid(array, 0));
+    EXPECT_FALSE(is_valid(array, 1));
+    EXPECT_TRUE(is_valid(array, 2));
+    EXPECT_TRUE(is_valid(array, 3));
+
+    auto offsets = static_cast<const int32_t*>(array.buffers[1]);
+    auto bytes = static_cast<const char*>(array.buffers[2]);
+    EXPECT_EQ(std::string(bytes + offsets[3], bytes + offsets[4]), "whee");
+
+    array.release(&array);
+    schema.release(&schema);
+}
+
+TEST(ExportToArrow, StringsEmpty) {
+    ArrowArray array;
+    ArrowSchema schema;
+    ritsuko::export_strings_to_arrow(ritsuko::StringColumn<int64_t>(), std::optional<std::string>(), &array, &schema);
+    EXPECT_STREQ(schema.format, "U");
+    EXPECT_EQ(array.length, 0);
+    EXPECT_NE(array.buffers[1], nullptr);
+    EXPECT_NE(array.buffers[2], nullptr);
+    array.release(&array);
+    schema.release(&schema);
+}
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/BlockReader.hpp"
+
+#include <vector>
+#include <numeric>
+#include <cstdint>
+
+static const char* path = "TEST-block-reader.h5";
+static const std::vector<hsize_t> dims { 57, 41, 33 };
+
+static void create_block_reader_file() {
+    std::vector<hsize_t> chunks { 10, 7, 11 };
+    std::vector<int32_t> values(dims[0] * dims[1] * dims[2]);
+    std::iota(values.begin(), values.end(), 0);
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    H5::DSetCreatPropList cplist;
+    cplist.setChunk(3, chunks.data());
+    cplist.setDeflate(6);
+    H5::DataSpace dspace(3, dims.data());
+    handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist).write(values.data(), H5::PredType::NATIVE_INT32);
+
+    std::vector<hsize_t> empty_dims { 10, 0 };
+    H5::DataSpace espace(2, empty_dims.data());
+    handle.createDataSet("empty", H5::PredType::NATIVE_INT32, espace);
+}
+
+static void check_reader(ritsuko::hdf5::BlockReader<double>& reader, size_t& nblocks) {
+    std::vector<unsigned char> visited(dims[0] * dims[1] * dims[2]);
+    nblocks = 0;
+    while (!reader.finished()) {
+        const auto& block = reader.block();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(block.data) % 64, 0);
+        EXPECT_EQ(block.size, block.counts[0] * block.counts[1] * block.counts[2]);
+
+        auto sorted_strides = block.strides;
+        std::sort(sorted_strides.begin(), sorted_strides.end());
+        EXPECT_EQ(sorted_strides[0], 1);
+        EXPECT_EQ(sorted_strides[2] * block.counts[std::max_element(block.strides.begin(), block.strides.end()) - block.strides.begin()], block.size);
+
+        for (hsize_t x = 0; x < block.counts[0]; ++x) {
+            for (hsize_t y = 0; y < block.counts[1]; ++y) {
+                for (hsize_t z = 0; z < block.counts[2]; ++z) {
+                    size_t index = ((block.starts[0] + x) * dims[1] + block.starts[1] + y) * dims[2] + block.starts[2] + z;
+                    EXPECT_EQ(block.data[x * block.strides[0] + y * block.strides[1] + z * block.strides[2]], index);
+                    ++visited[index];
+                }
+            }
+        }
+
+        ++nblocks;
+        reader.next();
+    }
+
+    EXPECT_TRUE(std::all_of(visited.begin(), visited.end(), [](unsigned char x) -> bool { return x == 1; }));
+}
+
+TEST(Hdf5BlockReader, Basic) {
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    std::vector<hsize_t> blocks { 20, 7, 33 };
+
+    for (bool prefetch : { false, true }) {
+        ritsuko::hdf5::BlockReaderOptions opt;
+        opt.prefetch = prefetch;
+        ritsuko::hdf5::BlockReader<double> reader(&dhandle, dims, blocks, opt);
+        EXPECT_EQ(reader.block().strides, std::vector<size_t>({ 7 * 33, 33, 1 }));
+        size_t nblocks;
+        check_reader(reader, nblocks);
+        EXPECT_EQ(nblocks, 3 * 6);
+
+        // Calling next() again is a no-op.
+        reader.next();
+        EXPECT_TRUE(reader.finished());
+    }
+}
+
+TEST(Hdf5BlockReader, Ordered) {
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+
+    for (bool prefetch : { false, true }) {
+        ritsuko::hdf5::BlockReaderOptions opt;
+        opt.prefetch = prefetch;
+        opt.iteration.order = ritsuko::hdf5::IterationOrder::Z_ORDER;
+        ritsuko::hdf5::BlockReader<double> reader(&dhandle, 1000, opt);
+        size_t nblocks;
+        check_reader(reader, nblocks);
+        EXPECT_GT(nblocks, 1);
+    }
+}
+
+TEST(Hdf5BlockReader, Empty) {
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("empty");
+
+    for (bool prefetch : { false, true }) {
+        ritsuko::hdf5::BlockReaderOptions opt;
+        opt.prefetch = prefetch;
+        ritsuko::hdf5::BlockReader<int> reader(&dhandle, 1000, opt);
+        EXPECT_TRUE(reader.finished());
+    }
+}
+
+TEST(Hdf5BlockReader, EarlyExit) {
+    // Destroying the reader while a prefetch is in flight.
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    ritsuko::hdf5::BlockReaderOptions opt;
+    opt.prefetch = true;
+    ritsuko::hdf5::BlockReader<int> reader(&dhandle, 100, opt);
+    EXPECT_FALSE(reader.finished());
+    EXPECT_EQ(reader.block().data[0], 0);
+}
+
+TEST(Hdf5BlockReader, Concurrent) {
+    // Creating and destroying prefetching readers while another reader's
+    // background read is in flight.
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    std::vector<hsize_t> blocks { 20, 7, 33 };
+    ritsuko::hdf5::BlockReaderOptions opt;
+    opt.prefetch = true;
+
+    ritsuko::hdf5::BlockReader<double> first(&dhandle, dims, blocks, opt);
+    std::vector<double> sums(2);
+    {
+        ritsuko::hdf5::BlockReader<double> second(&dhandle, 100, opt);
+        while (!first.finished() && !second.finished()) {
+            for (auto ptr : { &first, &second }) {
+                const auto& block = ptr->block();
+                sums[ptr == &second] += std::accumulate(block.data, block.data + block.size, 0.0);
+                ptr->next();
+            }
+
+            // Short-lived readers are constructed and destroyed alongside the in-flight reads.
+            ritsuko::hdf5::BlockReader<int> temp(&dhandle, 100, opt);
+            EXPECT_EQ(temp.block().data[0], 0);
+        }
+        while (!second.finished()) {
+            const auto& block = second.block();
+            sums[1] += std::accumulate(block.data, block.data + block.size, 0.0);
+            second.next();
+        }
+    }
+
+    while (!first.finished()) {
+        const auto& block = first.block();
+        sums[0] += std::accumulate(block.data, block.data + block.size, 0.0);
+        first.next();
+    }
+
+    double n = dims[0] * dims[1] * dims[2];
+    EXPECT_EQ(sums[0], n * (n - 1) / 2);
+    EXPECT_EQ(sums[1], n * (n - 1) / 2);
+}
+
+TEST(Hdf5BlockReader, Layout) {
+    create_block_reader_file();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    std::vector<hsize_t> blocks { 20, 14, 22 };
+
+    for (bool prefetch : { false, true }) {
+        ritsuko::hdf5::BlockReaderOptions opt;
+        opt.prefetch = prefetch;
+
+        // Column-major.
+        opt.layout = std::vector<size_t>{ 2, 1, 0 };
+        {
+            ritsuko::hdf5::BlockReader<double> reader(&dhandle, dims, blocks, opt);
+            EXPECT_EQ(reader.block().strides, std::vector<size_t>({ 1, 20, 20 * 14 }));
+            size_t nblocks;
+            check_reader(reader, nblocks);
+            EXPECT_EQ(nblocks, 3 * 3 * 2);
+        }
+
+        opt.layout = std::vector<size_t>{ 1, 2, 0 };
+        {
+            ritsuko::hdf5::BlockReader<double> reader(&dhandle, dims, blocks, opt);
+            EXPECT_EQ(reader.block().strides, std::vector<size_t>({ 1, 20 * 22, 20 }));
+            size_t nblocks;
+            check_reader(reader, nblocks);
+        }
+    }
+
+    ritsuko::hdf5::BlockReaderOptions opt;
+    opt.layout = std::vector<size_t>{ 2, 1 };
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::BlockReader<double> reader(&dhandle, dims, blocks, opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("permutation"));
+            throw;
+        }
+    });
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/DirectChunkReader.hpp"
+#include "utils.h"
+#include <numeric>
+
+template<typename Type_>
+static H5::DataSet create_filtered_dataset(const H5::Group& parent, const std::string& name, const std::vector<hsize_t>& dims, const std::vector<Type_>& values, const H5::DataType& dtype, const std::vector<hsize_t>& chunks, bool shuffle, bool fletcher = false) {
+    H5::DSetCreatPropList cplist;
+    cplist.setChunk(chunks.size(), chunks.data());
+    if (fletcher) {
+        cplist.setFletcher32();
+    }
+    if (shuffle) {
+        cplist.setShuffle();
+    }
+    cplist.setDeflate(6);
+
+    H5::DataSpace dspace(dims.size(), dims.data());
+    auto dhandle = parent.createDataSet(name, dtype, dspace, cplist);
+    dhandle.write(values.data(), ritsuko::hdf5::as_numeric_datatype<Type_>());
+    return dhandle;
+}
+
+TEST(Hdf5DirectChunkReader, OneDimensional) {
+    const char* path = "TEST-direct-chunk.h5";
+
+    std::vector<int> example(29726);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = static_cast<int>(i % 1000) - 500;
+    }
+    std::vector<hsize_t> dims { example.size() };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_filtered_dataset(handle, "deflate", dims, example, H5::PredType::NATIVE_INT32, { 471 }, false);
+        create_filtered_dataset(handle, "shuffle", dims, example, H5::PredType::NATIVE_INT32, { 471 }, true);
+        create_filtered_dataset(handle, "i16be", dims, example, H5::PredType::STD_I16BE, { 500 }, true);
+        create_filtered_dataset(handle, "fletcher", dims, example, H5::PredType::NATIVE_INT32, { 471 }, true, true);
+        create_dataset(handle, "contiguous", example, H5::PredType::NATIVE_INT32);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    std::vector<std::pair<std::string, bool> > names { { "deflate", true }, { "shuffle", true }, { "i16be", true }, { "fletcher", false }, { "contiguous", false } };
+
+    for (const auto& n : names) {
+        auto dhandle = handle.openDataSet(n.first);
+        for (int nthreads : { 1, 3 }) {
+            ritsuko::hdf5::DirectChunkReaderOptions opt;
+            opt.num_threads = nthreads;
+
+            for (hsize_t buf : { 100, 5000 }) {
+                ritsuko::hdf5::ParallelStream1dNumericDataset<int64_t> stream(&dhandle, buf, opt);
+                EXPECT_EQ(stream.is_direct(), n.second);
+                EXPECT_EQ(stream.length(), example.size());
+                for (auto x : example) {
+                    EXPECT_EQ(stream.get(), x);
+                    stream.next();
+                }
+                EXPECT_EQ(stream.position(), example.size());
+                EXPECT_ANY_THROW(stream.get());
+            }
+
+            // Reading an unaligned range.
+            ritsuko::hdf5::DirectChunkReader<double> reader(&dhandle, opt);
+            hsize_t start = 123, count = 4567;
+            std::vector<double> output(count);
+            reader.read(&start, &count, output.data());
+            for (hsize_t i = 0; i < count; ++i) {
+                EXPECT_EQ(output[i], example[i + start]);
+            }
+        }
+    }
+}
+
+TEST(Hdf5DirectChunkReader, MultiDimensional) {
+    const char* path = "TEST-direct-chunk.h5";
+
+    std::vector<hsize_t> dims { 240, 100, 170 };
+    std::vector<double> values(dims[0] * dims[1] * dims[2]);
+    std::iota(values.begin(), values.end(), 0.5);
+    std::vector<hsize_t> chunks { 29, 17, 37 };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_filtered_dataset(handle, "foo", dims, values, H5::PredType::NATIVE_DOUBLE, chunks, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+
+    ritsuko::hdf5::DirectChunkReaderOptions opt;
+    opt.num_threads = 4;
+    ritsuko::hdf5::DirectChunkReader<double> reader(&dhandle, opt);
+    EXPECT_TRUE(reader.is_direct());
+    EXPECT_EQ(reader.dimensions(), dims);
+
+    for (auto multiplier : { 1, 2 }) {
+        auto block = chunks;
+        for (auto& b : block) {
+            b *= multiplier;
+        }
+
+        ritsuko::hdf5::IterateNdDataset iter(dims, block);
+        std::vector<double> buffer;
+        while (!iter.finished()) {
+            buffer.resize(iter.current_block_size());
+            reader.read(iter, buffer.data());
+
+            const auto& starts = iter.starts();
+            const auto& counts = iter.counts();
+            size_t b = 0;
+            for (hsize_t i = 0; i < counts[0]; ++i) {
+                for (hsize_t j = 0; j < counts[1]; ++j) {
+                    for (hsize_t k = 0; k < counts[2]; ++k, ++b) {
+                        auto expected = values[((i + starts[0]) * dims[1] + j + starts[1]) * dims[2] + k + starts[2]];
+                        EXPECT_EQ(buffer[b], expected);
+                    }
+                }
+            }
+
+            iter.next();
+        }
+    }
+}
+
+TEST(Hdf5DirectChunkReader, Unallocated) {
+    const char* path = "TEST-direct-chunk.h5";
+
+    std::vector<hsize_t> dims { 1000 };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        hsize_t chunk = 100;
+        cplist.setChunk(1, &chunk);
+        cplist.setDeflate(6);
+        int fill = -1;
+        cplist.setFillValue(H5::PredType::NATIVE_INT, &fill);
+
+        H5::DataSpace dspace(1, dims.data());
+        auto dhandle = handle.createDataSet("foo", H5::PredType::NATIVE_INT, dspace, cplist);
+
+        // Only writing to the second chunk.
+        std::vector<int> values(100);
+        std::iota(values.begin(), values.end(), 0);
+        hsize_t start = 100;
+        H5::DataSpace mspace(1, &chunk);
+        dspace.selectHyperslab(H5S_SELECT_SET, &chunk, &start);
+        dhandle.write(values.data(), H5::PredType::NATIVE_INT, mspace, dspace);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    ritsuko::hdf5::DirectChunkReader<int> reader(&dhandle);
+    EXPECT_TRUE(reader.is_direct());
+
+    hsize_t start = 50, count = 200;
+    std::vector<int> output(count);
+    reader.read(&start, &count, output.data());
+    for (hsize_t i = 0; i < count; ++i) {
+        auto pos = i + start;
+        EXPECT_EQ(output[i], (pos >= 100 && pos < 200 ? static_cast<int>(pos - 100) : -1));
+    }
+}
+
+TEST(Hdf5DirectChunkReader, ParallelLoadString) {
+    const char* path = "TEST-direct-chunk.h5";
+
+    std::vector<std::string> example(12345);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = std::to_string(i * 7);
+    }
+    example[10] = "";
+    example[11] = std::string(10, 'x'); // fills the entire width.
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "fixed", example, false, 471);
+        create_dataset(handle, "variable", example, true, 471);
+        create_dataset(handle, "contiguous", example, false);
+
+        hsize_t len = example.size();
+        H5::DataSpace dspace(1, &len);
+        H5::DSetCreatPropList cplist;
+        hsize_t chunk = 500;
+        cplist.setChunk(1, &chunk);
+        cplist.setShuffle();
+        cplist.setDeflate(6);
+        H5::StrType stype(0, 10);
+        std::vector<char> buffer(10 * example.size());
+        for (size_t i = 0; i < example.size(); ++i) {
+            std::copy(example[i].begin(), example[i].end(), buffer.data() + i * 10);
+        }
+        handle.createDataSet("shuffled", stype, dspace, cplist).write(buffer.data(), stype);
+
+        // Only writing the second chunk, so the others are unallocated.
+        hsize_t start = 500;
+        dspace.selectHyperslab(H5S_SELECT_SET, &chunk, &start);
+        H5::DataSpace mspace(1, &chunk);
+        handle.createDataSet("unallocated", stype, H5::DataSpace(1, &len), cplist).write(buffer.data() + start * 10, stype, mspace, dspace);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "fixed", "variable", "contiguous", "shuffled" }) {
+        auto dhandle = handle.openDataSet(name);
+        for (int nthreads : { 1, 3 }) {
+            ritsuko::hdf5::DirectChunkReaderOptions opt;
+            opt.num_threads = nthreads;
+            for (hsize_t buf : { 100, 5000, 100000 }) {
+                EXPECT_EQ(ritsuko::hdf5::parallel_load_1d_string_dataset(dhandle, buf, opt), example);
+            }
+        }
+    }
+
+    {
+        auto dhandle = handle.openDataSet("unallocated");
+        ritsuko::hdf5::DirectChunkReaderOptions opt;
+        opt.num_threads = 3;
+        auto loaded = ritsuko::hdf5::parallel_load_1d_string_dataset(dhandle, 1000, opt);
+        for (size_t i = 0; i < example.size(); ++i) {
+            EXPECT_EQ(loaded[i], (i >= 500 && i < 1000 ? example[i] : std::string()));
+        }
+    }
+}
@@ -2,6 +2,8 @@
 #include <gmock/gmock.h>
 #include "ritsuko/hdf5/IterateNdDataset.hpp"
 
+#include <numeric>
+
 TEST(Hdf5IterateNdDataset, TwoDimensional) {
     std::vector<hsize_t> dims { 2400, 3000 };
     std::vector<hsize_t> block { 101, 55 };
@@ -140,3 +142,399 @@ TEST(Hdf5IterateNdDataset, Extraction) {
     std::sort(staging_ground.begin(), staging_ground.end());
     EXPECT_EQ(staging_ground, values);
 }
+
+static std::vector<std::vector<hsize_t> > collect_starts(ritsuko::hdf5::IterateNdDataset& iter, const std::vector<hsize_t>& dims) {
+    std::vector<std::vector<hsize_t> > output;
+    size_t total = 0;
+    while (!iter.finished()) {
+        const auto& starts = iter.starts();
+        const auto& counts = iter.counts();
+        size_t current_size = 1;
+        for (size_t d = 0; d < dims.size(); ++d) {
+            EXPECT_EQ(counts[d], std::min(dims[d] - starts[d], iter.block_dimensions()[d]));
+            current_size *= counts[d];
+        }
+        EXPECT_EQ(iter.current_block_size(), current_size);
+        EXPECT_EQ(iter.file_space().getSelectNpoints(), current_size);
+        EXPECT_EQ(iter.memory_space().getSelectNpoints(), current_size);
+        total += current_size;
+        output.push_back(starts);
+        iter.next();
+    }
+
+    size_t expected = 1;
+    for (auto d : dims) {
+        expected *= d;
+    }
+    EXPECT_EQ(total, expected);
+    return output;
+}
+
+TEST(Hdf5IterateNdDataset, Orders) {
+    std::vector<hsize_t> dims { 50, 33, 21 };
+    std::vector<hsize_t> block { 7, 10, 6 };
+
+    ritsuko::hdf5::IterateNdDataset ref(dims, block);
+    auto ref_starts = collect_starts(ref, dims);
+    auto sorted_ref = ref_starts;
+    std::sort(sorted_ref.begin(), sorted_ref.end());
+
+    ritsuko::hdf5::IterateNdDatasetOptions opt;
+    {
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        EXPECT_EQ(collect_starts(iter, dims), ref_starts);
+    }
+
+    // Column-major order has the first dimension changing fastest.
+    {
+        opt.order = ritsuko::hdf5::IterationOrder::COLUMN_MAJOR;
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        auto starts = collect_starts(iter, dims);
+        EXPECT_EQ(starts[0], std::vector<hsize_t>(3));
+        EXPECT_EQ(starts[1], std::vector<hsize_t>({ 7, 0, 0 }));
+        for (auto& s : starts) {
+            std::reverse(s.begin(), s.end());
+        }
+        EXPECT_TRUE(std::is_sorted(starts.begin(), starts.end()));
+        for (auto& s : starts) {
+            std::reverse(s.begin(), s.end());
+        }
+        std::sort(starts.begin(), starts.end());
+        EXPECT_EQ(starts, sorted_ref);
+    }
+
+    // Chunk grid order visits all blocks in each chunk together.
+    {
+        opt.order = ritsuko::hdf5::IterationOrder::CHUNK_GRID;
+        opt.chunk_dimensions = std::vector<hsize_t>{ 20, 20, 20 };
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        auto starts = collect_starts(iter, dims);
+
+        std::vector<std::vector<hsize_t> > chunk_starts;
+        for (const auto& s : starts) {
+            chunk_starts.push_back(std::vector<hsize_t>{ s[0] / 20, s[1] / 20, s[2] / 20 });
+        }
+        EXPECT_TRUE(std::is_sorted(chunk_starts.begin(), chunk_starts.end()));
+        EXPECT_EQ(starts[1], std::vector<hsize_t>({ 0, 0, 6 }));
+        EXPECT_EQ(starts[4], std::vector<hsize_t>({ 0, 10, 0 })); // moving to the next block in the same chunk.
+
+        std::sort(starts.begin(), starts.end());
+        EXPECT_EQ(starts, sorted_ref);
+    }
+
+    // Z-order is the same as chunk grid order within each chunk, but the
+    // chunks themselves are visited in Morton order.
+    {
+        opt.order = ritsuko::hdf5::IterationOrder::Z_ORDER;
+        opt.chunk_dimensions.clear();
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        auto starts = collect_starts(iter, dims);
+        EXPECT_EQ(starts[0], std::vector<hsize_t>({ 0, 0, 0 }));
+        EXPECT_EQ(starts[1], std::vector<hsize_t>({ 0, 0, 6 }));
+        EXPECT_EQ(starts[2], std::vector<hsize_t>({ 0, 10, 0 }));
+        EXPECT_EQ(starts[3], std::vector<hsize_t>({ 0, 10, 6 }));
+        EXPECT_EQ(starts[4], std::vector<hsize_t>({ 7, 0, 0 }));
+        EXPECT_EQ(starts[8], std::vector<hsize_t>({ 0, 0, 12 }));
+
+        std::sort(starts.begin(), starts.end());
+        EXPECT_EQ(starts, sorted_ref);
+    }
+
+    opt.chunk_dimensions = std::vector<hsize_t>{ 1, 2 };
+    EXPECT_ANY_THROW({
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+    });
+}
+
+TEST(Hdf5IterateNdDataset, OrderedExtraction) {
+    std::vector<hsize_t> dims { 240, 100, 170 };
+    std::vector<hsize_t> chunk{ 29, 17, 37 };
+    std::vector<int> values(dims[0] * dims[1] * dims[2]);
+    for (int i = 0, end = values.size(); i < end; ++i) {
+        values[i] = i;
+    }
+
+    const char* path = "TEST-nd-iterate.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(3, chunk.data());
+        H5::DataSpace dspace(3, dims.data());
+        auto dhandle = handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist);
+        dhandle.write(values.data(), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    std::vector<hsize_t> block { 10, 40, 20 };
+
+    for (auto order : { ritsuko::hdf5::IterationOrder::COLUMN_MAJOR, ritsuko::hdf5::IterationOrder::CHUNK_GRID, ritsuko::hdf5::IterationOrder::Z_ORDER }) {
+        ritsuko::hdf5::IterateNdDatasetOptions opt;
+        opt.order = order;
+        opt.chunk_dimensions = chunk;
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+
+        std::vector<int> buffer, staging_ground(values.size());
+        while (!iter.finished()) {
+            buffer.resize(iter.current_block_size());
+            dhandle.read(buffer.data(), H5::PredType::NATIVE_INT, iter.memory_space(), iter.file_space());
+
+            const auto& starts = iter.starts();
+            const auto& counts = iter.counts();
+            auto bptr = buffer.data();
+            for (hsize_t x = 0; x < counts[0]; ++x) {
+                for (hsize_t y = 0; y < counts[1]; ++y) {
+                    auto offset = ((starts[0] + x) * dims[1] + starts[1] + y) * dims[2] + starts[2];
+                    std::copy_n(bptr, counts[2], staging_ground.data() + offset);
+                    bptr += counts[2];
+                }
+            }
+            iter.next();
+        }
+
+        EXPECT_EQ(staging_ground, values);
+    }
+}
+
+TEST(Hdf5IterateNdDataset, PickOptions) {
+    const char* path = "TEST-nd-iterate.h5";
+    std::vector<hsize_t> dims { 200, 300 };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DataSpace dspace(2, dims.data());
+        handle.createDataSet("contiguous", H5::PredType::NATIVE_INT32, dspace);
+
+        H5::DSetCreatPropList cplist;
+        std::vector<hsize_t> chunk { 20, 30 };
+        cplist.setChunk(2, chunk.data());
+        handle.createDataSet("chunked", H5::PredType::NATIVE_INT32, dspace, cplist);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    {
+        auto dhandle = handle.openDataSet("contiguous");
+        auto opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 7, 300 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::ROW_MAJOR);
+        EXPECT_TRUE(opt.chunk_dimensions.empty());
+    }
+
+    // Aligned blocks, or blocks only misaligned in the last dimension, are fine.
+    {
+        auto dhandle = handle.openDataSet("chunked");
+        auto opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 40, 30 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::ROW_MAJOR);
+        EXPECT_EQ(opt.chunk_dimensions, std::vector<hsize_t>({ 20, 30 }));
+
+        opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 20, 7 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::ROW_MAJOR);
+    }
+
+    // Misaligned blocks are fine if the default cache can hold a row of chunks.
+    {
+        auto dhandle = handle.openDataSet("chunked");
+        auto opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 7, 30 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::ROW_MAJOR);
+    }
+
+    // Otherwise, we switch to a different order with a small cache.
+    {
+        H5::DSetAccPropList aplist;
+        aplist.setChunkCache(521, 10000, 0.75);
+        auto dhandle = handle.openDataSet("chunked", aplist);
+
+        auto opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 7, 30 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::CHUNK_GRID);
+
+        opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 30, 30 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::Z_ORDER);
+
+        opt = ritsuko::hdf5::pick_nd_iteration_options(dhandle, dims, std::vector<hsize_t>{ 40, 30 });
+        EXPECT_EQ(opt.order, ritsuko::hdf5::IterationOrder::ROW_MAJOR);
+    }
+}
+
+TEST(Hdf5IterateNdDataset, Regions) {
+    std::vector<hsize_t> dims { 50, 33, 21 };
+    std::vector<hsize_t> block { 8, 10, 6 };
+
+    ritsuko::hdf5::IterateNdDatasetOptions opt;
+    opt.regions.push_back(ritsuko::hdf5::NdRegion{ { 5, 12, 0 }, { 20, 15, 21 } });
+    opt.regions.push_back(ritsuko::hdf5::NdRegion{ { 0, 0, 0 }, { 10, 0, 5 } }); // empty regions are skipped.
+    opt.regions.push_back(ritsuko::hdf5::NdRegion{ { 49, 32, 20 }, { 1, 1, 1 } });
+
+    for (auto order : { ritsuko::hdf5::IterationOrder::ROW_MAJOR, ritsuko::hdf5::IterationOrder::COLUMN_MAJOR, ritsuko::hdf5::IterationOrder::Z_ORDER }) {
+        opt.order = order;
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+
+        std::vector<unsigned char> visited(dims[0] * dims[1] * dims[2]);
+        std::vector<size_t> region_blocks(3);
+        while (!iter.finished()) {
+            const auto& starts = iter.starts();
+            const auto& counts = iter.counts();
+            const auto& reg = opt.regions[iter.current_region()];
+            ++region_blocks[iter.current_region()];
+
+            size_t current_size = 1;
+            for (size_t d = 0; d < 3; ++d) {
+                // Boundaries are either on the block grid or on the region boundary.
+                EXPECT_TRUE(starts[d] % block[d] == 0 || starts[d] == reg.starts[d]);
+                auto end = starts[d] + counts[d];
+                EXPECT_TRUE(end % block[d] == 0 || end == reg.starts[d] + reg.counts[d]);
+                EXPECT_GE(starts[d], reg.starts[d]);
+                EXPECT_LE(end, reg.starts[d] + reg.counts[d]);
+                EXPECT_EQ(starts[d] / block[d], (end - 1) / block[d]);
+                current_size *= counts[d];
+            }
+            EXPECT_EQ(iter.current_block_size(), current_size);
+            EXPECT_EQ(iter.file_space().getSelectNpoints(), current_size);
+            EXPECT_EQ(iter.memory_space().getSelectNpoints(), current_size);
+
+            for (hsize_t x = 0; x < counts[0]; ++x) {
+                for (hsize_t y = 0; y < counts[1]; ++y) {
+                    for (hsize_t z = 0; z < counts[2]; ++z) {
+                        ++visited[((starts[0] + x) * dims[1] + starts[1] + y) * dims[2] + starts[2] + z];
+                    }
+                }
+            }
+            iter.next();
+        }
+
+        EXPECT_EQ(region_blocks, std::vector<size_t>({ 4 * 2 * 4, 0, 1 }));
+        size_t total = 0;
+        for (hsize_t x = 0; x < dims[0]; ++x) {
+            for (hsize_t y = 0; y < dims[1]; ++y) {
+                for (hsize_t z = 0; z < dims[2]; ++z) {
+                    bool inside = (x >= 5 && x < 25 && y >= 12 && y < 27) || (x == 49 && y == 32 && z == 20);
+                    EXPECT_EQ(visited[(x * dims[1] + y) * dims[2] + z], inside);
+                    total += inside;
+                }
+            }
+        }
+        EXPECT_EQ(total, 20 * 15 * 21 + 1);
+    }
+
+    // Only empty regions.
+    {
+        ritsuko::hdf5::IterateNdDatasetOptions opt2;
+        opt2.regions.push_back(ritsuko::hdf5::NdRegion{ { 0, 0, 0 }, { 10, 0, 5 } });
+        opt2.regions.push_back(ritsuko::hdf5::NdRegion{ { 3, 7, 1 }, { 0, 5, 5 } }); // start is not on the block grid.
+        ritsuko::hdf5::IterateNdDataset iter(dims, block, opt2);
+        EXPECT_TRUE(iter.finished());
+
+        ritsuko::hdf5::IterateNdDatasetOptions opt3;
+        opt3.regions.push_back(ritsuko::hdf5::NdRegion{ { 3, 0 }, { 0, 5 } });
+        opt3.regions.push_back(ritsuko::hdf5::NdRegion{ { 4, 0 }, { 1, 5 } });
+        ritsuko::hdf5::IterateNdDataset iter2(std::vector<hsize_t>{ 10, 5 }, std::vector<hsize_t>{ 2, 5 }, opt3);
+        ASSERT_FALSE(iter2.finished());
+        EXPECT_EQ(iter2.current_region(), 1);
+        EXPECT_EQ(iter2.starts(), std::vector<hsize_t>({ 4, 0 }));
+        EXPECT_EQ(iter2.current_block_size(), 5);
+        iter2.next();
+        EXPECT_TRUE(iter2.finished());
+    }
+
+    opt.regions.push_back(ritsuko::hdf5::NdRegion{ { 45, 0, 0 }, { 10, 1, 1 } });
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("within the dataset"));
+            throw;
+        }
+    });
+
+    opt.regions.back() = ritsuko::hdf5::NdRegion{ { 45, 0 }, { 1, 1 } };
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::IterateNdDataset iter(dims, block, opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("same length"));
+            throw;
+        }
+    });
+}
+
+TEST(Hdf5IterateNdDataset, IndicesToRegions) {
+    auto regions = ritsuko::hdf5::indices_to_nd_regions({ { 5, 3, 4, 10, 4 }, { 7, 0 } });
+    ASSERT_EQ(regions.size(), 4);
+    EXPECT_EQ(regions[0].starts, std::vector<hsize_t>({ 3, 0 }));
+    EXPECT_EQ(regions[0].counts, std::vector<hsize_t>({ 3, 1 }));
+    EXPECT_EQ(regions[1].starts, std::vector<hsize_t>({ 3, 7 }));
+    EXPECT_EQ(regions[1].counts, std::vector<hsize_t>({ 3, 1 }));
+    EXPECT_EQ(regions[2].starts, std::vector<hsize_t>({ 10, 0 }));
+    EXPECT_EQ(regions[3].starts, std::vector<hsize_t>({ 10, 7 }));
+    EXPECT_EQ(regions[3].counts, std::vector<hsize_t>({ 1, 1 }));
+
+    EXPECT_TRUE(ritsuko::hdf5::indices_to_nd_regions({ { 1, 2 }, {} }).empty());
+
+    // Merging runs within the same chunk.
+    regions = ritsuko::hdf5::indices_to_nd_regions({ { 18, 1, 5, 25 }, { 9, 40, 3 } }, std::vector<hsize_t>{ 20, 30 });
+    ASSERT_EQ(regions.size(), 4);
+    EXPECT_EQ(regions[0].starts, std::vector<hsize_t>({ 1, 3 }));
+    EXPECT_EQ(regions[0].counts, std::vector<hsize_t>({ 18, 7 }));
+    EXPECT_EQ(regions[1].starts, std::vector<hsize_t>({ 1, 40 }));
+    EXPECT_EQ(regions[1].counts, std::vector<hsize_t>({ 18, 1 }));
+    EXPECT_EQ(regions[2].starts, std::vector<hsize_t>({ 25, 3 }));
+    EXPECT_EQ(regions[2].counts, std::vector<hsize_t>({ 1, 7 }));
+    EXPECT_EQ(regions[3].starts, std::vector<hsize_t>({ 25, 40 }));
+    EXPECT_EQ(regions[3].counts, std::vector<hsize_t>({ 1, 1 }));
+
+    // Unit chunks and consecutive indices across chunk boundaries.
+    regions = ritsuko::hdf5::indices_to_nd_regions({ { 19, 20, 22 } }, std::vector<hsize_t>{ 1 });
+    ASSERT_EQ(regions.size(), 2);
+    EXPECT_EQ(regions[0].counts, std::vector<hsize_t>({ 2 }));
+    regions = ritsuko::hdf5::indices_to_nd_regions({ { 19, 20, 22 } }, std::vector<hsize_t>{ 20 });
+    ASSERT_EQ(regions.size(), 1);
+    EXPECT_EQ(regions[0].starts, std::vector<hsize_t>({ 19 }));
+    EXPECT_EQ(regions[0].counts, std::vector<hsize_t>({ 4 }));
+
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::indices_to_nd_regions({ { 1, 2 } }, std::vector<hsize_t>{ 10, 10 });
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("same length"));
+            throw;
+        }
+    });
+}
+
+TEST(Hdf5IterateNdDataset, RegionExtraction) {
+    std::vector<hsize_t> dims { 200, 150 };
+    std::vector<hsize_t> chunk { 20, 30 };
+    std::vector<int> values(dims[0] * dims[1]);
+    std::iota(values.begin(), values.end(), 0);
+
+    const char* path = "TEST-nd-iterate.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(2, chunk.data());
+        H5::DataSpace dspace(2, dims.data());
+        handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist).write(values.data(), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    std::vector<hsize_t> rows { 5, 6, 7, 50, 199 }, cols { 0, 31, 32, 100 };
+
+    ritsuko::hdf5::IterateNdDatasetOptions opt;
+    opt.regions = ritsuko::hdf5::indices_to_nd_regions({ rows, cols });
+    ritsuko::hdf5::IterateNdDataset iter(dims, std::vector<hsize_t>{ 40, 30 }, opt);
+
+    std::vector<int> buffer;
+    size_t total = 0;
+    while (!iter.finished()) {
+        buffer.resize(iter.current_block_size());
+        dhandle.read(buffer.data(), H5::PredType::NATIVE_INT, iter.memory_space(), iter.file_space());
+        const auto& starts = iter.starts();
+        const auto& counts = iter.counts();
+        for (hsize_t x = 0; x < counts[0]; ++x) {
+            for (hsize_t y = 0; y < counts[1]; ++y) {
+                EXPECT_EQ(buffer[x * counts[1] + y], static_cast<int>((starts[0] + x) * dims[1] + starts[1] + y));
+            }
+        }
+        total += buffer.size();
+        iter.next();
+    }
+    EXPECT_EQ(total, rows.size() * cols.size());
+}
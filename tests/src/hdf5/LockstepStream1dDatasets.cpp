@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/LockstepStream1dDatasets.hpp"
+#include "utils.h"
+#include <numeric>
+
+static void create_example(const char* path, size_t len) {
+    std::vector<int> ints(len);
+    std::iota(ints.begin(), ints.end(), 0);
+    std::vector<double> dbls(len);
+    std::vector<std::string> strs(len);
+    for (size_t i = 0; i < len; ++i) {
+        dbls[i] = i * 0.5;
+        strs[i] = std::to_string(i * 3);
+    }
+
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    create_dataset(handle, "ints", ints, H5::PredType::NATIVE_INT, 60);
+    create_dataset(handle, "dbls", dbls, H5::PredType::NATIVE_DOUBLE, 84);
+    create_dataset(handle, "fixed", strs, false, 35);
+    create_dataset(handle, "variable", strs, true);
+}
+
+TEST(Hdf5LockstepStream1dDatasets, Basic) {
+    const char* path = "TEST-lockstep.h5";
+    size_t len = 12345;
+    create_example(path, len);
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto ihandle = handle.openDataSet("ints");
+    auto dhandle = handle.openDataSet("dbls");
+    auto fhandle = handle.openDataSet("fixed");
+    auto vhandle = handle.openDataSet("variable");
+    std::vector<const H5::DataSet*> ptrs { &ihandle, &dhandle, &fhandle, &vhandle };
+
+    for (int nthreads : { 1, 3, -1 }) {
+        ritsuko::hdf5::LockstepStream1dDatasetsOptions opt;
+        opt.num_threads = nthreads;
+        ritsuko::hdf5::LockstepStream1dDatasets<double> stream(ptrs, 1000, opt);
+        EXPECT_EQ(stream.length(), len);
+        EXPECT_EQ(stream.num_datasets(), 4);
+        EXPECT_EQ(stream.block_size(), 840);
+        EXPECT_FALSE(stream.is_string(0));
+        EXPECT_FALSE(stream.is_string(1));
+        EXPECT_TRUE(stream.is_string(2));
+        EXPECT_TRUE(stream.is_string(3));
+
+        // One row at a time.
+        for (size_t i = 0; i < len; ++i) {
+            EXPECT_EQ(stream.position(), i);
+            EXPECT_EQ(stream.get_number(0), i);
+            EXPECT_EQ(stream.get_number(1), i * 0.5);
+            EXPECT_EQ(stream.get_string(2), std::to_string(i * 3));
+            EXPECT_EQ(stream.get_string(3), std::to_string(i * 3));
+            EXPECT_EQ(stream.get_string_view(2), std::to_string(i * 3));
+            EXPECT_EQ(stream.get_string_view(3), std::to_string(i * 3));
+            stream.next();
+        }
+        EXPECT_ANY_THROW(stream.get_number(0));
+    }
+
+    // Row-aligned blocks.
+    {
+        ritsuko::hdf5::LockstepStream1dDatasets<double> stream(ptrs, 500);
+        size_t start = 0;
+        stream.next(17); // deliberately offsetting.
+        start += 17;
+
+        while (start < len) {
+            auto available = stream.get_many();
+            EXPECT_EQ(stream.position(), start);
+            auto iptr = stream.numbers(0);
+            auto dptr = stream.numbers(1);
+            auto fptr = stream.strings(2);
+            auto vptr = stream.strings(3);
+            for (size_t i = 0; i < available; ++i) {
+                EXPECT_EQ(iptr[i], start + i);
+                EXPECT_EQ(dptr[i], (start + i) * 0.5);
+                EXPECT_EQ(fptr[i], std::to_string((start + i) * 3));
+                EXPECT_EQ(vptr[i], std::to_string((start + i) * 3));
+            }
+            start += available;
+            stream.next(available);
+        }
+        EXPECT_EQ(start, len);
+    }
+}
+
+TEST(Hdf5LockstepStream1dDatasets, Errors) {
+    const char* path = "TEST-lockstep.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "short", std::vector<int>(10), H5::PredType::NATIVE_INT);
+        create_dataset(handle, "long", std::vector<int>(20), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto shandle = handle.openDataSet("short");
+    auto lhandle = handle.openDataSet("long");
+    std::vector<const H5::DataSet*> ptrs { &shandle, &lhandle };
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::LockstepStream1dDatasets<int> stream(ptrs, 100);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("same length"));
+            throw;
+        }
+    });
+}
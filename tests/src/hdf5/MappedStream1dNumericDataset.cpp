@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/MappedStream1dNumericDataset.hpp"
+#include "utils.h"
+#include <numeric>
+
+template<typename Type_>
+static void check_stream(const H5::DataSet& dhandle, const std::vector<Type_>& example, hsize_t buffer_size) {
+    // One value at a time.
+    {
+        ritsuko::hdf5::MappedStream1dNumericDataset<Type_> stream(&dhandle, buffer_size);
+        EXPECT_EQ(stream.length(), example.size());
+        for (auto x : example) {
+            EXPECT_EQ(stream.get(), x);
+            stream.next();
+        }
+        EXPECT_EQ(stream.position(), example.size());
+        EXPECT_ANY_THROW(stream.get());
+    }
+
+    // Fetching a data block.
+    {
+        ritsuko::hdf5::MappedStream1dNumericDataset<Type_> stream(&dhandle, buffer_size);
+        size_t start = 0;
+        while (start < example.size()) {
+            auto many = stream.get_many();
+            for (size_t i = 0; i < many.second; ++i) {
+                EXPECT_EQ(example[i + start], many.first[i]);
+            }
+            start += many.second;
+            stream.next(many.second);
+        }
+        EXPECT_EQ(start, example.size());
+    }
+}
+
+TEST(Hdf5MappedStream1dNumericDataset, Mapped) {
+    const char* path = "TEST-mapped.h5";
+
+    std::vector<int32_t> example(29726);
+    std::iota(example.begin(), example.end(), -1000);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "native", example, H5::PredType::NATIVE_INT32);
+        create_dataset(handle, "swapped", example, H5::PredType::STD_I32BE);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+
+    {
+        auto dhandle = handle.openDataSet("native");
+        ritsuko::hdf5::MappedStream1dNumericDataset<int32_t> stream(&dhandle, 100);
+        EXPECT_TRUE(stream.is_mapped());
+        EXPECT_FALSE(stream.is_swapped());
+        EXPECT_EQ(stream.get_many().second, example.size()); // zero-copy view of everything.
+        check_stream(dhandle, example, 100);
+    }
+
+    {
+        auto dhandle = handle.openDataSet("swapped");
+        ritsuko::hdf5::MappedStream1dNumericDataset<int32_t> stream(&dhandle, 100);
+        EXPECT_TRUE(stream.is_mapped());
+        EXPECT_TRUE(stream.is_swapped());
+        EXPECT_EQ(stream.get_many().second, 100);
+        check_stream(dhandle, example, 100);
+        check_stream(dhandle, example, 1000);
+    }
+}
+
+TEST(Hdf5MappedStream1dNumericDataset, Fallback) {
+    const char* path = "TEST-mapped.h5";
+
+    std::vector<double> example(10000);
+    std::iota(example.begin(), example.end(), 0.5);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "chunked", example, H5::PredType::NATIVE_DOUBLE, 57);
+        create_dataset(handle, "float", example, H5::PredType::NATIVE_FLOAT);
+
+        // Unallocated storage.
+        hsize_t len = 100;
+        H5::DataSpace dspace(1, &len);
+        handle.createDataSet("empty", H5::PredType::NATIVE_DOUBLE, dspace);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "chunked", "float" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::MappedStream1dNumericDataset<double> stream(&dhandle, 100);
+        EXPECT_FALSE(stream.is_mapped());
+        check_stream(dhandle, example, 100);
+    }
+
+    {
+        auto dhandle = handle.openDataSet("empty");
+        ritsuko::hdf5::MappedStream1dNumericDataset<double> stream(&dhandle, 10);
+        EXPECT_FALSE(stream.is_mapped());
+        EXPECT_EQ(stream.get(), 0);
+    }
+}
+
+TEST(Hdf5MappedStream1dNumericDataset, UserBlock) {
+    const char* path = "TEST-mapped.h5";
+
+    std::vector<int32_t> example(100);
+    std::iota(example.begin(), example.end(), 1);
+    {
+        H5::FileCreatPropList fcplist;
+        fcplist.setUserblock(512);
+        H5::H5File handle(path, H5F_ACC_TRUNC, fcplist);
+        create_dataset(handle, "native", example, H5::PredType::NATIVE_INT32);
+        create_dataset(handle, "swapped", example, H5::PredType::STD_I32BE);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "native", "swapped" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::MappedStream1dNumericDataset<int32_t> stream(&dhandle, 10);
+        EXPECT_TRUE(stream.is_mapped());
+        check_stream(dhandle, example, 10);
+    }
+}
+
+TEST(Hdf5MappedStream1dNumericDataset, ReadWrite) {
+    const char* path = "TEST-mapped.h5";
+
+    std::vector<int32_t> example(1000);
+    std::iota(example.begin(), example.end(), 1);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "native", example, H5::PredType::NATIVE_INT32);
+    }
+
+    // Files opened for writing are never mapped, as pending writes may not be visible on disk.
+    H5::H5File handle(path, H5F_ACC_RDWR);
+    auto dhandle = handle.openDataSet("native");
+    ritsuko::hdf5::MappedStream1dNumericDataset<int32_t> stream(&dhandle, 100);
+    EXPECT_FALSE(stream.is_mapped());
+    check_stream(dhandle, example, 100);
+}
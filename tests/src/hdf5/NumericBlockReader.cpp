@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/NumericBlockReader.hpp"
+#include "ritsuko/hdf5/Stream1dNumericDataset.hpp"
+#include "utils.h"
+#include <numeric>
+
+TEST(Hdf5NumericBlockReader, Identify) {
+    auto native = ritsuko::hdf5::identify_native_numeric_type(H5::PredType::NATIVE_INT16);
+    EXPECT_EQ(native.type, ritsuko::hdf5::NativeNumericType::INT16);
+    EXPECT_FALSE(native.swapped);
+
+    auto le = ritsuko::hdf5::identify_native_numeric_type(H5::PredType::STD_U32LE);
+    auto be = ritsuko::hdf5::identify_native_numeric_type(H5::PredType::STD_U32BE);
+    EXPECT_EQ(le.type, ritsuko::hdf5::NativeNumericType::UINT32);
+    EXPECT_EQ(be.type, ritsuko::hdf5::NativeNumericType::UINT32);
+    EXPECT_NE(le.swapped, be.swapped);
+
+    auto dbl = ritsuko::hdf5::identify_native_numeric_type(H5::PredType::IEEE_F64BE);
+    EXPECT_EQ(dbl.type, ritsuko::hdf5::NativeNumericType::DOUBLE);
+
+    auto str = ritsuko::hdf5::identify_native_numeric_type(H5::StrType(0, 10));
+    EXPECT_EQ(str.type, ritsuko::hdf5::NativeNumericType::NONE);
+}
+
+TEST(Hdf5NumericBlockReader, ValuePreserving) {
+    EXPECT_TRUE((ritsuko::hdf5::is_value_preserving_conversion<int16_t, double>()));
+    EXPECT_TRUE((ritsuko::hdf5::is_value_preserving_conversion<uint8_t, int32_t>()));
+    EXPECT_TRUE((ritsuko::hdf5::is_value_preserving_conversion<uint16_t, uint32_t>()));
+    EXPECT_TRUE((ritsuko::hdf5::is_value_preserving_conversion<int32_t, double>()));
+    EXPECT_TRUE((ritsuko::hdf5::is_value_preserving_conversion<float, double>()));
+
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<int32_t, int16_t>()));
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<int8_t, uint32_t>()));
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<uint32_t, int32_t>()));
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<int64_t, double>()));
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<double, float>()));
+    EXPECT_FALSE((ritsuko::hdf5::is_value_preserving_conversion<double, int64_t>()));
+}
+
+TEST(Hdf5NumericBlockReader, SwapBytes) {
+    std::vector<uint32_t> values { 0x01020304u, 0xA0B0C0D0u };
+    ritsuko::hdf5::swap_bytes(reinterpret_cast<unsigned char*>(values.data()), values.size(), sizeof(uint32_t));
+    EXPECT_EQ(values[0], 0x04030201u);
+    EXPECT_EQ(values[1], 0xD0C0B0A0u);
+
+    std::vector<unsigned char> odd { 1, 2, 3, 4, 5, 6 };
+    ritsuko::hdf5::swap_bytes(odd.data(), 2, 3);
+    EXPECT_EQ(odd, std::vector<unsigned char>({ 3, 2, 1, 6, 5, 4 }));
+}
+
+template<typename From_, typename To_>
+static void check_stream(const H5::DataType& ftype, bool in_library, hsize_t chunk_size = 0) {
+    const char* path = "TEST-block-reader.h5";
+
+    std::vector<From_> example(9876);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = (i * 7) % 101;
+        if constexpr(std::numeric_limits<From_>::is_signed) {
+            example[i] -= 50;
+        }
+    }
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foobar", example, ftype, chunk_size);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foobar");
+
+    ritsuko::hdf5::NumericBlockReader<To_> reader(&dhandle);
+    EXPECT_EQ(reader.is_in_library(), in_library);
+
+    // Comparing to HDF5's own conversion, which clamps out-of-range values.
+    std::vector<To_> expected(example.size());
+    dhandle.read(expected.data(), ritsuko::hdf5::as_numeric_datatype<To_>());
+
+    ritsuko::hdf5::Stream1dNumericDataset<To_> stream(&dhandle, 1000);
+    for (auto x : expected) {
+        EXPECT_EQ(stream.get(), x);
+        stream.next();
+    }
+}
+
+TEST(Hdf5NumericBlockReader, Conversions) {
+    check_stream<int16_t, double>(H5::PredType::NATIVE_INT16, true);
+    check_stream<int16_t, double>(H5::PredType::NATIVE_INT16, true, 123);
+    check_stream<uint8_t, int32_t>(H5::PredType::NATIVE_UINT8, true);
+    check_stream<int8_t, int64_t>(H5::PredType::NATIVE_INT8, true);
+    check_stream<float, double>(H5::PredType::NATIVE_FLOAT, true);
+
+    // Byte-swapping, with and without a conversion.
+    bool is_le = (H5::PredType::NATIVE_INT32.getOrder() == H5T_ORDER_LE);
+    check_stream<int32_t, int32_t>(H5::PredType::STD_I32BE, is_le);
+    check_stream<int32_t, int32_t>(H5::PredType::STD_I32LE, !is_le);
+    check_stream<uint16_t, double>(H5::PredType::STD_U16BE, true, 500);
+    check_stream<double, double>(H5::PredType::IEEE_F64BE, true);
+
+    // No conversion is required.
+    check_stream<int32_t, int32_t>(H5::PredType::NATIVE_INT32, false);
+
+    // Falls back to HDF5 for potentially lossy conversions.
+    check_stream<int32_t, int16_t>(H5::PredType::NATIVE_INT32, false);
+    check_stream<int16_t, uint32_t>(H5::PredType::NATIVE_INT16, false);
+    check_stream<double, float>(H5::PredType::NATIVE_DOUBLE, false);
+}
+
+TEST(Hdf5NumericBlockReader, Overflow) {
+    // Out-of-range values are still handled by HDF5, so the clamping behavior is unchanged.
+    const char* path = "TEST-block-reader.h5";
+    std::vector<int32_t> example { -100000, -1, 0, 1, 100000 };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foobar", example, H5::PredType::NATIVE_INT32);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foobar");
+    ritsuko::hdf5::Stream1dNumericDataset<int16_t> stream(&dhandle, 100);
+    auto many = stream.get_many();
+    ASSERT_EQ(many.second, example.size());
+
+    std::vector<int16_t> expected(example.size());
+    dhandle.read(expected.data(), H5::PredType::NATIVE_INT16);
+    EXPECT_EQ(std::vector<int16_t>(many.first, many.first + many.second), expected);
+    EXPECT_EQ(expected.front(), std::numeric_limits<int16_t>::min());
+    EXPECT_EQ(expected.back(), std::numeric_limits<int16_t>::max());
+}
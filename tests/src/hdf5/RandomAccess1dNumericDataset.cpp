@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/RandomAccess1dNumericDataset.hpp"
+#include "utils.h"
+#include <numeric>
+#include <random>
+
+static std::vector<int> create_example(const char* path) {
+    std::vector<int> example(29726);
+    std::iota(example.begin(), example.end(), 0);
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    create_dataset(handle, "chunked", example, H5::PredType::NATIVE_INT, 471);
+    create_dataset(handle, "contiguous", example, H5::PredType::NATIVE_INT);
+    return example;
+}
+
+TEST(Hdf5RandomAccess1dNumericDataset, Indexing) {
+    const char* path = "TEST-random-access.h5";
+    auto example = create_example(path);
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+
+    for (auto name : { "chunked", "contiguous" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000, 3);
+        EXPECT_EQ(reader.length(), example.size());
+
+        std::mt19937_64 rng(42);
+        for (int i = 0; i < 1000; ++i) {
+            hsize_t idx = rng() % example.size();
+            EXPECT_EQ(reader[idx], example[idx]);
+        }
+        EXPECT_EQ(reader.hits() + reader.misses(), 1000);
+
+        // Repeated access to the same block is a cache hit.
+        auto before = reader.misses();
+        EXPECT_EQ(reader[10], 10);
+        EXPECT_EQ(reader[11], 11);
+        EXPECT_EQ(reader.misses(), before + 1);
+    }
+}
+
+TEST(Hdf5RandomAccess1dNumericDataset, Alignment) {
+    const char* path = "TEST-random-access.h5";
+    auto example = create_example(path);
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+    ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000);
+    EXPECT_EQ(reader.block_size(), 942);
+
+    EXPECT_EQ(reader[941], 941);
+    EXPECT_EQ(reader[0], 0);
+    EXPECT_EQ(reader.misses(), 1);
+    EXPECT_EQ(reader[942], 942);
+    EXPECT_EQ(reader.misses(), 2);
+}
+
+TEST(Hdf5RandomAccess1dNumericDataset, Eviction) {
+    const char* path = "TEST-random-access.h5";
+    auto example = create_example(path);
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("contiguous");
+    ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 100, 2);
+
+    EXPECT_EQ(reader[0], 0);
+    EXPECT_EQ(reader[100], 100);
+    EXPECT_EQ(reader[0], 0); // hit, and 0 is now the most recently used.
+    EXPECT_EQ(reader[200], 200); // evicts the block for 100.
+    EXPECT_EQ(reader[0], 0); // still a hit.
+    EXPECT_EQ(reader.hits(), 2);
+    EXPECT_EQ(reader.misses(), 3);
+
+    EXPECT_EQ(reader[150], 150); // evicted previously, so this is a miss.
+    EXPECT_EQ(reader.misses(), 4);
+}
+
+TEST(Hdf5RandomAccess1dNumericDataset, Range) {
+    const char* path = "TEST-random-access.h5";
+    auto example = create_example(path);
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+    ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000, 2);
+
+    std::vector<std::pair<hsize_t, hsize_t> > ranges { { 0, 10 }, { 900, 2000 }, { 5000, 12345 }, { 29000, 29726 }, { 50, 50 } };
+    for (const auto& r : ranges) {
+        auto out = reader.range(r.first, r.second);
+        std::vector<int> expected(example.begin() + r.first, example.begin() + r.second);
+        EXPECT_EQ(out, expected);
+    }
+
+    EXPECT_ANY_THROW(reader.range(10, 5));
+    EXPECT_ANY_THROW(reader.range(0, 30000));
+}
+
+TEST(Hdf5RandomAccess1dNumericDataset, Gather) {
+    const char* path = "TEST-random-access.h5";
+    auto example = create_example(path);
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+
+    std::mt19937_64 rng(1000);
+    std::vector<hsize_t> indices(5000);
+    for (auto& i : indices) {
+        i = rng() % example.size();
+    }
+
+    // Unsorted indices.
+    {
+        ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000, 1);
+        auto out = reader.gather(indices);
+        ASSERT_EQ(out.size(), indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            EXPECT_EQ(out[i], example[indices[i]]);
+        }
+
+        // Each block is only looked up once, even with a cache size of 1.
+        hsize_t nblocks = (example.size() + reader.block_size() - 1) / reader.block_size();
+        EXPECT_EQ(reader.misses(), nblocks);
+        EXPECT_EQ(reader.hits(), 0);
+    }
+
+    // Sorted indices.
+    {
+        std::sort(indices.begin(), indices.end());
+        ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000, 1);
+        auto out = reader.gather(indices);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            EXPECT_EQ(out[i], example[indices[i]]);
+        }
+    }
+
+    ritsuko::hdf5::RandomAccess1dNumericDataset<int> reader(&dhandle, 1000);
+    EXPECT_TRUE(reader.gather(std::vector<hsize_t>{}).empty());
+    EXPECT_ANY_THROW(reader.gather(std::vector<hsize_t>{ 0, 100000 }));
+    EXPECT_ANY_THROW(reader[example.size()]);
+}
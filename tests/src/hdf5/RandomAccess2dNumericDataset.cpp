@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/RandomAccess2dNumericDataset.hpp"
+
+#include <vector>
+#include <numeric>
+#include <random>
+#include <cstdint>
+
+static const char* path = "TEST-random-access-2d.h5";
+static const hsize_t NR = 57, NC = 41;
+
+static std::vector<int32_t> create_example() {
+    std::vector<int32_t> values(NR * NC);
+    std::iota(values.begin(), values.end(), 0);
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    hsize_t dims[2] = { NR, NC };
+    H5::DataSpace dspace(2, dims);
+
+    H5::DSetCreatPropList cplist;
+    hsize_t chunks[2] = { 10, 7 };
+    cplist.setChunk(2, chunks);
+    cplist.setDeflate(6);
+    handle.createDataSet("chunked", H5::PredType::NATIVE_INT32, dspace, cplist).write(values.data(), H5::PredType::NATIVE_INT32);
+    handle.createDataSet("contiguous", H5::PredType::NATIVE_INT32, dspace).write(values.data(), H5::PredType::NATIVE_INT32);
+
+    hsize_t vdim = 10;
+    H5::DataSpace vspace(1, &vdim);
+    handle.createDataSet("vector", H5::PredType::NATIVE_INT32, vspace);
+    return values;
+}
+
+TEST(Hdf5RandomAccess2dNumericDataset, Slices) {
+    auto example = create_example();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+
+    for (auto name : { "chunked", "contiguous" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::RandomAccess2dNumericDataset<double> reader(&dhandle, 100);
+        EXPECT_EQ(reader.nrow(), NR);
+        EXPECT_EQ(reader.ncol(), NC);
+
+        std::vector<double> buffer(NC);
+        for (hsize_t r = 0; r < NR; ++r) {
+            reader.row(r, buffer.data());
+            for (hsize_t c = 0; c < NC; ++c) {
+                EXPECT_EQ(buffer[c], example[r * NC + c]);
+            }
+        }
+
+        buffer.resize(NR);
+        for (hsize_t c = 0; c < NC; ++c) {
+            reader.column(c, buffer.data());
+            for (hsize_t r = 0; r < NR; ++r) {
+                EXPECT_EQ(buffer[r], example[r * NC + c]);
+            }
+        }
+
+        // Everything fits in the default cache, so the second pass is all hits.
+        EXPECT_GT(reader.hits(), 0);
+        EXPECT_DOUBLE_EQ(reader.hit_rate(), static_cast<double>(reader.hits()) / (reader.hits() + reader.misses()));
+    }
+}
+
+TEST(Hdf5RandomAccess2dNumericDataset, Alignment) {
+    auto example = create_example();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+
+    ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader(&dhandle, 200);
+    const auto& bdims = reader.block_dimensions();
+    EXPECT_EQ(bdims[0] % 10, 0);
+    EXPECT_EQ(bdims[1] % 7, 0);
+    EXPECT_EQ(reader.hit_rate(), 0);
+
+    // Rows in the same block only require a single read of each block.
+    std::vector<int32_t> buffer(NC);
+    reader.row(0, buffer.data());
+    auto nblocks = (NC + bdims[1] - 1) / bdims[1];
+    EXPECT_EQ(reader.misses(), nblocks);
+    reader.row(bdims[0] - 1, buffer.data());
+    EXPECT_EQ(reader.misses(), nblocks);
+    EXPECT_EQ(reader.hits(), nblocks);
+    reader.row(bdims[0], buffer.data());
+    EXPECT_EQ(reader.misses(), nblocks * 2);
+}
+
+TEST(Hdf5RandomAccess2dNumericDataset, Batch) {
+    auto example = create_example();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+
+    std::mt19937_64 rng(123);
+    for (int dim = 0; dim < 2; ++dim) {
+        hsize_t limit = (dim == 0 ? NR : NC);
+        hsize_t length = (dim == 0 ? NC : NR);
+        std::vector<hsize_t> indices(50);
+        for (auto& i : indices) {
+            i = rng() % limit;
+        }
+
+        // Each block is only looked up once per call, even with the smallest cache.
+        ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader(&dhandle, 100, 0);
+        EXPECT_EQ(reader.cache_capacity(), 1);
+        auto out = (dim == 0 ? reader.rows(indices) : reader.columns(indices));
+        ASSERT_EQ(out.size(), indices.size() * length);
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+            for (hsize_t k = 0; k < length; ++k) {
+                hsize_t r = (dim == 0 ? indices[i] : k), c = (dim == 0 ? k : indices[i]);
+                EXPECT_EQ(out[i * length + k], example[r * NC + c]);
+            }
+        }
+
+        const auto& bdims = reader.block_dimensions();
+        std::vector<unsigned char> used((limit + bdims[dim] - 1) / bdims[dim]);
+        for (auto i : indices) {
+            used[i / bdims[dim]] = 1;
+        }
+        size_t expected = std::accumulate(used.begin(), used.end(), static_cast<size_t>(0)) * ((length + bdims[1 - dim] - 1) / bdims[1 - dim]);
+        EXPECT_EQ(reader.misses(), expected);
+        EXPECT_EQ(reader.hits(), 0);
+
+        EXPECT_TRUE((dim == 0 ? reader.rows(std::vector<hsize_t>{}) : reader.columns(std::vector<hsize_t>{})).empty());
+    }
+}
+
+TEST(Hdf5RandomAccess2dNumericDataset, Eviction) {
+    auto example = create_example();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("chunked");
+
+    ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader(&dhandle, 70, 0);
+    const auto& bdims = reader.block_dimensions();
+    size_t block_bytes = bdims[0] * bdims[1] * sizeof(int32_t);
+
+    // Cache is sized in bytes, rounding down to a whole number of blocks.
+    ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader2(&dhandle, 70, block_bytes * 2 + block_bytes / 2);
+    EXPECT_EQ(reader2.cache_capacity(), 2);
+
+    std::vector<int32_t> buffer(NR);
+    reader2.column(0, buffer.data());
+    auto nblocks = reader2.misses();
+    EXPECT_GT(nblocks, 2);
+
+    // Only the last two blocks are still in the cache.
+    reader2.row(NR - 1, buffer.data());
+    EXPECT_EQ(reader2.hits(), 1);
+    EXPECT_EQ(buffer[0], example[(NR - 1) * NC]);
+    reader2.column(0, buffer.data());
+    EXPECT_EQ(reader2.misses(), nblocks * 2 + (NC + bdims[1] - 1) / bdims[1] - 1);
+    EXPECT_EQ(buffer[NR - 1], example[(NR - 1) * NC]);
+}
+
+TEST(Hdf5RandomAccess2dNumericDataset, Errors) {
+    create_example();
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+
+    {
+        auto dhandle = handle.openDataSet("vector");
+        std::string errmsg;
+        try {
+            ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader(&dhandle);
+        } catch (std::exception& e) {
+            errmsg = e.what();
+        }
+        EXPECT_THAT(errmsg, ::testing::HasSubstr("2-dimensional"));
+    }
+
+    auto dhandle = handle.openDataSet("chunked");
+    ritsuko::hdf5::RandomAccess2dNumericDataset<int32_t> reader(&dhandle);
+    std::vector<int32_t> buffer(NR * 2);
+    EXPECT_ANY_THROW({
+        try {
+            reader.row(NR, buffer.data());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("row beyond the end"));
+            throw;
+        }
+    });
+    EXPECT_ANY_THROW({
+        try {
+            reader.columns(std::vector<hsize_t>{ 0, NC });
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("column beyond the end"));
+            throw;
+        }
+    });
+}
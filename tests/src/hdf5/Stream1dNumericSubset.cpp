@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/Stream1dNumericSubset.hpp"
+#include "utils.h"
+#include <numeric>
+#include <random>
+
+static void check_subset(const H5::DataSet& dhandle, const std::vector<double>& example, const std::vector<hsize_t>& indices, hsize_t buffer_size) {
+    // One value at a time.
+    {
+        ritsuko::hdf5::Stream1dNumericSubset<double> stream(&dhandle, indices, buffer_size);
+        EXPECT_EQ(stream.length(), indices.size());
+        for (auto i : indices) {
+            EXPECT_EQ(stream.get(), example[i]);
+            stream.next();
+        }
+        EXPECT_EQ(stream.position(), indices.size());
+    }
+
+    // Fetching a data block.
+    {
+        ritsuko::hdf5::Stream1dNumericSubset<double> stream(&dhandle, indices, buffer_size);
+        size_t start = 0;
+        while (start < indices.size()) {
+            auto many = stream.get_many();
+            for (size_t i = 0; i < many.second; ++i) {
+                EXPECT_EQ(example[indices[i + start]], many.first[i]);
+            }
+            start += many.second;
+            stream.next(many.second);
+        }
+        EXPECT_EQ(start, indices.size());
+    }
+}
+
+TEST(Hdf5Stream1dNumericSubset, Basic) {
+    const char* path = "TEST-subset.h5";
+
+    std::vector<double> example(19726);
+    std::iota(example.begin(), example.end(), 0.5);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "chunked", example, H5::PredType::NATIVE_DOUBLE, 471);
+        create_dataset(handle, "contiguous", example, H5::PredType::NATIVE_DOUBLE);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    std::vector<hsize_t> buffer_sizes { 1, 50, 1000, 100000 };
+
+    std::mt19937_64 rng(10);
+    std::vector<hsize_t> sparse, dense, unsorted;
+    for (hsize_t i = 0; i < example.size(); ++i) {
+        auto choice = rng() % 20;
+        if (choice == 0) {
+            sparse.push_back(i);
+        }
+        if (choice < 15) {
+            dense.push_back(i);
+            if (choice == 1) {
+                dense.push_back(i); // adding some duplicates.
+            }
+        }
+    }
+    for (int i = 0; i < 3000; ++i) {
+        unsorted.push_back(rng() % example.size());
+    }
+
+    for (auto name : { "chunked", "contiguous" }) {
+        auto dhandle = handle.openDataSet(name);
+        for (auto buf : buffer_sizes) {
+            check_subset(dhandle, example, sparse, buf);
+            check_subset(dhandle, example, dense, buf);
+            check_subset(dhandle, example, unsorted, buf);
+        }
+    }
+}
+
+TEST(Hdf5Stream1dNumericSubset, Edge) {
+    const char* path = "TEST-subset.h5";
+
+    std::vector<int> example(1000);
+    std::iota(example.begin(), example.end(), 0);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foobar", example, H5::PredType::NATIVE_INT, 100);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foobar");
+
+    {
+        ritsuko::hdf5::Stream1dNumericSubset<int> stream(&dhandle, std::vector<hsize_t>{}, 100);
+        EXPECT_EQ(stream.length(), 0);
+        EXPECT_ANY_THROW(stream.get());
+    }
+
+    // Windows are trimmed at chunk boundaries for sorted indices.
+    {
+        std::vector<hsize_t> indices { 5, 50, 99, 100, 101, 150, 250, 999 };
+        ritsuko::hdf5::Stream1dNumericSubset<int> stream(&dhandle, indices, 4);
+        auto many = stream.get_many();
+        EXPECT_EQ(many.second, 3);
+        stream.next(many.second);
+        many = stream.get_many();
+        EXPECT_EQ(many.second, 4);
+        EXPECT_EQ(many.first[0], 100);
+        EXPECT_EQ(many.first[3], 250);
+    }
+
+    // Gaps within the same chunk are read and discarded.
+    {
+        std::vector<hsize_t> indices { 5, 7, 50, 99, 100, 102, 150, 999 };
+        ritsuko::hdf5::Stream1dNumericSubset<int> stream(&dhandle, indices, 100);
+        for (auto i : indices) {
+            EXPECT_EQ(stream.get(), example[i]);
+            stream.next();
+        }
+        EXPECT_EQ(stream.num_read(), 95 + 3 + 1 + 1);
+    }
+
+    // Total gap size is capped by the buffer size.
+    {
+        std::vector<hsize_t> indices { 5, 6, 50, 60, 98, 99 };
+        ritsuko::hdf5::Stream1dNumericSubset<int> stream(&dhandle, indices, 40);
+        for (auto i : indices) {
+            EXPECT_EQ(stream.get(), example[i]);
+            stream.next();
+        }
+        EXPECT_EQ(stream.num_read(), 2 + 11 + 2);
+    }
+
+    EXPECT_ANY_THROW(ritsuko::hdf5::Stream1dNumericSubset<int>(&dhandle, std::vector<hsize_t>{ 1000 }, 100));
+}
@@ -43,6 +43,15 @@ TEST(Hdf5Stream1dStringDataset, Fixed) {
             stream.next();
         }
     }
+
+    // Viewing.
+    for (auto buf : buffer_sizes) {
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, buf);
+        for (auto x : example) {
+            EXPECT_EQ(stream.get_view(), x);
+            stream.next();
+        }
+    }
 }
 
 TEST(Hdf5Stream1dStringDataset, Variable) {
@@ -83,12 +92,45 @@ TEST(Hdf5Stream1dStringDataset, Variable) {
         }
     }
 
+    // Viewing.
+    for (auto buf : buffer_sizes) {
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, buf);
+        for (auto x : example) {
+            EXPECT_EQ(stream.get_view(), x);
+            stream.next();
+        }
+    }
+
     // Validating.
     for (auto buf : buffer_sizes) {
         ritsuko::hdf5::validate_1d_string_dataset(dhandle, buf);
     }
 }
 
+TEST(Hdf5Stream1dStringDataset, ViewEmbedded) {
+    const char* path = "TEST-load-string.h5";
+
+    // Checking that views handle empty strings and fixed-length strings that fill the entire width.
+    std::vector<std::string> example { "", "aaaa", "", "bb", "cccc", "" };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "fixed", example, false);
+        create_dataset(handle, "variable", example, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "fixed", "variable" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 4);
+        for (const auto& x : example) {
+            auto view = stream.get_view();
+            EXPECT_EQ(view, x);
+            EXPECT_EQ(view.size(), x.size());
+            stream.next();
+        }
+    }
+}
+
 TEST(Hdf5Stream1dStringDataset, VariableNullFail) {
     const char* path = "TEST-load-string.h5";
 
@@ -121,3 +163,70 @@ TEST(Hdf5Stream1dStringDataset, VariableNullFail) {
         }
     });
 }
+
+TEST(Hdf5Stream1dStringDataset, CheckUtf8) {
+    const char* path = "TEST-load-string.h5";
+
+    std::vector<std::string> example(1000);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = "α" + std::to_string(i);
+    }
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "fixed", example, false);
+        create_dataset(handle, "variable", example, true);
+        example[567] = "foo\xC3";
+        create_dataset(handle, "fixed_bad", example, false);
+        create_dataset(handle, "variable_bad", example, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "fixed", "variable" }) {
+        auto dhandle = handle.openDataSet(name);
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 100);
+        stream.set_check_utf8(true);
+        for (size_t i = 0; i < example.size(); ++i) {
+            stream.get_view();
+            stream.next();
+        }
+        ritsuko::hdf5::validate_1d_string_dataset(dhandle, example.size(), 100, NULL, true);
+    }
+
+    for (auto name : { "fixed_bad", "variable_bad" }) {
+        auto dhandle = handle.openDataSet(name);
+
+        // No error without the check.
+        {
+            ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 100);
+            for (size_t i = 0; i < example.size(); ++i) {
+                EXPECT_EQ(stream.get(), example[i]);
+                stream.next();
+            }
+            ritsuko::hdf5::validate_1d_string_dataset(dhandle, 100);
+        }
+
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 100);
+        stream.set_check_utf8(true);
+        EXPECT_ANY_THROW({
+            try {
+                for (size_t i = 0; i < example.size(); ++i) {
+                    stream.get_view();
+                    stream.next();
+                }
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid UTF-8 in string 567"));
+                throw;
+            }
+        });
+
+        EXPECT_ANY_THROW({
+            try {
+                ritsuko::hdf5::validate_1d_string_dataset(dhandle, example.size(), 100, NULL, true);
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid UTF-8 in string 567"));
+                throw;
+            }
+        });
+    }
+}
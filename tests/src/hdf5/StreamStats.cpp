@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/Stream1dNumericDataset.hpp"
+#include "ritsuko/hdf5/Stream1dStringDataset.hpp"
+#include "ritsuko/hdf5/IterateNdDataset.hpp"
+#include "ritsuko/hdf5/validate_string.hpp"
+#include "ritsuko/hdf5/vls/Stream1dArray.hpp"
+#include "utils.h"
+#include <numeric>
+
+// This file is compiled twice, with and without RITSUKO_HDF5_STREAM_STATS.
+#ifdef RITSUKO_HDF5_STREAM_STATS
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+TEST(Hdf5StreamStats, Recorder) {
+    ritsuko::hdf5::StreamStatsRecorder recorder;
+    bool called = false;
+    recorder.record_read(10, 80, [&]() -> void { called = true; });
+    EXPECT_TRUE(called);
+    recorder.record_conversion([&]() -> void { called = false; });
+    EXPECT_FALSE(called);
+    recorder.record_block();
+    recorder.record_allocation(100);
+
+    auto stats = recorder.get();
+    EXPECT_EQ(stats.num_reads, stats_enabled ? 1 : 0);
+    EXPECT_EQ(stats.elements_read, stats_enabled ? 10 : 0);
+    EXPECT_EQ(stats.bytes_read, stats_enabled ? 80 : 0);
+    EXPECT_EQ(stats.blocks_loaded, stats_enabled ? 1 : 0);
+    EXPECT_EQ(stats.bytes_allocated, stats_enabled ? 100 : 0);
+    EXPECT_GE(stats.read_time, 0);
+
+    ritsuko::hdf5::StreamStats total;
+    total += stats;
+    total += stats;
+    EXPECT_EQ(total.num_reads, 2 * stats.num_reads);
+    EXPECT_EQ(total.bytes_allocated, 2 * stats.bytes_allocated);
+}
+
+TEST(Hdf5StreamStats, NumericStream) {
+    const char* path = "TEST-stats.h5";
+    std::vector<int16_t> example(1000);
+    std::iota(example.begin(), example.end(), 0);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foobar", example, H5::PredType::NATIVE_INT16);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foobar");
+    ritsuko::hdf5::Stream1dNumericDataset<double> stream(&dhandle, 300);
+    EXPECT_EQ(stream.stats().bytes_allocated, stats_enabled ? 300 * sizeof(double) : 0);
+
+    for (size_t i = 0; i < example.size(); ++i) {
+        stream.get();
+        stream.next();
+    }
+
+    auto stats = stream.stats();
+    EXPECT_EQ(stats.num_reads, stats_enabled ? 4 : 0);
+    EXPECT_EQ(stats.blocks_loaded, stats_enabled ? 4 : 0);
+    EXPECT_EQ(stats.elements_read, stats_enabled ? 1000 : 0);
+    EXPECT_EQ(stats.bytes_read, stats_enabled ? 1000 * sizeof(int16_t) : 0); // staged in the file representation.
+}
+
+TEST(Hdf5StreamStats, StringStream) {
+    const char* path = "TEST-stats.h5";
+    std::vector<std::string> example { "A", "BB", "CCC", "DDDD", "EEEEE" };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "fixed", example, false);
+        create_dataset(handle, "variable", example, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    {
+        auto dhandle = handle.openDataSet("fixed");
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 2);
+        for (size_t i = 0; i < example.size(); ++i) {
+            EXPECT_EQ(stream.get(), example[i]);
+            stream.next();
+        }
+        auto stats = stream.stats();
+        EXPECT_EQ(stats.num_reads, stats_enabled ? 3 : 0);
+        EXPECT_EQ(stats.elements_read, stats_enabled ? 5 : 0);
+        EXPECT_EQ(stats.bytes_read, stats_enabled ? 25 : 0);
+    }
+
+    {
+        auto dhandle = handle.openDataSet("variable");
+        ritsuko::hdf5::Stream1dStringDataset stream(&dhandle, 10);
+        for (size_t i = 0; i < example.size(); ++i) {
+            EXPECT_EQ(stream.get(), example[i]);
+            stream.next();
+        }
+        auto stats = stream.stats();
+        EXPECT_EQ(stats.num_reads, stats_enabled ? 1 : 0);
+        EXPECT_EQ(stats.blocks_loaded, stats_enabled ? 1 : 0);
+    }
+
+    // Also works for the validators.
+    {
+        auto dhandle = handle.openDataSet("variable");
+        ritsuko::hdf5::StreamStats stats;
+        ritsuko::hdf5::validate_1d_string_dataset(dhandle, 5, 2, &stats);
+        EXPECT_EQ(stats.num_reads, stats_enabled ? 3 : 0);
+        ritsuko::hdf5::validate_nd_string_dataset(dhandle, std::vector<hsize_t>{ 5 }, 10, &stats);
+        EXPECT_EQ(stats.num_reads, stats_enabled ? 4 : 0);
+    }
+}
+
+TEST(Hdf5StreamStats, IterateNdDataset) {
+    ritsuko::hdf5::IterateNdDataset iter({ 10, 20 }, { 4, 5 });
+    size_t counter = 0;
+    while (!iter.finished()) {
+        ++counter;
+        iter.next();
+    }
+    EXPECT_EQ(counter, 12);
+    EXPECT_EQ(iter.stats().blocks_loaded, stats_enabled ? counter : 0);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/VariableStringArena.hpp"
+#include "utils.h"
+#include <string>
+#include <vector>
+
+TEST(Hdf5VariableStringArena, Basic) {
+    const char* path = "TEST-arena.h5";
+
+    std::vector<std::string> example(1000);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = std::to_string(i * 1000);
+    }
+    example[500] = std::string(5000, 'x'); // larger than a block.
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foobar", example, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foobar");
+    auto dtype = dhandle.getDataType();
+
+    ritsuko::hdf5::VariableStringArena arena(1024);
+    EXPECT_EQ(arena.capacity(), 0);
+    std::vector<char*> buffer(example.size());
+
+    dhandle.read(buffer.data(), dtype, H5S_ALL, H5S_ALL, arena.transfer_plist());
+    for (size_t i = 0; i < example.size(); ++i) {
+        ASSERT_TRUE(buffer[i] != NULL);
+        EXPECT_EQ(std::string(buffer[i]), example[i]);
+    }
+
+    auto capacity = arena.capacity();
+    EXPECT_GT(capacity, 5000);
+
+    // Repeated reads reuse the same blocks.
+    arena.reset();
+    dhandle.read(buffer.data(), dtype, H5S_ALL, H5S_ALL, arena.transfer_plist());
+    for (size_t i = 0; i < example.size(); ++i) {
+        EXPECT_EQ(std::string(buffer[i]), example[i]);
+    }
+    EXPECT_EQ(arena.capacity(), capacity);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/find_duplicate_string.hpp"
+#include "utils.h"
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+TEST(Hdf5FindDuplicateString, HashString) {
+    std::string x = "the quick brown fox jumps over the lazy dog";
+    EXPECT_EQ(ritsuko::hdf5::hash_string(x.data(), x.size()), ritsuko::hdf5::hash_string(x.data(), x.size()));
+
+    // All prefixes should have different hashes.
+    std::unordered_set<uint64_t> collected;
+    for (size_t i = 0; i <= x.size(); ++i) {
+        collected.insert(ritsuko::hdf5::hash_string(x.data(), i));
+    }
+    EXPECT_EQ(collected.size(), x.size() + 1);
+
+    // Trailing zeros should not collide with a shorter string.
+    std::string y("abc\0", 4);
+    EXPECT_NE(ritsuko::hdf5::hash_string(y.data(), 3), ritsuko::hdf5::hash_string(y.data(), 4));
+}
+
+TEST(Hdf5FindDuplicateString, Basic) {
+    const char* path = "TEST-find-duplicate.h5";
+
+    std::vector<std::string> unique(5000);
+    for (size_t i = 0; i < unique.size(); ++i) {
+        unique[i] = "gene_" + std::to_string(i);
+    }
+    auto dupped = unique;
+    dupped[3456] = dupped[1234];
+    dupped[4000] = dupped[10];
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "unique_fixed", unique, false, 100);
+        create_dataset(handle, "unique_variable", unique, true, 100);
+        create_dataset(handle, "dupped_fixed", dupped, false, 100);
+        create_dataset(handle, "dupped_variable", dupped, true, 100);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (size_t limit : { 268435456, 10000, 1000 }) { // in memory, and with several partitions.
+        ritsuko::hdf5::FindDuplicateStringOptions opt;
+        opt.memory_limit = limit;
+
+        for (auto name : { "unique_fixed", "unique_variable" }) {
+            auto dhandle = handle.openDataSet(name);
+            EXPECT_FALSE(ritsuko::hdf5::find_duplicate_1d_string(dhandle, 500, opt).has_value());
+        }
+
+        for (auto name : { "dupped_fixed", "dupped_variable" }) {
+            auto dhandle = handle.openDataSet(name);
+            auto found = ritsuko::hdf5::find_duplicate_1d_string(dhandle, 500, opt);
+            ASSERT_TRUE(found.has_value());
+            EXPECT_EQ(found->first, 1234);
+            EXPECT_EQ(found->second, 3456);
+        }
+    }
+}
+
+TEST(Hdf5FindDuplicateString, Empty) {
+    const char* path = "TEST-find-duplicate.h5";
+    std::vector<std::string> example { "", "a", "" };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "foo", example, true);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+    auto found = ritsuko::hdf5::find_duplicate_1d_string(dhandle, 10);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->first, 0);
+    EXPECT_EQ(found->second, 2);
+}
+
+TEST(Hdf5FindDuplicateString, Skewed) {
+    const char* path = "TEST-find-duplicate.h5";
+
+    // Most strings are identical, so their hashes all land in the same
+    // partition regardless of how often it is re-split.
+    std::vector<std::string> example(3000);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = (i >= 2000 ? std::string("same") : "gene_" + std::to_string(i));
+    }
+    auto dupped = example;
+    dupped[1500] = dupped[123];
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "skewed", example, true, 100);
+        create_dataset(handle, "dupped", dupped, false, 100);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (size_t limit : { 268435456, 5000, 1000 }) {
+        ritsuko::hdf5::FindDuplicateStringOptions opt;
+        opt.memory_limit = limit;
+
+        auto shandle = handle.openDataSet("skewed");
+        auto found = ritsuko::hdf5::find_duplicate_1d_string(shandle, 500, opt);
+        ASSERT_TRUE(found.has_value());
+        EXPECT_EQ(found->first, 2000);
+        EXPECT_EQ(found->second, 2001);
+
+        auto dhandle = handle.openDataSet("dupped");
+        found = ritsuko::hdf5::find_duplicate_1d_string(dhandle, 500, opt);
+        ASSERT_TRUE(found.has_value());
+        EXPECT_EQ(found->first, 123);
+        EXPECT_EQ(found->second, 1500);
+    }
+}
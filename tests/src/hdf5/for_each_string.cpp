@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/for_each_string.hpp"
+#include "utils.h"
+#include <string>
+#include <vector>
+
+TEST(Hdf5ForEachString, OneDimensional) {
+    const char* path = "TEST-for-each-string.h5";
+
+    std::vector<std::string> example(5432);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = (i % 7 == 0 ? std::string() : std::to_string(i));
+    }
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "fixed", example, false, 123);
+        create_dataset(handle, "variable", example, true, 123);
+        create_dataset(handle, "contiguous", example, false);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "fixed", "variable", "contiguous" }) {
+        auto dhandle = handle.openDataSet(name);
+        for (hsize_t buf : { 100, 1000, 10000 }) {
+            std::vector<std::string> collected;
+            bool finished = ritsuko::hdf5::for_each_1d_string(dhandle, buf, [&](hsize_t i, const char* ptr, size_t len) -> void {
+                EXPECT_EQ(i, collected.size());
+                collected.emplace_back(ptr, len);
+            });
+            EXPECT_TRUE(finished);
+            EXPECT_EQ(collected, example);
+        }
+
+        // Early termination.
+        hsize_t last = 0;
+        bool finished = ritsuko::hdf5::for_each_1d_string(dhandle, example.size(), 100, [&](hsize_t i, const char*, size_t) -> bool {
+            last = i;
+            return i < 1234;
+        });
+        EXPECT_FALSE(finished);
+        EXPECT_EQ(last, 1234);
+    }
+}
+
+TEST(Hdf5ForEachString, NDimensional) {
+    const char* path = "TEST-for-each-string.h5";
+
+    std::vector<hsize_t> dims{ 37, 51 };
+    std::vector<hsize_t> chunks{ 10, 20 };
+    std::vector<std::string> example(dims[0] * dims[1]);
+    std::vector<const char*> ptrs(example.size());
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = std::to_string(i);
+        ptrs[i] = example[i].c_str();
+    }
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DataSpace dspace(2, dims.data());
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(2, chunks.data());
+        H5::StrType vtype(0, H5T_VARIABLE);
+        handle.createDataSet("variable", vtype, dspace, cplist).write(ptrs.data(), vtype);
+        H5::StrType ftype(0, 4);
+        std::vector<char> fixed(example.size() * 4);
+        for (size_t i = 0; i < example.size(); ++i) {
+            std::copy(example[i].begin(), example[i].end(), fixed.data() + i * 4);
+        }
+        handle.createDataSet("fixed", ftype, dspace, cplist).write(fixed.data(), ftype);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto name : { "variable", "fixed" }) {
+        auto dhandle = handle.openDataSet(name);
+        for (hsize_t buf : { 100, 1000, 100000 }) {
+            std::vector<int> visited(example.size());
+            bool finished = ritsuko::hdf5::for_each_nd_string(dhandle, buf, [&](hsize_t i, const char* ptr, size_t len) -> void {
+                EXPECT_EQ(std::string(ptr, len), example[i]);
+                ++visited[i];
+            });
+            EXPECT_TRUE(finished);
+            EXPECT_EQ(visited, std::vector<int>(example.size(), 1));
+        }
+
+        size_t count = 0;
+        bool finished = ritsuko::hdf5::for_each_nd_string(dhandle, dims, 1000, [&](hsize_t, const char*, size_t) -> bool {
+            ++count;
+            return count < 50;
+        });
+        EXPECT_FALSE(finished);
+        EXPECT_EQ(count, 50);
+    }
+}
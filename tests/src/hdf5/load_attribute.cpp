@@ -112,6 +112,12 @@ TEST(Hdf5LoadAttribute, Fixed1d) {
     auto counterexample = ritsuko::hdf5::load_1d_string_attribute(ahandle);
     EXPECT_EQ(example, counterexample);
     ritsuko::hdf5::validate_1d_string_attribute(ahandle);
+
+    auto column = ritsuko::hdf5::load_1d_string_attribute_as_column(ahandle);
+    ASSERT_EQ(column.size(), example.size());
+    for (size_t i = 0; i < example.size(); ++i) {
+        EXPECT_EQ(column[i], example[i]);
+    }
 }
 
 TEST(Hdf5LoadAttribute, Variable1d) {
@@ -146,6 +152,12 @@ TEST(Hdf5LoadAttribute, Variable1d) {
         auto counterexample = ritsuko::hdf5::load_1d_string_attribute(ahandle);
         EXPECT_EQ(example, counterexample);
         ritsuko::hdf5::validate_1d_string_attribute(ahandle);
+
+        auto column = ritsuko::hdf5::load_1d_string_attribute_as_column<int32_t>(ahandle);
+        ASSERT_EQ(column.size(), example.size());
+        for (size_t i = 0; i < example.size(); ++i) {
+            EXPECT_EQ(column[i], example[i]);
+        }
     }
 
     {
@@ -2,6 +2,7 @@
 #include <gmock/gmock.h>
 #include "ritsuko/hdf5/load_dataset.hpp"
 #include "ritsuko/hdf5/validate_string.hpp"
+#include "ritsuko/DefaultInitAllocator.hpp"
 #include "utils.h"
 
 TEST(Hdf5LoadDataset, ScalarString) {
@@ -85,6 +86,12 @@ TEST(Hdf5LoadDataset, String1d) {
         auto dhandle = handle.openDataSet("blah");
         EXPECT_EQ(ritsuko::hdf5::load_1d_string_dataset(dhandle, 10), values);
         ritsuko::hdf5::validate_1d_string_dataset(dhandle, 10);
+
+        auto column = ritsuko::hdf5::load_1d_string_dataset_as_column(dhandle, 2);
+        ASSERT_EQ(column.size(), values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ(column[i], values[i]);
+        }
     }
 
     // Fixed.
@@ -98,6 +105,12 @@ TEST(Hdf5LoadDataset, String1d) {
         auto dhandle = handle.openDataSet("blah");
         EXPECT_EQ(ritsuko::hdf5::load_1d_string_dataset(dhandle, 10), values);
         ritsuko::hdf5::validate_1d_string_dataset(dhandle, 10);
+
+        auto column = ritsuko::hdf5::load_1d_string_dataset_as_column(dhandle, 2);
+        ASSERT_EQ(column.size(), values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ(column[i], values[i]);
+        }
     }
 
     {
@@ -119,6 +132,15 @@ TEST(Hdf5LoadDataset, String1d) {
             }
         });
 
+        EXPECT_ANY_THROW({
+            try {
+                ritsuko::hdf5::load_1d_string_dataset_as_column<int32_t>(dhandle, 10);
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("NULL pointer"));
+                throw;
+            }
+        });
+
         EXPECT_ANY_THROW({
             try {
                 ritsuko::hdf5::validate_1d_string_dataset(dhandle, 10);
@@ -130,6 +152,48 @@ TEST(Hdf5LoadDataset, String1d) {
     }
 } 
 
+TEST(Hdf5LoadDataset, String1dFactor) {
+    const char* path = "TEST-string1d.h5";
+    std::vector<std::string> choices { "kaori", "fuyuki", "shizuka", "meguru", "hiori", "a-rather-long-string-that-is-not-subject-to-SSO" };
+    std::vector<std::string> values(1000);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = choices[(i * 7 + i / 13) % choices.size()];
+    }
+
+    for (bool variable : { true, false }) {
+        {
+            H5::H5File handle(path, H5F_ACC_TRUNC);
+            create_dataset(handle, "blah", values, variable, 50);
+        }
+
+        H5::H5File handle(path, H5F_ACC_RDONLY);
+        auto dhandle = handle.openDataSet("blah");
+
+        auto loaded = ritsuko::hdf5::load_1d_string_dataset_as_factor(dhandle, 90);
+        EXPECT_TRUE(loaded.is_factor);
+        EXPECT_TRUE(loaded.strings.empty());
+        EXPECT_EQ(loaded.levels.size(), choices.size());
+        ASSERT_EQ(loaded.codes.size(), values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ(loaded.levels[loaded.codes[i]], values[i]);
+        }
+        EXPECT_EQ(loaded.levels[0], values[0]); // in order of first appearance.
+
+        // Works with a smaller code type.
+        auto small = ritsuko::hdf5::load_1d_string_dataset_as_factor<uint8_t>(dhandle, values.size(), 90, 10);
+        EXPECT_TRUE(small.is_factor);
+        EXPECT_EQ(small.levels, loaded.levels);
+        EXPECT_EQ(std::vector<uint32_t>(small.codes.begin(), small.codes.end()), loaded.codes);
+
+        // Falls back to plain strings if there are too many levels.
+        auto capped = ritsuko::hdf5::load_1d_string_dataset_as_factor(dhandle, values.size(), 90, 3);
+        EXPECT_FALSE(capped.is_factor);
+        EXPECT_TRUE(capped.codes.empty());
+        EXPECT_TRUE(capped.levels.empty());
+        EXPECT_EQ(capped.strings, values);
+    }
+}
+
 TEST(Hdf5LoadDataset, ScalarNumber) {
     const char* path = "TEST-scalar-number.h5";
 
@@ -174,4 +238,8 @@ TEST(Hdf5LoadDataset, Number1d) {
         auto extracted = ritsuko::hdf5::load_1d_numeric_dataset<int16_t>(handle.openDataSet("odds"), 10);
         EXPECT_EQ(odds, std::vector<int>(extracted.begin(), extracted.end()));
     }
+    {
+        auto extracted = ritsuko::hdf5::load_1d_numeric_dataset<int64_t, ritsuko::DefaultInitAllocator<int64_t> >(handle.openDataSet("odds"), 3);
+        EXPECT_EQ(odds, std::vector<int>(extracted.begin(), extracted.end()));
+    }
 }
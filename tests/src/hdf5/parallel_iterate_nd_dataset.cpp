@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/parallel_iterate_nd_dataset.hpp"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+TEST(Hdf5ParallelIterateNdDataset, BlockStealer) {
+    // A single worker should steal everything from the others.
+    ritsuko::hdf5::internal::BlockStealer stealer(103, 4);
+    std::vector<size_t> collected;
+    size_t task;
+    while (stealer.next(0, task)) {
+        collected.push_back(task);
+    }
+    EXPECT_EQ(collected.size(), 103);
+    std::sort(collected.begin(), collected.end());
+    for (size_t i = 0; i < collected.size(); ++i) {
+        EXPECT_EQ(collected[i], i);
+    }
+    EXPECT_FALSE(stealer.next(1, task));
+
+    // Each worker starts from its own contiguous range.
+    ritsuko::hdf5::internal::BlockStealer stealer2(10, 3);
+    EXPECT_TRUE(stealer2.next(0, task));
+    EXPECT_EQ(task, 0);
+    EXPECT_TRUE(stealer2.next(1, task));
+    EXPECT_EQ(task, 4);
+    EXPECT_TRUE(stealer2.next(2, task));
+    EXPECT_EQ(task, 7);
+}
+
+TEST(Hdf5ParallelIterateNdDataset, Reduction) {
+    std::vector<hsize_t> dims { 123, 78, 45 };
+    std::vector<hsize_t> chunks { 13, 20, 9 };
+    const char* path = "TEST-parallel-nd.h5";
+    {
+        std::vector<int> values(dims[0] * dims[1] * dims[2]);
+        std::iota(values.begin(), values.end(), 0);
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(3, chunks.data());
+        cplist.setDeflate(6);
+        H5::DataSpace dspace(3, dims.data());
+        auto dhandle = handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist);
+        dhandle.write(values.data(), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+
+    struct State {
+        std::vector<int> buffer;
+        long long sum = 0;
+        size_t nblocks = 0;
+    };
+
+    std::vector<hsize_t> blocks { 26, 20, 45 };
+    for (int nthreads : { 0, 1, 3, 8 }) {
+        std::vector<unsigned char> visited(dims[0] * dims[1] * dims[2]);
+        auto states = ritsuko::hdf5::parallel_iterate_nd_dataset<State>(dims, blocks, nthreads, [&](const ritsuko::hdf5::NdBlockSelection& block, State& state) -> void {
+            state.buffer.resize(block.size);
+            ritsuko::hdf5::serialize([&]() -> void {
+                EXPECT_EQ(block.file_space.getSelectNpoints(), block.size);
+                EXPECT_EQ(block.memory_space.getSelectNpoints(), block.size);
+                dhandle.read(state.buffer.data(), H5::PredType::NATIVE_INT, block.memory_space, block.file_space);
+            });
+
+            auto bptr = state.buffer.data();
+            for (hsize_t x = 0; x < block.counts[0]; ++x) {
+                for (hsize_t y = 0; y < block.counts[1]; ++y) {
+                    for (hsize_t z = 0; z < block.counts[2]; ++z, ++bptr) {
+                        size_t index = ((block.starts[0] + x) * dims[1] + block.starts[1] + y) * dims[2] + block.starts[2] + z;
+                        EXPECT_EQ(*bptr, static_cast<int>(index));
+                        ++visited[index];
+                    }
+                }
+            }
+
+            state.sum += std::accumulate(state.buffer.begin(), state.buffer.end(), 0LL);
+            ++state.nblocks;
+        });
+
+        EXPECT_EQ(states.size(), static_cast<size_t>(std::max(nthreads, 1)));
+        long long total = 0;
+        size_t nblocks = 0;
+        for (const auto& s : states) {
+            total += s.sum;
+            nblocks += s.nblocks;
+        }
+
+        long long n = visited.size();
+        EXPECT_EQ(total, n * (n - 1) / 2);
+        EXPECT_EQ(nblocks, 5 * 4 * 1);
+        EXPECT_TRUE(std::all_of(visited.begin(), visited.end(), [](unsigned char x) -> bool { return x == 1; }));
+    }
+}
+
+TEST(Hdf5ParallelIterateNdDataset, Layout) {
+    std::vector<hsize_t> dims { 61, 38, 27 };
+    std::vector<hsize_t> chunks { 13, 20, 9 };
+    const char* path = "TEST-parallel-nd.h5";
+    {
+        std::vector<int> values(dims[0] * dims[1] * dims[2]);
+        std::iota(values.begin(), values.end(), 0);
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(3, chunks.data());
+        H5::DataSpace dspace(3, dims.data());
+        auto dhandle = handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist);
+        dhandle.write(values.data(), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+
+    struct State {
+        std::vector<int> staging, buffer;
+        size_t count = 0;
+    };
+
+    std::vector<hsize_t> blocks { 13, 20, 18 };
+    for (auto layout : { std::vector<size_t>{ 2, 0, 1 }, std::vector<size_t>{ 0, 1, 2 } }) {
+        ritsuko::hdf5::ParallelIterateNdDatasetOptions opt;
+        opt.layout = layout;
+
+        auto states = ritsuko::hdf5::parallel_iterate_nd_dataset<State>(dims, blocks, 3, opt, [&](const ritsuko::hdf5::NdBlockSelection& block, State& state) -> void {
+            EXPECT_EQ(block.layout, layout);
+            EXPECT_EQ(block.permuted, layout[0] != 0);
+            state.staging.resize(block.size);
+            state.buffer.resize(block.size);
+            ritsuko::hdf5::serialize([&]() -> void {
+                dhandle.read(state.staging.data(), H5::PredType::NATIVE_INT, block.memory_space, block.file_space);
+            });
+            block.permute(state.staging.data(), state.buffer.data());
+
+            EXPECT_EQ(block.strides[layout[2]], 1);
+            for (hsize_t x = 0; x < block.counts[0]; ++x) {
+                for (hsize_t y = 0; y < block.counts[1]; ++y) {
+                    for (hsize_t z = 0; z < block.counts[2]; ++z) {
+                        size_t index = ((block.starts[0] + x) * dims[1] + block.starts[1] + y) * dims[2] + block.starts[2] + z;
+                        EXPECT_EQ(state.buffer[x * block.strides[0] + y * block.strides[1] + z * block.strides[2]], static_cast<int>(index));
+                    }
+                }
+            }
+            state.count += block.size;
+        });
+
+        size_t total = 0;
+        for (const auto& s : states) {
+            total += s.count;
+        }
+        EXPECT_EQ(total, dims[0] * dims[1] * dims[2]);
+    }
+
+    ritsuko::hdf5::ParallelIterateNdDatasetOptions opt;
+    opt.layout = std::vector<size_t>{ 0, 0, 1 };
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::hdf5::parallel_iterate_nd_dataset<int>(dims, blocks, 2, opt, [&](const ritsuko::hdf5::NdBlockSelection&, int&) -> void {});
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("permutation"));
+            throw;
+        }
+    });
+}
+
+TEST(Hdf5ParallelIterateNdDataset, Error) {
+    std::vector<hsize_t> dims { 123, 78, 45 };
+    std::vector<hsize_t> blocks { 10, 10, 10 };
+    for (int nthreads : { 1, 3, 8 }) {
+        EXPECT_ANY_THROW({
+            try {
+                ritsuko::hdf5::parallel_iterate_nd_dataset<int>(dims, blocks, nthreads, [&](const ritsuko::hdf5::NdBlockSelection& block, int&) -> void {
+                    if (block.starts[0] == 50) {
+                        throw std::runtime_error("failed at block");
+                    }
+                });
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("failed at block"));
+                throw;
+            }
+        });
+    }
+}
+
+TEST(Hdf5ParallelIterateNdDataset, Empty) {
+    std::vector<hsize_t> dims { 240, 0, 300 };
+    std::vector<hsize_t> blocks { 29, 0, 77 };
+    size_t count = 0;
+    auto states = ritsuko::hdf5::parallel_iterate_nd_dataset<int>(dims, blocks, 4, [&](const ritsuko::hdf5::NdBlockSelection&, int&) -> void {
+        ++count;
+    });
+    EXPECT_EQ(states.size(), 4);
+    EXPECT_EQ(count, 0);
+}
@@ -56,3 +56,43 @@ TEST(Hdf5Pick1dBlockSize, Short) {
         EXPECT_EQ(block_size, 0);
     }
 }
+
+TEST(Hdf5PickShared1dBlockSize, Basic) {
+    hsize_t buffer = 10000;
+    hsize_t len = 30000;
+
+    auto make_chunked = [](hsize_t chunk) -> H5::DSetCreatPropList {
+        H5::DSetCreatPropList cplist;
+        cplist.setChunk(1, &chunk);
+        cplist.setDeflate(8);
+        return cplist;
+    };
+
+    // Aligns to the least common multiple of the chunk sizes.
+    {
+        std::vector<H5::DSetCreatPropList> cplists { make_chunked(60), make_chunked(84), H5::DSetCreatPropList() };
+        auto block_size = ritsuko::hdf5::pick_shared_1d_block_size(cplists, len, buffer);
+        EXPECT_EQ(block_size, (buffer / 420) * 420);
+    }
+
+    // Falls back to the largest chunk if the least common multiple is too big.
+    {
+        std::vector<H5::DSetCreatPropList> cplists { make_chunked(997), make_chunked(1009) };
+        auto block_size = ritsuko::hdf5::pick_shared_1d_block_size(cplists, len, buffer);
+        EXPECT_EQ(block_size, (buffer / 1009) * 1009);
+    }
+
+    // Same as the single-dataset case if there are no chunks.
+    {
+        std::vector<H5::DSetCreatPropList> cplists { H5::DSetCreatPropList(), H5::DSetCreatPropList() };
+        EXPECT_EQ(ritsuko::hdf5::pick_shared_1d_block_size(cplists, len, buffer), buffer);
+        EXPECT_EQ(ritsuko::hdf5::pick_shared_1d_block_size(cplists, 5, buffer), 5);
+    }
+
+    // Single chunks larger than the buffer are allowed.
+    {
+        std::vector<H5::DSetCreatPropList> cplists { make_chunked(15000), make_chunked(5000) };
+        auto block_size = ritsuko::hdf5::pick_shared_1d_block_size(cplists, len, buffer);
+        EXPECT_EQ(block_size, 15000);
+    }
+}
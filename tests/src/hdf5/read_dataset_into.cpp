@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/read_dataset_into.hpp"
+#include "utils.h"
+#include <numeric>
+
+TEST(Hdf5ReadDatasetInto, OneDimensional) {
+    const char* path = "TEST-read-into.h5";
+
+    std::vector<int> example(29726);
+    std::iota(example.begin(), example.end(), 0);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        create_dataset(handle, "chunked", example, H5::PredType::NATIVE_INT32, 471);
+        create_dataset(handle, "contiguous", example, H5::PredType::NATIVE_INT32);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    std::vector<hsize_t> buffer_sizes { 100, 1000, 100000 };
+
+    for (auto name : { "chunked", "contiguous" }) {
+        auto dhandle = handle.openDataSet(name);
+        for (auto buf : buffer_sizes) {
+            std::vector<int> output(example.size());
+            ritsuko::hdf5::read_1d_numeric_dataset_into(dhandle, output.data(), buf);
+            EXPECT_EQ(output, example);
+
+            // Reading a subrange, in a larger type.
+            std::vector<int64_t> sub(1234, -1);
+            ritsuko::hdf5::read_1d_numeric_dataset_into(dhandle, example.size(), 500, 1000, sub.data() + 1, buf);
+            EXPECT_EQ(sub.front(), -1);
+            for (size_t i = 0; i < 1000; ++i) {
+                EXPECT_EQ(sub[i + 1], example[i + 500]);
+            }
+            EXPECT_EQ(sub[1001], -1);
+        }
+
+        std::vector<int> output(10);
+        ritsuko::hdf5::read_1d_numeric_dataset_into(dhandle, example.size(), 10, 0, output.data(), 100);
+        EXPECT_ANY_THROW(ritsuko::hdf5::read_1d_numeric_dataset_into(dhandle, example.size(), example.size(), 10, output.data(), 100));
+    }
+}
+
+TEST(Hdf5ReadDatasetInto, MultiDimensional) {
+    const char* path = "TEST-read-into.h5";
+
+    std::vector<hsize_t> dims { 240, 100, 170 };
+    std::vector<int> values(dims[0] * dims[1] * dims[2]);
+    std::iota(values.begin(), values.end(), 0);
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList cplist;
+        std::vector<hsize_t> chunk{ 29, 17, 37 };
+        cplist.setChunk(3, chunk.data());
+        H5::DataSpace dspace(3, dims.data());
+        auto dhandle = handle.createDataSet("foo", H5::PredType::NATIVE_INT32, dspace, cplist);
+        dhandle.write(values.data(), H5::PredType::NATIVE_INT);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet("foo");
+
+    {
+        std::vector<int> output(values.size());
+        ritsuko::hdf5::read_nd_numeric_dataset_into(dhandle, dims, output.data(), 10000);
+        EXPECT_EQ(output, values);
+    }
+
+    // Padding the destination array.
+    {
+        std::vector<hsize_t> mdims { 241, 101, 176 };
+        std::vector<double> output(mdims[0] * mdims[1] * mdims[2], -1);
+        ritsuko::hdf5::read_nd_numeric_dataset_into(dhandle, dims, output.data(), mdims, 5000);
+
+        for (hsize_t i = 0; i < mdims[0]; ++i) {
+            for (hsize_t j = 0; j < mdims[1]; ++j) {
+                for (hsize_t k = 0; k < mdims[2]; ++k) {
+                    auto observed = output[(i * mdims[1] + j) * mdims[2] + k];
+                    if (i < dims[0] && j < dims[1] && k < dims[2]) {
+                        EXPECT_EQ(observed, values[(i * dims[1] + j) * dims[2] + k]);
+                    } else {
+                        EXPECT_EQ(observed, -1);
+                    }
+                }
+            }
+        }
+    }
+
+    // Padding the destination array without any type conversion.
+    {
+        std::vector<hsize_t> mdims { 240, 103, 171 };
+        std::vector<int> output(mdims[0] * mdims[1] * mdims[2], -1);
+        ritsuko::hdf5::read_nd_numeric_dataset_into(dhandle, dims, output.data(), mdims, 5000);
+
+        for (hsize_t i = 0; i < mdims[0]; ++i) {
+            for (hsize_t j = 0; j < mdims[1]; ++j) {
+                for (hsize_t k = 0; k < mdims[2]; ++k) {
+                    auto observed = output[(i * mdims[1] + j) * mdims[2] + k];
+                    if (j < dims[1] && k < dims[2]) {
+                        EXPECT_EQ(observed, values[(i * dims[1] + j) * dims[2] + k]);
+                    } else {
+                        EXPECT_EQ(observed, -1);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<int> output(values.size());
+    EXPECT_ANY_THROW(ritsuko::hdf5::read_nd_numeric_dataset_into(dhandle, dims, output.data(), std::vector<hsize_t>{ 10, 10, 10 }, 100));
+    EXPECT_ANY_THROW(ritsuko::hdf5::read_nd_numeric_dataset_into(dhandle, dims, output.data(), std::vector<hsize_t>{ 1000 }, 100));
+}
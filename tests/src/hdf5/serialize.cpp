@@ -0,0 +1,23 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/serialize.hpp"
+#include "ritsuko/parallelize.hpp"
+#include <vector>
+
+TEST(Hdf5Serialize, Basic) {
+    // Lock is respected across threads.
+    int counter = 0;
+    ritsuko::parallelize(4, 1000, [&](size_t, size_t, size_t length) -> void {
+        for (size_t i = 0; i < length; ++i) {
+            ritsuko::hdf5::serialize([&]() -> void {
+                ++counter;
+            });
+        }
+    });
+    EXPECT_EQ(counter, 1000);
+
+    // Lock is released on exceptions.
+    EXPECT_ANY_THROW(ritsuko::hdf5::serialize([&]() -> void { throw std::runtime_error("oops"); }));
+    ritsuko::hdf5::serialize([&]() -> void { ++counter; });
+    EXPECT_EQ(counter, 1001);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/hdf5/utils_string.hpp"
+#include <string>
+#include <vector>
+
+TEST(Hdf5UtilsString, FindStringLength) {
+    const char* example = "foobar";
+    EXPECT_EQ(ritsuko::hdf5::find_string_length(example, 6), 6);
+    EXPECT_EQ(ritsuko::hdf5::find_string_length(example, 3), 3);
+    EXPECT_EQ(ritsuko::hdf5::find_string_length(example, 100), 6);
+    EXPECT_EQ(ritsuko::hdf5::find_string_length(example, 0), 0);
+
+    std::string embedded("ab\0cd", 5);
+    EXPECT_EQ(ritsuko::hdf5::find_string_length(embedded.data(), embedded.size()), 2);
+}
+
+TEST(Hdf5UtilsString, FindStringLengths) {
+    for (size_t width : { 1, 3, 8, 32, 33, 100 }) {
+        size_t number = 57;
+        std::vector<char> buffer(width * number);
+        std::vector<size_t> expected(number);
+        for (size_t i = 0; i < number; ++i) {
+            auto len = (i * 7) % (width + 1); // all possible lengths, including those with no null terminator.
+            expected[i] = len;
+            std::fill_n(buffer.data() + i * width, len, 'A' + (i % 26));
+            if (len < width) {
+                buffer[i * width + len] = '\0';
+                std::fill(buffer.data() + i * width + len + 1, buffer.data() + (i + 1) * width, 'z'); // garbage after the terminator.
+            }
+        }
+
+        std::vector<size_t> lengths(number);
+        ritsuko::hdf5::find_string_lengths(buffer.data(), width, number, lengths.data());
+        EXPECT_EQ(lengths, expected);
+    }
+}
+
+TEST(Hdf5UtilsString, FindInvalidUtf8) {
+    auto check = [](const std::string& x) -> size_t {
+        return ritsuko::hdf5::find_invalid_utf8(x.data(), x.size());
+    };
+
+    EXPECT_EQ(check(""), 0);
+    EXPECT_EQ(check("foobar"), 6);
+    EXPECT_EQ(check("the value of π is around 3.1415926535"), std::string("the value of π is around 3.1415926535").size());
+    EXPECT_EQ(check("😀😄😆🤣"), 16);
+    EXPECT_EQ(check("\xEF\xBF\xBF\xF4\x8F\xBF\xBF"), 7); // U+FFFF and U+10FFFF.
+
+    // Invalid sequences, after a long ASCII prefix to check the fast path.
+    std::string prefix(37, 'a');
+    EXPECT_EQ(check(prefix + "\x80"), 37); // lone continuation byte.
+    EXPECT_EQ(check(prefix + "\xC3"), 37); // truncated.
+    EXPECT_EQ(check(prefix + "\xC3" + "a"), 37); // missing continuation byte.
+    EXPECT_EQ(check(prefix + "\xC0\xAF"), 37); // overlong 2-byte.
+    EXPECT_EQ(check(prefix + "\xE0\x80\xAF"), 37); // overlong 3-byte.
+    EXPECT_EQ(check(prefix + "\xED\xA0\x80"), 37); // surrogate.
+    EXPECT_EQ(check(prefix + "\xF0\x80\x80\xAF"), 37); // overlong 4-byte.
+    EXPECT_EQ(check(prefix + "\xF4\x90\x80\x80"), 37); // beyond U+10FFFF.
+    EXPECT_EQ(check(prefix + "\xFF"), 37);
+
+    // Invalid sequence after a valid multi-byte character.
+    EXPECT_EQ(check("α" + prefix + "\xE2\x82"), 39);
+}
@@ -87,3 +87,127 @@ TEST(ValidateString, VariableNdimensional) {
         }
     }
 }
+
+TEST(ValidateString, Utf8Ndimensional) {
+    const char* path = "TEST-validate-string.h5";
+
+    std::vector<hsize_t> dims{ 31, 47 };
+    std::vector<hsize_t> chunks{ 10, 20 };
+    const char* placeholder = "αβγ";
+    std::vector<const char*> ptrs(dims[0] * dims[1], placeholder);
+
+    H5::DataSpace dspace(2, dims.data());
+    H5::DSetCreatPropList cplist;
+    cplist.setChunk(2, chunks.data());
+    H5::StrType vtype(0, H5T_VARIABLE);
+
+    size_t bad_index = 17 * dims[1] + 23;
+    std::vector<char> fixed(dims[0] * dims[1] * 6, '\0');
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        std::copy_n(placeholder, 6, fixed.data() + i * 6);
+    }
+    H5::StrType ftype(0, 6);
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        handle.createDataSet("variable", vtype, dspace, cplist).write(ptrs.data(), vtype);
+        handle.createDataSet("fixed", ftype, dspace, cplist).write(fixed.data(), ftype);
+
+        ptrs[bad_index] = "\xED\xA0\x80";
+        fixed[bad_index * 6 + 1] = 'a';
+        handle.createDataSet("variable_bad", vtype, dspace, cplist).write(ptrs.data(), vtype);
+        handle.createDataSet("fixed_bad", ftype, dspace, cplist).write(fixed.data(), ftype);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (auto buf : { 100, 10000 }) {
+        for (auto name : { "variable", "fixed" }) {
+            auto dhandle = handle.openDataSet(name);
+            ritsuko::hdf5::validate_nd_string_dataset(dhandle, dims, buf, NULL, true);
+        }
+
+        for (auto name : { "variable_bad", "fixed_bad" }) {
+            auto dhandle = handle.openDataSet(name);
+            ritsuko::hdf5::validate_nd_string_dataset(dhandle, buf);
+            EXPECT_ANY_THROW({
+                try {
+                    ritsuko::hdf5::validate_nd_string_dataset(dhandle, dims, buf, NULL, true);
+                } catch (std::exception& e) {
+                    EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid UTF-8 in string " + std::to_string(bad_index)));
+                    throw;
+                }
+            });
+        }
+    }
+}
+
+TEST(ValidateString, ParallelNdimensional) {
+    const char* path = "TEST-validate-string.h5";
+
+    std::vector<hsize_t> dims{ 61, 47 };
+    std::vector<hsize_t> chunks{ 10, 20 };
+    const char* placeholder = "αβγ";
+    std::vector<const char*> ptrs(dims[0] * dims[1], placeholder);
+
+    H5::DataSpace dspace(2, dims.data());
+    H5::DSetCreatPropList cplist;
+    cplist.setChunk(2, chunks.data());
+    H5::StrType vtype(0, H5T_VARIABLE);
+
+    std::vector<char> fixed(dims[0] * dims[1] * 6, '\0');
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        std::copy_n(placeholder, 6, fixed.data() + i * 6);
+    }
+    H5::StrType ftype(0, 6);
+
+    // Injecting multiple errors to check that the lowest index is reported.
+    size_t bad_index = 17 * dims[1] + 23, bad_index2 = 50 * dims[1] + 3;
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        handle.createDataSet("variable", vtype, dspace, cplist).write(ptrs.data(), vtype);
+        handle.createDataSet("fixed", ftype, dspace, cplist).write(fixed.data(), ftype);
+
+        ptrs[bad_index] = "\xED\xA0\x80";
+        ptrs[bad_index2] = "\xED\xA0\x80";
+        fixed[bad_index * 6 + 1] = 'a';
+        fixed[bad_index2 * 6 + 1] = 'a';
+        handle.createDataSet("variable_bad", vtype, dspace, cplist).write(ptrs.data(), vtype);
+        handle.createDataSet("fixed_bad", ftype, dspace, cplist).write(fixed.data(), ftype);
+
+        ptrs[bad_index2] = NULL;
+        handle.createDataSet("variable_null", vtype, dspace, cplist).write(ptrs.data(), vtype);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    for (int nthreads : { 1, 3 }) {
+        for (auto buf : { 100, 10000 }) {
+            for (auto name : { "variable", "fixed" }) {
+                auto dhandle = handle.openDataSet(name);
+                ritsuko::hdf5::parallel_validate_nd_string_dataset(dhandle, dims, buf, nthreads, true);
+            }
+
+            for (auto name : { "variable_bad", "fixed_bad" }) {
+                auto dhandle = handle.openDataSet(name);
+                ritsuko::hdf5::parallel_validate_nd_string_dataset(dhandle, dims, buf, nthreads);
+                EXPECT_ANY_THROW({
+                    try {
+                        ritsuko::hdf5::parallel_validate_nd_string_dataset(dhandle, dims, buf, nthreads, true);
+                    } catch (std::exception& e) {
+                        EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid UTF-8 in string " + std::to_string(bad_index) + " "));
+                        throw;
+                    }
+                });
+            }
+
+            auto dhandle = handle.openDataSet("variable_null");
+            EXPECT_ANY_THROW({
+                try {
+                    ritsuko::hdf5::parallel_validate_nd_string_dataset(dhandle, dims, buf, nthreads, true);
+                } catch (std::exception& e) {
+                    EXPECT_THAT(e.what(), ::testing::HasSubstr("NULL pointer"));
+                    throw;
+                }
+            });
+        }
+    }
+}
@@ -148,6 +148,48 @@ TEST(VlsStream1dArray, Unicode) {
     }
 }
 
+TEST(VlsStream1dArray, CheckUtf8) {
+    std::vector<std::string> example { "α", "β", "γ\xCE", "δ" };
+    size_t nlen = example.size();
+
+    const std::string path = "TEST-vls-stream.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > pointers(nlen);
+        size_t count = fill_pointers(example, pointers);
+        auto dtype = ritsuko::hdf5::vls::define_pointer_datatype<uint32_t, uint32_t>();
+        create_vls_pointer_dataset(handle, "foo", pointers, dtype);
+
+        auto heap = create_heap(example, count);
+        create_dataset(handle, "bar", heap, H5::PredType::NATIVE_UINT8);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto phandle = ritsuko::hdf5::vls::open_pointers(handle, "foo", 64, 64);
+    auto chandle = ritsuko::hdf5::vls::open_heap(handle, "bar");
+
+    // No error without the check.
+    {
+        ritsuko::hdf5::vls::Stream1dArray<uint64_t, uint64_t> stream(&phandle, &chandle, 200);
+        for (auto x : example) {
+            EXPECT_EQ(stream.get(), x);
+            stream.next();
+        }
+    }
+
+    ritsuko::hdf5::vls::Stream1dArray<uint64_t, uint64_t> stream(&phandle, &chandle, 200);
+    stream.set_check_utf8(true);
+    EXPECT_ANY_THROW({
+        try {
+            stream.get();
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid UTF-8 in string 2"));
+            throw;
+        }
+    });
+}
+
 TEST(VlsStream1dArray, Failures) {
     const std::string path = "TEST-vls-stream.h5";
 
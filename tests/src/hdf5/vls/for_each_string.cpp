@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "ritsuko/hdf5/vls/for_each_string.hpp"
+#include "ritsuko/hdf5/vls/open.hpp"
+
+#include "utils.h"
+#include "../utils.h"
+
+TEST(VlsForEachString, Basic) {
+    std::vector<std::string> example(1234);
+    for (size_t i = 0; i < example.size(); ++i) {
+        example[i] = (i % 5 == 0 ? std::string() : "foo" + std::to_string(i));
+    }
+    size_t nlen = example.size();
+
+    const std::string path = "TEST-vls-for-each.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+
+        // Contiguous heap, with an extra null terminator after each string.
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > pointers(nlen);
+        std::vector<unsigned char> heap;
+        for (size_t i = 0; i < nlen; ++i) {
+            pointers[i].offset = heap.size();
+            pointers[i].length = example[i].size() + 1;
+            heap.insert(heap.end(), example[i].begin(), example[i].end());
+            heap.push_back('\0');
+        }
+        auto dtype = ritsuko::hdf5::vls::define_pointer_datatype<uint32_t, uint32_t>();
+        create_vls_pointer_dataset(handle, "foo", pointers, dtype, 100);
+        create_dataset(handle, "bar", heap, H5::PredType::NATIVE_UINT8);
+
+        // Sparse pointers in reverse order, which should be read individually.
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > pointers2(nlen);
+        for (size_t i = 0; i < nlen; ++i) {
+            pointers2[i].offset = (nlen - i - 1) * 1000;
+            pointers2[i].length = example[nlen - i - 1].size();
+        }
+        create_vls_pointer_dataset(handle, "foo2", pointers2, dtype, 100);
+        std::vector<unsigned char> heap2(nlen * 1000);
+        for (size_t i = 0; i < nlen; ++i) {
+            const auto& current = example[nlen - i - 1];
+            std::copy(current.begin(), current.end(), heap2.begin() + (nlen - i - 1) * 1000);
+        }
+        create_dataset(handle, "bar2", heap2, H5::PredType::NATIVE_UINT8);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    {
+        auto phandle = ritsuko::hdf5::vls::open_pointers(handle, "foo", 64, 64);
+        auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "bar");
+        for (hsize_t buf : { 50, 500, 5000 }) {
+            std::vector<std::string> collected;
+            bool finished = ritsuko::hdf5::vls::for_each_1d_string<uint64_t, uint64_t>(phandle, hhandle, buf, [&](hsize_t i, const char* ptr, size_t len) -> void {
+                EXPECT_EQ(i, collected.size());
+                collected.emplace_back(ptr, len);
+            });
+            EXPECT_TRUE(finished);
+            EXPECT_EQ(collected, example);
+        }
+
+        hsize_t last = 0;
+        bool finished = ritsuko::hdf5::vls::for_each_1d_string<uint64_t, uint64_t>(phandle, hhandle, 100, [&](hsize_t i, const char*, size_t) -> bool {
+            last = i;
+            return i < 321;
+        });
+        EXPECT_FALSE(finished);
+        EXPECT_EQ(last, 321);
+    }
+
+    {
+        auto phandle = ritsuko::hdf5::vls::open_pointers(handle, "foo2", 64, 64);
+        auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "bar2");
+        std::vector<std::string> collected;
+        ritsuko::hdf5::vls::for_each_1d_string<uint64_t, uint64_t>(phandle, hhandle, 100, [&](hsize_t, const char* ptr, size_t len) -> void {
+            collected.emplace_back(ptr, len);
+        });
+        std::vector<std::string> expected(example.rbegin(), example.rend());
+        EXPECT_EQ(collected, expected);
+    }
+}
+
+TEST(VlsForEachString, OutOfRange) {
+    const std::string path = "TEST-vls-for-each.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > pointers(1);
+        pointers[0].offset = 0;
+        pointers[0].length = 10;
+        auto dtype = ritsuko::hdf5::vls::define_pointer_datatype<uint32_t, uint32_t>();
+        create_vls_pointer_dataset(handle, "foo", pointers, dtype);
+        std::vector<unsigned char> heap(5);
+        create_dataset(handle, "bar", heap, H5::PredType::NATIVE_UINT8);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto phandle = ritsuko::hdf5::vls::open_pointers(handle, "foo", 64, 64);
+    auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "bar");
+    std::string errmsg = "no_error";
+    try {
+        ritsuko::hdf5::vls::for_each_1d_string<uint64_t, uint64_t>(phandle, hhandle, 100, [&](hsize_t, const char*, size_t) -> void {});
+    } catch (std::exception& e) {
+        errmsg = e.what();
+    }
+    EXPECT_THAT(errmsg, ::testing::HasSubstr("out of range"));
+}
+
+TEST(VlsForEachString, Ndimensional) {
+    hsize_t nr = 23, nc = 37;
+    size_t nlen = nr * nc;
+    std::vector<std::string> example(nlen);
+    for (size_t i = 0; i < nlen; ++i) {
+        example[i] = (i % 7 == 0 ? std::string() : "bar" + std::to_string(i));
+    }
+
+    const std::string path = "TEST-vls-for-each.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > pointers(nlen);
+        std::vector<unsigned char> heap;
+        for (size_t i = 0; i < nlen; ++i) {
+            pointers[i].offset = heap.size();
+            pointers[i].length = example[i].size();
+            heap.insert(heap.end(), example[i].begin(), example[i].end());
+        }
+
+        hsize_t dims[2] = { nr, nc };
+        H5::DataSpace dspace(2, dims);
+        H5::DSetCreatPropList cplist;
+        hsize_t chunks[2] = { 5, 8 };
+        cplist.setChunk(2, chunks);
+        auto dtype = ritsuko::hdf5::vls::define_pointer_datatype<uint32_t, uint32_t>();
+        auto dhandle = handle.createDataSet("foo", dtype, dspace, cplist);
+        dhandle.write(pointers.data(), dtype);
+        create_dataset(handle, "bar", heap, H5::PredType::NATIVE_UINT8);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto phandle = handle.openDataSet("foo");
+    auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "bar");
+
+    for (hsize_t buffer_size : { 10, 50, 1000 }) {
+        std::vector<std::string> collected(nlen);
+        std::vector<int> visited(nlen);
+        bool finished = ritsuko::hdf5::vls::for_each_nd_string<uint64_t, uint64_t>(phandle, hhandle, buffer_size, [&](hsize_t i, const char* ptr, size_t len) -> void {
+            collected[i] = std::string(ptr, len);
+            ++visited[i];
+        });
+        EXPECT_TRUE(finished);
+        EXPECT_EQ(collected, example);
+        EXPECT_EQ(visited, std::vector<int>(nlen, 1));
+    }
+
+    // Terminating early.
+    size_t counter = 0;
+    bool finished = ritsuko::hdf5::vls::for_each_nd_string<uint64_t, uint64_t>(phandle, hhandle, 50, [&](hsize_t, const char*, size_t) -> bool {
+        ++counter;
+        return counter < 100;
+    });
+    EXPECT_FALSE(finished);
+    EXPECT_EQ(counter, 100);
+}
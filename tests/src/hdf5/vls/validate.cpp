@@ -81,3 +81,45 @@ TEST(VlsValidate, NDim) {
     }
     EXPECT_THAT(errmsg, ::testing::HasSubstr("out of range"));
 }
+
+TEST(VlsValidate, ParallelNDim) {
+    const std::string path = "TEST-vls-validate.h5";
+    std::vector<hsize_t> dims{ 131, 211 };
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+
+        size_t nlen = dims[0] * dims[1];
+        std::vector<ritsuko::hdf5::vls::Pointer<uint32_t, uint32_t> > data(nlen);
+        for (size_t i = 0; i < nlen; ++i) {
+            data[i].offset = i * 1;
+            data[i].length = i * 10;
+        }
+
+        H5::DataSpace dspace(2, dims.data());
+        H5::DSetCreatPropList cplist;
+        std::vector<hsize_t> chunks{ 11, 19 };
+        cplist.setChunk(2, chunks.data());
+
+        auto dtype = ritsuko::hdf5::vls::define_pointer_datatype<uint32_t, uint32_t>();
+        auto dhandle = handle.createDataSet("foobar", dtype, dspace, cplist);
+        dhandle.write(data.data(), dtype);
+    }
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = ritsuko::hdf5::vls::open_pointers(handle, "foobar", 64, 64);
+    for (int nthreads : { 1, 4 }) {
+        std::vector<size_t> buffer_sizes{ 1000, 5000 };
+        for (auto buffer_size : buffer_sizes) {
+            ritsuko::hdf5::vls::parallel_validate_nd_array<uint64_t, uint64_t>(dhandle, dims, 1000000, buffer_size, nthreads);
+        }
+
+        std::string errmsg = "no_error";
+        try {
+            ritsuko::hdf5::vls::parallel_validate_nd_array<uint64_t, uint64_t>(dhandle, dims, 1000, 10, nthreads);
+        } catch (std::exception& e) {
+            errmsg = e.what();
+        }
+        EXPECT_THAT(errmsg, ::testing::HasSubstr("out of range"));
+    }
+}
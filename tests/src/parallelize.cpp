@@ -0,0 +1,29 @@
+#include "ritsuko/parallelize.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+#include <stdexcept>
+
+TEST(Parallelize, Basic) {
+    for (size_t nthreads : { 1, 3, 10 }) {
+        std::vector<int> touched(101);
+        ritsuko::parallelize(nthreads, touched.size(), [&](size_t, size_t start, size_t length) -> void {
+            for (size_t i = start, end = start + length; i < end; ++i) {
+                ++touched[i];
+            }
+        });
+        EXPECT_EQ(touched, std::vector<int>(touched.size(), 1));
+    }
+
+    // No-op for zero tasks.
+    ritsuko::parallelize(5, 0, [&](size_t, size_t, size_t) -> void { throw std::runtime_error("should not be called"); });
+}
+
+TEST(Parallelize, Errors) {
+    EXPECT_ANY_THROW({
+        ritsuko::parallelize(4, 100, [&](size_t w, size_t, size_t) -> void {
+            if (w == 2) {
+                throw std::runtime_error("oops");
+            }
+        });
+    });
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "ritsuko/permute_dimensions.hpp"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+TEST(TransposeMatrix, Basic) {
+    for (size_t nrow : { 1, 7, 16, 33 }) {
+        for (size_t ncol : { 1, 5, 32, 50 }) {
+            std::vector<int> input(nrow * (ncol + 3));
+            std::iota(input.begin(), input.end(), 0);
+            std::vector<double> output(ncol * (nrow + 2), -1);
+            std::vector<double> converted(input.begin(), input.end());
+
+            ritsuko::transpose_matrix(converted.data(), nrow, ncol, ncol + 3, output.data(), nrow + 2);
+            for (size_t r = 0; r < nrow; ++r) {
+                for (size_t c = 0; c < ncol; ++c) {
+                    EXPECT_EQ(output[c * (nrow + 2) + r], input[r * (ncol + 3) + c]);
+                }
+                for (size_t c = 0; c < ncol; ++c) {
+                    EXPECT_EQ(output[c * (nrow + 2) + nrow], -1); // padding is untouched.
+                }
+            }
+        }
+    }
+}
+
+TEST(PermuteDimensions, ThreeDimensional) {
+    std::vector<size_t> dims { 19, 37, 5 };
+    std::vector<int> input(dims[0] * dims[1] * dims[2]);
+    std::iota(input.begin(), input.end(), 0);
+
+    std::vector<size_t> layout { 0, 1, 2 };
+    do {
+        std::vector<int> output(input.size());
+        ritsuko::permute_dimensions(input.data(), dims, layout, output.data());
+
+        std::vector<size_t> strides(3);
+        size_t stride = 1;
+        for (size_t i = 3; i > 0; --i) {
+            strides[layout[i - 1]] = stride;
+            stride *= dims[layout[i - 1]];
+        }
+
+        for (size_t x = 0; x < dims[0]; ++x) {
+            for (size_t y = 0; y < dims[1]; ++y) {
+                for (size_t z = 0; z < dims[2]; ++z) {
+                    EXPECT_EQ(output[x * strides[0] + y * strides[1] + z * strides[2]], input[(x * dims[1] + y) * dims[2] + z]);
+                }
+            }
+        }
+    } while (std::next_permutation(layout.begin(), layout.end()));
+}
+
+TEST(PermuteDimensions, FourDimensional) {
+    std::vector<size_t> dims { 3, 20, 4, 18 };
+    std::vector<int> input(dims[0] * dims[1] * dims[2] * dims[3]);
+    std::iota(input.begin(), input.end(), 0);
+
+    std::vector<size_t> layout { 3, 1, 0, 2 };
+    std::vector<int> output(input.size());
+    ritsuko::permute_dimensions(input.data(), dims, layout, output.data());
+
+    size_t counter = 0;
+    for (size_t w = 0; w < dims[3]; ++w) {
+        for (size_t y = 0; y < dims[1]; ++y) {
+            for (size_t x = 0; x < dims[0]; ++x) {
+                for (size_t z = 0; z < dims[2]; ++z) {
+                    EXPECT_EQ(output[counter], input[((x * dims[1] + y) * dims[2] + z) * dims[3] + w]);
+                    ++counter;
+                }
+            }
+        }
+    }
+}
+
+TEST(PermuteDimensions, Errors) {
+    std::vector<size_t> dims { 2, 3 };
+    std::vector<int> input(6), output(6);
+    EXPECT_ANY_THROW({
+        try {
+            ritsuko::permute_dimensions(input.data(), dims, std::vector<size_t>{ 1, 1 }, output.data());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("permutation"));
+            throw;
+        }
+    });
+
+    EXPECT_FALSE(ritsuko::is_dimension_permutation(std::vector<size_t>{ 0 }, 2));
+    EXPECT_FALSE(ritsuko::is_dimension_permutation(std::vector<size_t>{ 0, 2 }, 2));
+    EXPECT_TRUE(ritsuko::is_dimension_permutation(std::vector<size_t>{ 1, 0 }, 2));
+
+    // Empty arrays are a no-op.
+    std::vector<size_t> empty { 0, 3 };
+    ritsuko::permute_dimensions(input.data(), empty, std::vector<size_t>{ 1, 0 }, output.data());
+}